@@ -27,8 +27,10 @@ using std::endl;
 
 #include <cstdio>
 #endif
-#include <map>
-using std::map;
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 
 #include "bgdefs.h"
 #include "misc.h"
@@ -473,73 +475,311 @@ dindent(int k)
 
 typedef Analyze::GNUbgBoard AllMoves[21];
 
-struct MCkey {
-  Analyze::GNUbgBoard 	b;
-  bool			xOnPlay;
-  uint			cube;
-};
+// Best replies to all 21 rolls from a position, kept between the
+// (many) visits of a cubeful analysis.
+//
+// The cache has a fixed size: a position can only be in one bucket of WAYS
+// entries, and the bucket entries are replaced in clock order (an entry
+// which was used since the hand last passed it gets a second chance).
+// Positions are stored as their 10 byte keys. Several threads can use it,
+// each group of buckets has its own lock.
+
+class MovesCache {
+public:
+  struct Key {
+    unsigned char	auch[10];
+    unsigned char	xOnPlay;
+    unsigned char	cbf;
+    uint32_t		cube;
+  };
+
+  typedef unsigned char Replies[21][10];
+  
+  MovesCache(size_t maxBytes);
+
+  ~MovesCache();
+
+  // Memory to use, in bytes. 0 disables the cache.
+  void	resize(size_t maxBytes);
 
-struct MCval {
-  AllMoves m;
+  // Drop all entries
+  void	clear(void);
+  
+  bool	lookup(Key const& k, Replies& r);
+
+  void	add(Key const& k, Replies const& r);
+
+private:
+  enum { WAYS = 4, N_LOCKS = 64 };
+  
+  struct Entry {
+    Key			key;
+    // clear() just changes the epoch, entries of older ones are empty
+    uint32_t		epoch;
+    bool		used;
+    Replies		replies;
+  };
+
+  struct Bucket {
+    Entry		e[WAYS];
+    uint		hand;
+  };
+
+  static uint32_t	hash(Key const& k);
+
+  // Allocate the buckets (at most maxBytes of them), if not done yet
+  void		allocate(void);
+  
+  void		lockAll(void);
+  void		unlockAll(void);
+
+  // The lock of a key is chosen by its hash alone, and there are at
+  // least N_LOCKS buckets, so a bucket is always under the same lock.
+  Bucket*		buckets;
+  size_t		nBuckets;		// 0 or a power of 2
+  size_t		maxBytes;
+  uint32_t		epoch;
+  
+  pthread_mutex_t	locks[N_LOCKS];
 };
 
-typedef  map<MCkey, MCval> MovesCache;
-static MovesCache locC;
+MovesCache::MovesCache(size_t const maxBytes) :
+  buckets(0),
+  nBuckets(0),
+  maxBytes(maxBytes),
+  epoch(1)
+{
+  for(uint i = 0; i < N_LOCKS; ++i) {
+    pthread_mutex_init(&locks[i], 0);
+  }
+}
+
+MovesCache::~MovesCache()
+{
+  free(buckets);
+  
+  for(uint i = 0; i < N_LOCKS; ++i) {
+    pthread_mutex_destroy(&locks[i]);
+  }
+}
+
+void
+MovesCache::lockAll(void)
+{
+  for(uint i = 0; i < N_LOCKS; ++i) {
+    pthread_mutex_lock(&locks[i]);
+  }
+}
+
+void
+MovesCache::unlockAll(void)
+{
+  for(uint i = N_LOCKS; i > 0; --i) {
+    pthread_mutex_unlock(&locks[i-1]);
+  }
+}
+
+void
+MovesCache::resize(size_t const maxBytes_)
+{
+  lockAll();
+  
+  free(buckets);
+  buckets = 0;
+  nBuckets = 0;
+  maxBytes = maxBytes_;
+
+  unlockAll();
+}
+
+void
+MovesCache::clear(void)
+{
+  lockAll();
+
+  if( ++epoch == 0 ) {
+    // wrapped around, old entries may look current
+    if( buckets ) {
+      memset(buckets, 0, nBuckets * sizeof(*buckets));
+    }
+    epoch = 1;
+  }
+  
+  unlockAll();
+}
+
+uint32_t
+MovesCache::hash(Key const& k)
+{
+  // FNV-1a
+  const unsigned char* const p = reinterpret_cast<const unsigned char*>(&k);
+  uint32_t h = 2166136261U;
+
+  for(uint i = 0; i < sizeof(k); ++i) {
+    h = (h ^ p[i]) * 16777619U;
+  }
+  
+  return h;
+}
+
+void
+MovesCache::allocate(void)
+{
+  lockAll();
+
+  if( ! buckets ) {
+    size_t n = N_LOCKS;
+      
+    if( n * sizeof(Bucket) <= maxBytes ) {
+      while( 2 * n * sizeof(Bucket) <= maxBytes ) {
+	n *= 2;
+      }
+      
+      buckets = static_cast<Bucket*>(calloc(n, sizeof(Bucket)));
+      nBuckets = buckets ? n : 0;
+    }
+  }
+    
+  unlockAll();
+}
 
 bool
-operator <(MCkey const& k1, MCkey const& k2)
+MovesCache::lookup(Key const& k, Replies& r)
+{
+  uint32_t const h = hash(k);
+  pthread_mutex_t* const l = &locks[h & (N_LOCKS - 1)];
+  bool found = false;
+
+  pthread_mutex_lock(l);
+
+  if( buckets ) {
+    Bucket* const b = &buckets[h & (nBuckets - 1)];
+
+    for(uint i = 0; i < WAYS; ++i) {
+      Entry& e = b->e[i];
+
+      if( e.epoch == epoch && memcmp(&e.key, &k, sizeof(k)) == 0 ) {
+	e.used = true;
+	memcpy(r, e.replies, sizeof(r));
+	found = true;
+	break;
+      }
+    }
+  }
+
+  pthread_mutex_unlock(l);
+
+  return found;
+}
+
+void
+MovesCache::add(Key const& k, Replies const& r)
 {
-  if( k1.cube < k2.cube ) {
-    return true;
+  uint32_t const h = hash(k);
+  pthread_mutex_t* const l = &locks[h & (N_LOCKS - 1)];
+
+  pthread_mutex_lock(l);
+
+  if( ! buckets ) {
+    // first use, or after a resize
+    pthread_mutex_unlock(l);
+    allocate();
+    pthread_mutex_lock(l);
+
+    if( ! buckets ) {
+      pthread_mutex_unlock(l);
+      return;
+    }
+  }
+  
+  Bucket* const b = &buckets[h & (nBuckets - 1)];
+  Entry* e = 0;
+  
+  for(uint i = 0; i < WAYS && ! e; ++i) {
+    if( b->e[i].epoch != epoch ) {
+      e = &b->e[i];
+    }
   }
-  if( k1.xOnPlay < k2.xOnPlay ) {
-    return true;
+
+  while( ! e ) {
+    Entry& c = b->e[b->hand];
+
+    b->hand = (b->hand + 1) % WAYS;
+    
+    if( c.used ) {
+      c.used = false;
+    } else {
+      e = &c;
+    }
   }
-  return memcmp(&k1.b[0][0], &k2.b[0][0], sizeof(k1.b)) < 0;
+
+  e->key = k;
+  e->epoch = epoch;
+  e->used = false;
+  memcpy(e->replies, r, sizeof(e->replies));
+
+  pthread_mutex_unlock(l);
 }
 
+static MovesCache movesCache(64 * 1024 * 1024);
+
+void
+setMovesCacheSize(size_t const maxBytes)
+{
+  movesCache.resize(maxBytes);
+}
 
-static AllMoves*
-get(Analyze::GNUbgBoard const  anBoard,
+// Best move of each of the 21 rolls, as seen by the opponent
+static void
+get(AllMoves&                  m,
+    Analyze::GNUbgBoard const  anBoard,
     bool const                 xOnPlay,
     unsigned int const         cube,
     bool const                 cbf)
 {
-  MCkey k;
-  memcpy(&k.b[0][0], &anBoard[0][0], sizeof(k.b));
+  MovesCache::Key k;
+  MovesCache::Replies r;
+
+  memset(&k, 0, sizeof(k));
+  PositionKey(anBoard, k.auch);
   k.xOnPlay = xOnPlay;
+  k.cbf = cbf;
   k.cube = cube;
   
-  MovesCache::iterator i = locC.find(k);
+  if( movesCache.lookup(k, r) ) {
+    for(uint nr = 0; nr < 21; ++nr) {
+      PositionFromKey(m[nr], r[nr]);
+    }
+    return;
+  }
   
-  if( i == locC.end() ) {
-    Analyze::GNUbgBoard tmpBoard;
-
-    MCval m;
+  Analyze::GNUbgBoard tmpBoard;
 
-    if( ! Analyze::gameOn(anBoard) ) {
-      memcpy(&tmpBoard[0][0], &anBoard[0][0], sizeof(tmpBoard));
-      SwapSides(tmpBoard);
-      for(uint nr = 0; nr < 21; ++nr) {
-	memcpy(&m.m[nr][0][0], &tmpBoard[0][0], sizeof(tmpBoard));
-      }
-    } else {
+  if( ! Analyze::gameOn(anBoard) ) {
+    memcpy(&tmpBoard[0][0], &anBoard[0][0], sizeof(tmpBoard));
+    SwapSides(tmpBoard);
+    for(uint nr = 0; nr < 21; ++nr) {
+      memcpy(&m[nr][0][0], &tmpBoard[0][0], sizeof(tmpBoard));
+    }
+  } else {
     
-      for(uint nr = 0; nr < 21; ++nr) {
-	memcpy(&tmpBoard[0][0], &anBoard[0][0], sizeof(tmpBoard));
+    for(uint nr = 0; nr < 21; ++nr) {
+      memcpy(&tmpBoard[0][0], &anBoard[0][0], sizeof(tmpBoard));
 
-	if( cbf ) {
-	  findBestMove(0,roll2dice1[nr], roll2dice2[nr], tmpBoard, xOnPlay, 0);
-	} else {
-	  FindBestMove(0,0,roll2dice1[nr], roll2dice2[nr],tmpBoard,0, xOnPlay);
-	}
-	SwapSides(tmpBoard);
-	memcpy(&m.m[nr][0][0], &tmpBoard[0][0], sizeof(tmpBoard));
+      if( cbf ) {
+	findBestMove(0,roll2dice1[nr], roll2dice2[nr], tmpBoard, xOnPlay, 0);
+      } else {
+	FindBestMove(0,0,roll2dice1[nr], roll2dice2[nr],tmpBoard,0, xOnPlay);
       }
+      SwapSides(tmpBoard);
+      memcpy(&m[nr][0][0], &tmpBoard[0][0], sizeof(tmpBoard));
     }
-    i = locC.insert( MovesCache::value_type(k, m) ).first;
   }
-  return &(*i).second.m;
+
+  for(uint nr = 0; nr < 21; ++nr) {
+    PositionKey(m[nr], r[nr]);
+  }
+  movesCache.add(k, r);
 }
 
 float
@@ -605,8 +845,8 @@ Analyze::R1::cubefulEquity(GNUbgBoard const  anBoard,
 
     float eq = 0;
     
-    AllMoves const& pm = *::get(anBoard, xOnPlay_, fullEval ? cube : 1,
-				cbfMoves);
+    AllMoves pm;
+    ::get(pm, anBoard, xOnPlay_, fullEval ? cube : 1, cbfMoves);
 
     if( advantage ) {
       Equities::push(xOnPlay == xOnPlay_ ?
@@ -713,7 +953,8 @@ cubeless(float                      p[NUM_OUTPUTS],
     }
     
   } else {
-    AllMoves const& pm = *::get(board, xOnPlay_, 1, cbfMoves);
+    AllMoves pm;
+    ::get(pm, board, xOnPlay_, 1, cbfMoves);
 
     for(uint nr = 0; nr < 21; ++nr) {
       float const f = rollIsDouble(nr) ? 1.0/36.0 : 2.0/36.0;
@@ -781,7 +1022,8 @@ Analyze::R1::analyze(GNUbgBoard const        b,
   
   cubefulEquities(b);
 
-  locC.clear();
+  // the moves depend on the match score
+  movesCache.clear();
 
   setDecision();
 }
@@ -22,6 +22,7 @@
 #if !defined( DANALYZE_H )
 #define DANALYZE_H
 
+#include <stddef.h>
 #include "equities.h"
 
 struct Advantage {
@@ -32,4 +33,9 @@ struct Advantage {
 extern uint
 numberOfOppMoves(int const board[2][25]);
 
+// Memory limit of the cache of best replies used by the cubeful
+// analysis, in bytes (default 64MB). 0 disables the cache.
+extern void
+setMovesCacheSize(size_t maxBytes);
+
 #endif
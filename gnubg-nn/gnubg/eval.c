@@ -1822,6 +1822,46 @@ EvaluatePositionFast(CONST int anBoard[2][25], float arOutput[])
 
   SanityCheck(anBoard, arOutput);
 }
+
+extern int
+EvaluatePositionInputs(CONST int anBoard[2][25], int pc, int prune,
+		       float arInput[], float arOutput[])
+{
+  int c = ClassifyPosition(anBoard);
+
+  if( prune ) {
+    /* as evalPrune */
+    if( c != pc || c == CLASS_RACE || ! nets[c].pnet ) {
+      return -1;
+    }
+    
+    NeuralNetEvaluate(nets[c].pnet, arInput, arOutput);
+    return 0;
+  }
+
+  /* bearoff databases and race adjustments */
+  if( c < CLASS_CRASHED ) {
+    return -1;
+  }
+
+  /* as EvalClass */
+  while( ! nets[c].net ) {
+    c = alternate[c];
+    if( c < 0 ) {
+      return -1;
+    }
+  }
+
+  if( c != pc ) {
+    return -1;
+  }
+  
+  NeuralNetEvaluate(nets[c].net, arInput, arOutput);
+
+  SanityCheck(anBoard, arOutput);
+  
+  return 0;
+}
  
 
 static int
@@ -2166,35 +2206,86 @@ NetEval(float* p, CONST int anBoard[2][25], positionclass pc, float* inputs)
 }
 
 extern int
-TrainPosition(CONST int anBoard[2][25], float arDesired[], float a,
-	      CONST int* tList)
+TrainClassInputs(CONST int anBoard[2][25], float arDesired[], int prune,
+		 float arInput[])
 {
-  float arInput[MAX_NUM_INPUTS], arOutput[NUM_OUTPUTS];
-
   int pc = ClassifyPosition(anBoard);
-  
-  neuralnet* nn = nets[pc].net;
 
-  if( ! nn ) {
-    int CONST a = alternate[pc];
-    if( a >= 0 ) {
-      pc = a;
-      nn = nets[pc].net;
+  if( prune ) {
+    if( ! nets[pc].pnet ) {
+      errno = EDOM;
+      return -1;
     }
-
-    if( ! nn ) {
+    
+    baseInputs(anBoard, arInput);
+    
+    return pc;
+  }
+  
+  if( ! nets[pc].net ) {
+    int CONST a = alternate[pc];
+    
+    if( ! (a >= 0 && nets[a].net) ) {
       errno = EDOM;
       return -1;
     }
+    pc = a;
   }
     
   SanityCheck(anBoard, arDesired);
 
   nets[pc].netInputs->func(anBoard, arInput);
+
+  return pc;
+}
+
+extern neuralnet*
+TrainNet(int pc, int prune)
+{
+  return prune ? nets[pc].pnet : nets[pc].net;
+}
+
+extern CONST char*
+TrainInputsName(int pc, int prune)
+{
+  if( prune ) {
+    return "base200";
+  }
   
+  return nets[pc].netInputs ? nets[pc].netInputs->name : "";
+}
+
+extern neuralnet*
+TrainPositionInputs(CONST int anBoard[2][25], float arDesired[], int prune,
+		    float arInput[])
+{
+  int CONST pc = TrainClassInputs(anBoard, arDesired, prune, arInput);
+
+  return pc >= 0 ? TrainNet(pc, prune) : 0;
+}
+
+extern float
+TrainRate(CONST neuralnet* nn, float a)
+{
   if( a < 0 ) {
     a = 2.0 / pow( 100.0 + nn->nTrained, 0.25 );
   }
+  return a;
+}
+
+extern int
+TrainPosition(CONST int anBoard[2][25], float arDesired[], float a,
+	      CONST int* tList)
+{
+  float arInput[MAX_NUM_INPUTS], arOutput[NUM_OUTPUTS];
+
+  neuralnet* nn = TrainPositionInputs(anBoard, arDesired, 0, arInput);
+
+  if( ! nn ) {
+    return -1;
+  }
+  
+  a = TrainRate(nn, a);
   
   if( ! tList ) {
     NeuralNetTrain(nn, arInput, arOutput, arDesired, a);
@@ -2211,17 +2302,12 @@ PruneTrainPosition(CONST int anBoard[2][25], float arDesired[], float a)
 {
   float arInput[CEVAL_NUM_INPUTS], arOutput[NUM_OUTPUTS];
 
-  int pc = ClassifyPosition(anBoard);
-  
-  neuralnet* pnn = nets[pc].pnet;
+  neuralnet* pnn = TrainPositionInputs(anBoard, arDesired, 1, arInput);
 
   if( ! pnn ) {
-    errno = EDOM;
     return -1;
   }
     
-  baseInputs(anBoard, arInput);
-  
   {                                                          assert( a > 0 ); }
   
   NeuralNetTrain(pnn, arInput, arOutput, arDesired, a);
@@ -140,6 +140,14 @@ extern void RollDice( int anDice[ 2 ] );
 extern void
 EvaluatePositionFast(CONST int anBoard[2][25], float arOutput[]);
 
+/* EvaluatePositionFast (evalPrune if prune is set) of anBoard, given the
+   inputs of the net of class pc computed by TrainClassInputs. Returns -1
+   when anBoard is not evaluated by that net alone (bearoff databases,
+   race, ...). */
+extern int
+EvaluatePositionInputs(CONST int anBoard[2][25], int pc, int prune,
+		       float arInput[], float arOutput[]);
+
 extern int EvaluatePosition(CONST int anBoard[2][25], float arOutput[],
 			    int nPlies, int wide,
 			    int direction, float* p,
@@ -188,6 +196,34 @@ extern int
 TrainPosition(CONST int anBoard[2][25], float arDesired[], float alpha,
 	      CONST int* k);
 
+/* Net trained with anBoard (the pruning net if prune is set) and its
+   inputs in arInput. arDesired is sanity checked for the main nets.
+   0 (errno EDOM) if there is no such net. */
+struct _neuralnet;
+
+extern struct _neuralnet*
+TrainPositionInputs(CONST int anBoard[2][25], float arDesired[], int prune,
+		    float arInput[]);
+
+/* As above, but returns the class of the net (-1 if none). The inputs
+   only depend on the class and the input function of its net, so they
+   may be computed once and kept (see TrainInputsName). */
+extern int
+TrainClassInputs(CONST int anBoard[2][25], float arDesired[], int prune,
+		 float arInput[]);
+
+extern struct _neuralnet*
+TrainNet(int pc, int prune);
+
+/* Name of the input function used for training class pc */
+extern CONST char*
+TrainInputsName(int pc, int prune);
+
+/* Training rate of nn: alpha, or a rate decreasing with the number of
+   positions the net has been trained with if alpha is negative. */
+extern float
+TrainRate(CONST struct _neuralnet* nn, float alpha);
+
 extern int
 PruneTrainPosition(CONST int anBoard[2][25], float arDesired[], float alpha);
 
@@ -27,6 +27,7 @@
 #include <assert.h>
 
 #include "eval.h"
+#include <neuralnet.h>
 #include "inputs.h"
 
 static inline int
@@ -4081,6 +4082,73 @@ getInputs(CONST int anBoard[2][25], CONST int* which, float* values)
   }
 }
 
+unsigned int
+SparseInputs(CONST float arInput[], unsigned int nInputs, unsigned short aw[])
+{
+  unsigned short* w = aw;
+  unsigned int i;
+
+  {                                       assert( nInputs < SPARSE_VALUE ); }
+  
+  for(i = 0; i < nInputs; ++i) {
+    float CONST v = arInput[i];
+    
+    if( v == 1.0 ) {
+      *w++ = i;
+    } else if( v != 0.0 ) {
+      *w++ = i | SPARSE_VALUE;
+      memcpy(w, &v, sizeof(v));
+      w += 2;
+    }
+  }
+
+  return w - aw;
+}
+
+void
+DenseInputs(CONST unsigned short aw[], unsigned int nWords, float arInput[],
+	    unsigned int nInputs)
+{
+  CONST unsigned short* w = aw;
+  CONST unsigned short* CONST end = aw + nWords;
+  
+  memset(arInput, 0, nInputs * sizeof(*arInput));
+
+  while( w < end ) {
+    if( *w & SPARSE_VALUE ) {
+      memcpy(&arInput[*w & ~SPARSE_VALUE], w + 1, sizeof(float));
+      w += 3;
+    } else {
+      arInput[*w++] = 1.0;
+    }
+  }
+}
+
+void
+SparseInputsList(CONST unsigned short aw[], unsigned int nWords,
+		 struct _nnsparse* pns)
+{
+  CONST unsigned short* w = aw;
+  CONST unsigned short* CONST end = aw + nWords;
+  int c = 0;
+  
+  while( w < end ) {
+    {                                       assert( c < NN_SPARSE_MAX ); }
+    
+    if( *w & SPARSE_VALUE ) {
+      pns->ai[c] = *w & ~SPARSE_VALUE;
+      memcpy(&pns->ar[c], w + 1, sizeof(float));
+      w += 3;
+    } else {
+      pns->ai[c] = *w++;
+      pns->ar[c] = 1.0;
+    }
+    ++c;
+  }
+
+  pns->c = c;
+}
+
 #if defined( HAVE_DLFCN_H )
 
 #include <dlfcn.h>
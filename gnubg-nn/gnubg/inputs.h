@@ -71,4 +71,27 @@ closeInputs(CONST NetInputFuncs* f);
 CONST char*
 genericInputName(unsigned int n);
 
+/* Compact form of an input vector, for keeping the inputs of many
+   positions. Most inputs are 0 or 1: each non zero input is stored as
+   its index, with SPARSE_VALUE set when the input is not 1, in which
+   case the float value follows in the next two words. */
+
+#define SPARSE_VALUE 0x8000
+#define MAX_SPARSE_WORDS (3 * MAX_NUM_INPUTS)
+
+/* Encode arInput in aw, returns the number of words used */
+unsigned int
+SparseInputs(CONST float arInput[], unsigned int nInputs, unsigned short aw[]);
+
+void
+DenseInputs(CONST unsigned short aw[], unsigned int nWords, float arInput[],
+	    unsigned int nInputs);
+
+struct _nnsparse;
+
+/* Decode aw as the list of non zero inputs of NeuralNetEvaluateSparse() */
+void
+SparseInputsList(CONST unsigned short aw[], unsigned int nWords,
+		 struct _nnsparse* pns);
+
 #endif
@@ -573,6 +573,31 @@ NeuralNetDestroy(neuralnet* pnn)
 
 
 
+/* Activity at the hidden nodes from the sums in ar[], and at the output
+   nodes */
+
+static void
+EvaluateOutput(CONST neuralnet* pnn, Intermediate ar[], float arOutput[])
+{
+  int i, j;
+  CONST float* prWeight = pnn->arOutputWeight;
+
+  for( i = 0; i < pnn->cHidden; i++ ) {
+    ar[i] = sigmoid( -pnn->rBetaHidden * ar[i] );
+  }
+  
+  /* Calculate activity at output nodes */
+  
+  for( i = 0; i < pnn->cOutput; i++ ) {
+    float r = pnn->arOutputThreshold[ i ];
+    
+    for( j = 0; j < pnn->cHidden; j++ )
+      r += ar[ j ] * *prWeight++;
+
+    arOutput[ i ] = sigmoid( -pnn->rBetaOutput * r );
+  }
+}
+
 static int
 Evaluate(neuralnet* pnn, float arInput[], Intermediate ar[], float arOutput[],
 	 Intermediate* saveAr)
@@ -612,24 +637,44 @@ Evaluate(neuralnet* pnn, float arInput[], Intermediate ar[], float arOutput[],
   if( saveAr ) {
     memcpy(saveAr, ar, pnn->cHidden * sizeof(*saveAr));
   }
-  
-  for( i = 0; i < pnn->cHidden; i++ ) {
-    ar[i] = sigmoid( -pnn->rBetaHidden * ar[i] );
-  }
-  
-  /* Calculate activity at output nodes */
-  
-  prWeight = pnn->arOutputWeight;
 
-  for( i = 0; i < pnn->cOutput; i++ ) {
-    float r = pnn->arOutputThreshold[ i ];
-    
-    for( j = 0; j < pnn->cHidden; j++ )
-      r += ar[ j ] * *prWeight++;
+  EvaluateOutput(pnn, ar, arOutput);
 
-    arOutput[ i ] = sigmoid( -pnn->rBetaOutput * r );
+  return 0;
+}
+
+/* Same as Evaluate(), from the non zero inputs only. The rows are added
+   in the same order, so the result is exactly the same. */
+
+static int
+EvaluateSparse(CONST neuralnet* pnn, CONST nnsparse* pns, Intermediate ar[],
+	       float arOutput[])
+{
+  int const cHidden = pnn->cHidden;
+  int j, k;
+
+  memcpy(ar, pnn->arHiddenThreshold, cHidden * sizeof(*ar));
+
+  for(k = 0; k < pns->c; ++k) {
+    CONST float* CONST prWeight = pnn->arHiddenWeight + pns->ai[k] * cHidden;
+    float const ark = pns->ar[k];
+
+    {                                   assert( pns->ai[k] < pnn->cInput &&
+						(k == 0 ||
+						 pns->ai[k-1] < pns->ai[k]) ); }
+    if( ark == 1.0 ) {
+      for(j = 0; j < cHidden; ++j) {
+	ar[j] += prWeight[j];
+      }
+    } else {
+      for(j = 0; j < cHidden; ++j) {
+	ar[j] += prWeight[j] * ark;
+      }
+    }
   }
 
+  EvaluateOutput(pnn, ar, arOutput);
+
   return 0;
 }
 
@@ -746,19 +791,25 @@ NeuralNetEvaluate(neuralnet* pnn, float arInput[], float arOutput[]
 }
 
 extern int
-NeuralNetTrain(neuralnet* pnn, float arInput[], float arOutput[],
-	       float arDesired[], float rAlpha)
+NeuralNetEvaluateSparse(neuralnet* pnn, CONST nnsparse* pns, float arOutput[])
 {
-  int i, j;    
   Intermediate ar[ pnn->cHidden ];
   
-  float
-    arOutputError[ pnn->cOutput ],
-    arHiddenError[ pnn->cHidden ],
-    *pr,
-    *prWeight;
+  ++ pnn->nEvals;
+  
+  return EvaluateSparse(pnn, pns, ar, arOutput);
+}
 
-  Evaluate(pnn, arInput, ar, arOutput, 0);
+/* Calculate the errors at the output and hidden nodes of the
+   evaluation in ar[] and arOutput[] */
+
+static void
+Backpropagate(CONST neuralnet* pnn, CONST Intermediate ar[],
+	      CONST float arOutput[], CONST float arDesired[],
+	      float arOutputError[], float arHiddenError[])
+{
+  int i, j;
+  CONST float* prWeight;
 
   /* Calculate error at output nodes */
   for( i = 0; i < pnn->cOutput; i++ )
@@ -777,20 +828,44 @@ NeuralNetTrain(neuralnet* pnn, float arInput[], float arOutput[],
 
   for( i = 0; i < pnn->cHidden; i++ )
     arHiddenError[i] *= pnn->rBetaHidden * ar[i] * (1 - ar[i]);
+}
 
-    /* Adjust weights at output nodes */
-  prWeight = pnn->arOutputWeight;
+/* Adjust weights at output nodes */
 
-  {
-    float a = rAlpha; // rAlpha/pnn->cHidden;
+static void
+TrainOutput(neuralnet* pnn, CONST Intermediate ar[],
+	    CONST float arOutputError[], float rAlpha)
+{
+  int i, j;
+  float* prWeight = pnn->arOutputWeight;
+  float a = rAlpha; // rAlpha/pnn->cHidden;
       
-    for( i = 0; i < pnn->cOutput; i++ ) {
-      for( j = 0; j < pnn->cHidden; j++ )
-	*prWeight++ += a * arOutputError[ i ] * ar[ j ];
+  for( i = 0; i < pnn->cOutput; i++ ) {
+    for( j = 0; j < pnn->cHidden; j++ )
+      *prWeight++ += a * arOutputError[ i ] * ar[ j ];
 
-      pnn->arOutputThreshold[ i ] += a * arOutputError[ i ];
-    }
+    pnn->arOutputThreshold[ i ] += a * arOutputError[ i ];
   }
+}
+
+extern int
+NeuralNetTrain(neuralnet* pnn, float arInput[], float arOutput[],
+	       float arDesired[], float rAlpha)
+{
+  int i, j;    
+  Intermediate ar[ pnn->cHidden ];
+  
+  float
+    arOutputError[ pnn->cOutput ],
+    arHiddenError[ pnn->cHidden ],
+    *pr,
+    *prWeight;
+
+  Evaluate(pnn, arInput, ar, arOutput, 0);
+
+  Backpropagate(pnn, ar, arOutput, arDesired, arOutputError, arHiddenError);
+
+  TrainOutput(pnn, ar, arOutputError, rAlpha);
     
   /* Adjust weights at hidden nodes */
   for( i = 0; i < pnn->cInput; i++ )
@@ -811,6 +886,48 @@ NeuralNetTrain(neuralnet* pnn, float arInput[], float arOutput[],
   return 0;
 }
 
+/* NeuralNetTrain() of the inputs in pns */
+
+extern int
+NeuralNetTrainSparse(neuralnet* pnn, CONST nnsparse* pns, float arOutput[],
+		     float arDesired[], float rAlpha)
+{
+  int const cHidden = pnn->cHidden;
+  int j, k;
+  Intermediate ar[ cHidden ];
+  float arOutputError[ pnn->cOutput ], arHiddenError[ cHidden ];
+
+  EvaluateSparse(pnn, pns, ar, arOutput);
+
+  Backpropagate(pnn, ar, arOutput, arDesired, arOutputError, arHiddenError);
+
+  TrainOutput(pnn, ar, arOutputError, rAlpha);
+
+  /* Adjust weights at hidden nodes */
+  for(k = 0; k < pns->c; ++k) {
+    float* CONST prWeight = pnn->arHiddenWeight + pns->ai[k] * cHidden;
+    float const ark = pns->ar[k];
+
+    if( ark == 1.0 ) {
+      for(j = 0; j < cHidden; ++j) {
+	prWeight[j] += rAlpha * arHiddenError[j];
+      }
+    } else {
+      for(j = 0; j < cHidden; ++j) {
+	prWeight[j] += rAlpha * arHiddenError[j] * ark;
+      }
+    }
+  }
+
+  for(j = 0; j < cHidden; ++j) {
+    pnn->arHiddenThreshold[j] += rAlpha * arHiddenError[j];
+  }
+
+  pnn->nTrained++;
+    
+  return 0;
+}
+
 extern int
 NeuralNetTrainS(neuralnet* pnn, float arInput[], float arOutput[],
 		float arDesired[], float rAlpha, CONST int* tList)
@@ -826,23 +943,7 @@ NeuralNetTrainS(neuralnet* pnn, float arInput[], float arOutput[],
 
   Evaluate(pnn, arInput, ar, arOutput, 0);
 
-  /* Calculate error at output nodes */
-  for( i = 0; i < pnn->cOutput; i++ )
-    arOutputError[ i ] = ( arDesired[ i ] - arOutput[ i ] ) *
-      pnn->rBetaOutput * (arOutput[i] * ( 1 - arOutput[i] ) /*+ 0.1*/);
-
-  /* Calculate error at hidden nodes */
-  for( i = 0; i < pnn->cHidden; i++ )
-    arHiddenError[ i ] = 0.0;
-
-  prWeight = pnn->arOutputWeight;
-    
-  for( i = 0; i < pnn->cOutput; i++ )
-    for( j = 0; j < pnn->cHidden; j++ )
-      arHiddenError[j] += arOutputError[i] * *prWeight++;
-
-  for( i = 0; i < pnn->cHidden; i++ )
-    arHiddenError[i] *= pnn->rBetaHidden * ar[i] * (1 - ar[i]);
+  Backpropagate(pnn, ar, arOutput, arDesired, arOutputError, arHiddenError);
 
   /* Adjust weights at output nodes */
 #if 0
@@ -898,6 +999,236 @@ NeuralNetTrainS(neuralnet* pnn, float arInput[], float arOutput[],
   return 0;
 }
 
+/*
+ * Mini-batch training.
+ *
+ * NeuralNetDeltaAdd() evaluates one position and adds the weight changes
+ * plain training would make (at rate 1) to a delta. The net is not
+ * changed, so several threads can fill their own deltas from the same
+ * net at the same time. The deltas are then summed and applied at once
+ * with NeuralNetApplyDelta().
+ *
+ * Most inputs are zero, so only the rows of the hidden weights of the
+ * inputs actually seen are cleared, summed and applied.
+ */
+
+extern int
+NeuralNetDeltaCreate(neuralnetdelta* pnd, CONST neuralnet* pnn)
+{
+  pnd->cInput = pnn->cInput;
+  pnd->cHidden = pnn->cHidden;
+  pnd->cOutput = pnn->cOutput;
+  pnd->nTrained = 0;
+
+  pnd->arHiddenWeight = calloc(pnn->cInput * pnn->cHidden, sizeof(float));
+  pnd->arOutputWeight = calloc(pnn->cOutput * pnn->cHidden, sizeof(float));
+  pnd->arHiddenThreshold = calloc(pnn->cHidden, sizeof(float));
+  pnd->arOutputThreshold = calloc(pnn->cOutput, sizeof(float));
+  pnd->afInput = calloc(pnn->cInput, sizeof(char));
+
+  if( !(pnd->arHiddenWeight && pnd->arOutputWeight &&
+	pnd->arHiddenThreshold && pnd->arOutputThreshold && pnd->afInput) ) {
+    NeuralNetDeltaDestroy(pnd);
+    errno = ENOMEM;
+    return -1;
+  }
+
+  return 0;
+}
+
+extern void
+NeuralNetDeltaDestroy(neuralnetdelta* pnd)
+{
+  free(pnd->arHiddenWeight); pnd->arHiddenWeight = 0;
+  free(pnd->arOutputWeight); pnd->arOutputWeight = 0;
+  free(pnd->arHiddenThreshold); pnd->arHiddenThreshold = 0;
+  free(pnd->arOutputThreshold); pnd->arOutputThreshold = 0;
+  free(pnd->afInput); pnd->afInput = 0;
+}
+
+extern void
+NeuralNetDeltaClear(neuralnetdelta* pnd)
+{
+  int i;
+
+  for(i = 0; i < pnd->cInput; ++i) {
+    if( pnd->afInput[i] ) {
+      memset(pnd->arHiddenWeight + i * pnd->cHidden, 0,
+	     pnd->cHidden * sizeof(float));
+      pnd->afInput[i] = 0;
+    }
+  }
+
+  memset(pnd->arOutputWeight, 0, pnd->cOutput * pnd->cHidden * sizeof(float));
+  memset(pnd->arHiddenThreshold, 0, pnd->cHidden * sizeof(float));
+  memset(pnd->arOutputThreshold, 0, pnd->cOutput * sizeof(float));
+  
+  pnd->nTrained = 0;
+}
+
+static void
+DeltaOutput(CONST neuralnet* pnn, neuralnetdelta* pnd, CONST Intermediate ar[],
+	    CONST float arOutputError[])
+{
+  int i, j;
+  float* prDelta = pnd->arOutputWeight;
+    
+  for( i = 0; i < pnn->cOutput; i++ ) {
+    float const e = arOutputError[ i ];
+      
+    for( j = 0; j < pnn->cHidden; j++ )
+      *prDelta++ += e * ar[ j ];
+
+    pnd->arOutputThreshold[ i ] += e;
+  }
+}
+
+/* Same changes as NeuralNetTrain(), or NeuralNetTrainS() when tList is
+   set */
+
+extern int
+NeuralNetDeltaAdd(neuralnet* pnn, neuralnetdelta* pnd, float arInput[],
+		  float arOutput[], float arDesired[], CONST int* tList)
+{
+  int i, j, k;
+  Intermediate ar[ pnn->cHidden ];
+  float arOutputError[ pnn->cOutput ], arHiddenError[ pnn->cHidden ];
+  float* prDelta;
+
+  {                                   assert( pnd->cInput == pnn->cInput &&
+					      pnd->cHidden == pnn->cHidden ); }
+
+  Evaluate(pnn, arInput, ar, arOutput, 0);
+
+  Backpropagate(pnn, ar, arOutput, arDesired, arOutputError, arHiddenError);
+
+  if( ! tList ) {
+    DeltaOutput(pnn, pnd, ar, arOutputError);
+  }
+
+  for( k = 0; tList ? tList[k] >= 0 : k < pnn->cInput; ++k ) {
+    float const x = arInput[ i = tList ? tList[k] : k ];
+
+    if( x == 0 ) {
+      continue;
+    }
+
+    prDelta = pnd->arHiddenWeight + i * pnn->cHidden;
+    pnd->afInput[i] = 1;
+    
+    if( x == 1.0 ) {
+      for( j = 0; j < pnn->cHidden; j++ )
+	prDelta[j] += arHiddenError[j];
+    } else {
+      for( j = 0; j < pnn->cHidden; j++ )
+	prDelta[j] += arHiddenError[j] * x;
+    }
+  }
+
+  for( i = 0; i < pnn->cHidden; i++ )
+    pnd->arHiddenThreshold[ i ] += arHiddenError[ i ];
+
+  pnd->nTrained++;
+  
+  return 0;
+}
+
+/* Same changes as NeuralNetTrainSparse() */
+
+extern int
+NeuralNetDeltaAddSparse(neuralnet* pnn, neuralnetdelta* pnd,
+			CONST nnsparse* pns, float arOutput[],
+			float arDesired[])
+{
+  int const cHidden = pnn->cHidden;
+  int j, k;
+  Intermediate ar[ cHidden ];
+  float arOutputError[ pnn->cOutput ], arHiddenError[ cHidden ];
+
+  {                                   assert( pnd->cInput == pnn->cInput &&
+					      pnd->cHidden == cHidden ); }
+
+  EvaluateSparse(pnn, pns, ar, arOutput);
+
+  Backpropagate(pnn, ar, arOutput, arDesired, arOutputError, arHiddenError);
+
+  DeltaOutput(pnn, pnd, ar, arOutputError);
+
+  for(k = 0; k < pns->c; ++k) {
+    int const i = pns->ai[k];
+    float* CONST prDelta = pnd->arHiddenWeight + i * cHidden;
+    float const ark = pns->ar[k];
+
+    pnd->afInput[i] = 1;
+    
+    if( ark == 1.0 ) {
+      for(j = 0; j < cHidden; ++j)
+	prDelta[j] += arHiddenError[j];
+    } else {
+      for(j = 0; j < cHidden; ++j)
+	prDelta[j] += arHiddenError[j] * ark;
+    }
+  }
+
+  for(j = 0; j < cHidden; ++j)
+    pnd->arHiddenThreshold[j] += arHiddenError[j];
+
+  pnd->nTrained++;
+  
+  return 0;
+}
+
+extern void
+NeuralNetDeltaSum(neuralnetdelta* pnd, CONST neuralnetdelta* pndAdd)
+{
+  int i, j;
+
+  for(i = 0; i < pnd->cInput; ++i) {
+    if( pndAdd->afInput[i] ) {
+      float* pr = pnd->arHiddenWeight + i * pnd->cHidden;
+      CONST float* prAdd = pndAdd->arHiddenWeight + i * pnd->cHidden;
+      
+      for(j = 0; j < pnd->cHidden; ++j)
+	pr[j] += prAdd[j];
+      pnd->afInput[i] = 1;
+    }
+  }
+
+  for(i = 0; i < pnd->cOutput * pnd->cHidden; ++i)
+    pnd->arOutputWeight[i] += pndAdd->arOutputWeight[i];
+  for(i = 0; i < pnd->cHidden; ++i)
+    pnd->arHiddenThreshold[i] += pndAdd->arHiddenThreshold[i];
+  for(i = 0; i < pnd->cOutput; ++i)
+    pnd->arOutputThreshold[i] += pndAdd->arOutputThreshold[i];
+
+  pnd->nTrained += pndAdd->nTrained;
+}
+
+extern void
+NeuralNetApplyDelta(neuralnet* pnn, CONST neuralnetdelta* pnd, float rAlpha)
+{
+  int i, j;
+
+  for(i = 0; i < pnn->cInput; ++i) {
+    if( pnd->afInput[i] ) {
+      float* pr = pnn->arHiddenWeight + i * pnn->cHidden;
+      CONST float* prDelta = pnd->arHiddenWeight + i * pnn->cHidden;
+      
+      for(j = 0; j < pnn->cHidden; ++j)
+	pr[j] += rAlpha * prDelta[j];
+    }
+  }
+
+  for(i = 0; i < pnn->cOutput * pnn->cHidden; ++i)
+    pnn->arOutputWeight[i] += rAlpha * pnd->arOutputWeight[i];
+  for(i = 0; i < pnn->cHidden; ++i)
+    pnn->arHiddenThreshold[i] += rAlpha * pnd->arHiddenThreshold[i];
+  for(i = 0; i < pnn->cOutput; ++i)
+    pnn->arOutputThreshold[i] += rAlpha * pnd->arOutputThreshold[i];
+
+  pnn->nTrained += pnd->nTrained;
+}
+
 extern int
 NeuralNetResize(neuralnet* pnn, int cInput, int cHidden, int cOutput)
 {
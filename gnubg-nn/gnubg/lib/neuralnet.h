@@ -67,12 +67,56 @@ typedef enum  {
 
 extern int NeuralNetEvaluate( neuralnet *pnn, float arInput[],
 			      float arOutput[] /*, NNEvalType t*/);
+
+/* The non zero inputs of a position, in increasing index order. Most
+   inputs are 0, and the sparse functions only read (and train) the
+   hidden weights of the others. */
+
+#define NN_SPARSE_MAX 512
+
+typedef struct _nnsparse {
+  int c;
+  unsigned short ai[NN_SPARSE_MAX];
+  float ar[NN_SPARSE_MAX];
+} nnsparse;
+
+extern int NeuralNetEvaluateSparse( neuralnet *pnn, CONST nnsparse *pns,
+				    float arOutput[] );
+extern int NeuralNetTrainSparse( neuralnet *pnn, CONST nnsparse *pns,
+				 float arOutput[], float arDesired[],
+				 float rAlpha );
 extern int NeuralNetTrain( neuralnet *pnn, float arInput[], float arOutput[],
 			   float arDesired[], float rAlpha );
 extern int
 NeuralNetTrainS(neuralnet* pnn, float arInput[], float arOutput[],
 		float arDesired[], float rAlpha, CONST int* tList);
 
+/* Weight changes of a mini-batch, laid out as in the net */
+typedef struct _neuralnetdelta {
+  int cInput, cHidden, cOutput;
+  unsigned int nTrained;
+  
+  float *arHiddenWeight, *arOutputWeight,
+	*arHiddenThreshold, *arOutputThreshold;
+
+  /* inputs with changes in arHiddenWeight */
+  char* afInput;
+} neuralnetdelta;
+
+extern int NeuralNetDeltaCreate( neuralnetdelta *pnd, CONST neuralnet *pnn );
+extern void NeuralNetDeltaDestroy( neuralnetdelta *pnd );
+extern void NeuralNetDeltaClear( neuralnetdelta *pnd );
+extern int NeuralNetDeltaAdd( neuralnet *pnn, neuralnetdelta *pnd,
+			      float arInput[], float arOutput[],
+			      float arDesired[], CONST int* tList );
+extern int NeuralNetDeltaAddSparse( neuralnet *pnn, neuralnetdelta *pnd,
+				    CONST nnsparse *pns, float arOutput[],
+				    float arDesired[] );
+extern void NeuralNetDeltaSum( neuralnetdelta *pnd,
+			       CONST neuralnetdelta *pndAdd );
+extern void NeuralNetApplyDelta( neuralnet *pnn, CONST neuralnetdelta *pnd,
+				 float rAlpha );
+
 extern int NeuralNetResize( neuralnet *pnn, int cInput, int cHidden,
 			    int cOutput );
 
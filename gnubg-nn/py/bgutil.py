@@ -165,6 +165,20 @@ def readData(name) :
     print >> sys.stderr, "failed to read",name
     sys.exit(1)
 
+def isTrainSet(name) :
+  """ True if name is a binary training set (see gnubg.trainset) """
+  try :
+    return file(name, 'rb').read(8) == "gnubgTS\0"
+  except:
+    return 0
+
+def trainingData(name) :
+  """ Data for gnubg.trainer: a binary training set is passed by name (and
+  mapped into memory), a text file is read. """
+  if isTrainSet(name) :
+    return name
+  return readData(name)
+
 def readPly(name) :
   try :
     return int(name)
@@ -29,6 +29,7 @@
 #include "stdutil.h"
 
 #include <analyze.h>
+#include <danalyze.h>
 #include <bm.h>
 #include <player.h>
 #include <equities.h>
@@ -1067,6 +1068,12 @@ gnubg_trainer(PyObject*, PyObject* const args)
   return newTrainer(args);
 }
 
+static PyObject*
+gnubg_trainset(PyObject*, PyObject* const args)
+{
+  return writeTrainSet(args);
+}
+
 
 static PyObject*
 gnubg_ocr(PyObject*, PyObject* const args)
@@ -1133,6 +1140,11 @@ static PyMethodDef gnubg_methods[] = {
   {"trainer",		gnubg_trainer, METH_VARARGS,
    "Create trainer"},
 
+  {"trainset",		gnubg_trainset, METH_VARARGS,
+   "trainset(dat-file, file [, inputs, prune]): convert training data to a\n"
+   "binary training set, which gnubg.trainer() maps instead of parsing it.\n"
+   "With inputs, the inputs of the current (pruning) nets are kept too."},
+
   {"onecrace",		gnubg_ocr, METH_VARARGS,
    "One Chequer Race"},
 
@@ -1347,6 +1359,26 @@ set_cube(PyObject*, PyObject* const args)
   Py_INCREF(Py_None);
   return Py_None;
 }
+
+static PyObject*
+set_movescache(PyObject*, PyObject* const args)
+{
+  long size;
+  
+  if( !PyArg_ParseTuple(args, "l", &size) ) {
+    return 0;
+  }
+
+  if( size < 0 ) {
+    PyErr_SetString(PyExc_ValueError, "negative size");
+    return 0;
+  }
+
+  setMovesCacheSize(size);
+  
+  Py_INCREF(Py_None);
+  return Py_None;
+}
   
 
 static PyMethodDef gnubg_set_methods[] = {
@@ -1371,6 +1403,9 @@ static PyMethodDef gnubg_set_methods[] = {
   {"cube",	set_cube,	METH_VARARGS,
    "Set match cube" },
 
+  {"movescache",	set_movescache,	METH_VARARGS,
+   "Set memory (bytes) of the cubeful analysis moves cache" },
+
   {0,		0, 0, 0}		/* sentinel */
 };
 
@@ -23,32 +23,21 @@
 #include "config.h"
 #endif
 
+#include <pthread.h>
+#include <algorithm>
+
 extern "C" {
 #include <positionid.h>
 #include <eval.h>
+#include <inputs.h>
+#include <neuralnet.h>
 }
 
 #include "pytrainer.h"
+#include "trainset.h"
 #include "defs.h"
 
 namespace {
-inline unsigned char*
-auchFromSring(const char* const s)
-{
-  static unsigned char auch[10];
-
-#if !defined( NDEBUG )
-  for(uint i = 0; i < 20; ++i) {
-    assert('A' <= s[i] && s[i] < 'A' + 16);
-  }
-#endif
-  
-  for(uint i = 0; i < 10; ++i) {
-    auch[i] = ((s[2*i+0] - 'A') << 4) +  (s[2*i+1] - 'A');
-  }
-  return auch;
-}
-
 inline double
 eqAbsErr(const float* const p1, const float* const p2)
 {
@@ -72,15 +61,146 @@ eqErr(const float* const p1, const float* const p2)
 
 }
 
-struct DataPosition {
-  unsigned char	auch[10];
+namespace {
+// Weight changes of one thread in a mini-batch, one delta per net trained
+class NetDeltas {
+public:
+  NetDeltas(void) : nNets(0) {}
+  
+  ~NetDeltas() {
+    for(uint k = 0; k < nNets; ++k) {
+      NeuralNetDeltaDestroy(&deltas[k]);
+    }
+  }
+
+  neuralnetdelta* get(neuralnet* net);
+
+  // add the changes of 'from' to ours and clear them
+  void		collect(NetDeltas& from);
+  
+  // apply our changes and clear them
+  void		apply(double a);
+  
+  uint			nNets;
+  neuralnet*		nets[N_CLASSES];
+  neuralnetdelta	deltas[N_CLASSES];
+};
+
+neuralnetdelta*
+NetDeltas::get(neuralnet* const net)
+{
+  for(uint k = 0; k < nNets; ++k) {
+    if( nets[k] == net ) {
+      return &deltas[k];
+    }
+  }
+  
+  if( nNets == N_CLASSES || NeuralNetDeltaCreate(&deltas[nNets], net) < 0 ) {
+    return 0;
+  }
+  nets[nNets] = net;
+  
+  return &deltas[nNets++];
+}
+
+void
+NetDeltas::collect(NetDeltas& from)
+{
+  for(uint k = 0; k < from.nNets; ++k) {
+    if( neuralnetdelta* const d = get(from.nets[k]) ) {
+      NeuralNetDeltaSum(d, &from.deltas[k]);
+    }
+    NeuralNetDeltaClear(&from.deltas[k]);
+  }
+}
+
+void
+NetDeltas::apply(double const a)
+{
+  for(uint k = 0; k < nNets; ++k) {
+    if( deltas[k].nTrained ) {
+      NeuralNetApplyDelta(nets[k], &deltas[k], TrainRate(nets[k], a));
+      NeuralNetDeltaClear(&deltas[k]);
+    }
+  }
+}
+
+class Barrier {
+public:
+  Barrier(uint const n) :
+    n(n),
+    count(0),
+    generation(0)
+    {
+      pthread_mutex_init(&lock, 0);
+      pthread_cond_init(&cond, 0);
+    }
+
+  ~Barrier() {
+    pthread_cond_destroy(&cond);
+    pthread_mutex_destroy(&lock);
+  }
+
+  void	wait(void);
 
-  float		probs[5];
+  // one thread less will wait from now on
+  void	leave(void);
+  
+private:
+  void	release(void);
+  
+  uint			n;
+  uint			count;
+  uint			generation;
+  pthread_mutex_t	lock;
+  pthread_cond_t	cond;
 };
 
+void
+Barrier::release(void)
+{
+  count = 0;
+  ++generation;
+  pthread_cond_broadcast(&cond);
+}
+
+void
+Barrier::wait(void)
+{
+  pthread_mutex_lock(&lock);
+  
+  uint const g = generation;
+  if( ++count == n ) {
+    release();
+  } else {
+    while( g == generation ) {
+      pthread_cond_wait(&cond, &lock);
+    }
+  }
+  
+  pthread_mutex_unlock(&lock);
+}
+
+void
+Barrier::leave(void)
+{
+  pthread_mutex_lock(&lock);
+  
+  if( --n == count && count > 0 ) {
+    release();
+  }
+  
+  pthread_mutex_unlock(&lock);
+}
+}
+
+typedef int Board[2][25];
+
 class Trainer {
 public:
-  Trainer(uint n);
+  // The trainer owns the positions, or the training set they are in.
+  Trainer(uint n, DataPosition* positions);
+  Trainer(TrainSet* set);
   
   ~Trainer();
 
@@ -134,46 +254,206 @@ public:
   void	errors(Errors& e) const;
   
   void	train(double a, const int* order) const;
+
+  // Train on nThreads threads. Each batch of positions is evaluated with
+  // the same weights, and the weight changes are summed (always in the
+  // same order) and applied at the end of the batch. With hogwild, the
+  // threads train their share of the positions directly on the net,
+  // without any locking.
+  void	train(double a, const int* order, uint batch, uint nThreads,
+	      bool hogwild) const;
+
+  // Positions from..to-1 (of order)
+  void	trainPositions(double a, const int* order, uint from, uint to,
+		       const PositionInputs* inputs) const;
+
+  // Add the weight changes of position k to deltas
+  void	addPosition(uint k, NetDeltas& deltas,
+		    const PositionInputs* inputs) const;
+
+  // Net to train position k with, its inputs and desired outputs. The
+  // inputs are taken from 'inputs' when there are some.
+  neuralnet*	positionInputs(uint k, float p[5], float* arInput,
+			       const PositionInputs* inputs) const;
+
+  // Same, with the precomputed inputs (which must be set) as the list
+  // of the sparse training functions
+  neuralnet*	sparseInputs(uint k, float p[5], nnsparse& ns,
+			     const PositionInputs& inputs) const;
+
+  // Precomputed inputs which can be used with the current nets, or 0
+  const PositionInputs*	inputs(void) const;
+
+  // Compute the inputs of all positions now, for the following epochs.
+  // Returns the memory used (0 when the training set has its inputs).
+  size_t	cacheInputs(void);
   
   uint			nPositions;
-  DataPosition*		positions;
+  const DataPosition*	positions;
 
   bool			ignoreBGs;
   bool			pruneNet;
   int*			tList;
+
+private:
+  // Desired outputs of position k
+  void		desired(uint k, float p[5],
+			const PositionInputs* inputs) const;
+
+  DataPosition*		ownPositions;
+  TrainSet*		set;
+  InputCache*		cache;
 };
 
-Trainer::Trainer(uint const n) :
+Trainer::Trainer(uint const n, DataPosition* const positions) :
   nPositions(n),
-  positions(new DataPosition [nPositions]),
+  positions(positions),
   ignoreBGs(false),
   pruneNet(false),
-  tList(0)
+  tList(0),
+  ownPositions(positions),
+  set(0),
+  cache(0)
+{}
+
+Trainer::Trainer(TrainSet* const set) :
+  nPositions(set->nPositions),
+  positions(set->positions),
+  ignoreBGs(false),
+  pruneNet(false),
+  tList(0),
+  ownPositions(0),
+  set(set),
+  cache(0)
 {}
 
 Trainer::~Trainer()
 {
-  delete [] positions;
+  delete cache;
+  delete [] ownPositions;
+  delete set;
   delete [] tList;
 }
 
-typedef int Board[2][25];
+const PositionInputs*
+Trainer::inputs(void) const
+{
+  const PositionInputs* in = cache ? cache->inputs(pruneNet) : 0;
+
+  if( ! in && set ) {
+    in = set->inputs(pruneNet);
+  }
+  return in;
+}
+
+size_t
+Trainer::cacheInputs(void)
+{
+  delete cache;
+  cache = 0;
+  
+  if( set && set->inputs(pruneNet) ) {
+    return 0;
+  }
+
+  cache = new InputCache(positions, nPositions, pruneNet);
+  
+  return cache->size();
+}
+
+void
+Trainer::desired(uint const k, float p[5],
+		 const PositionInputs* const inputs) const
+{
+  const float* const probs =
+    inputs && inputs->probs ? inputs->probs[k] : positions[k].probs;
+
+  for(uint i = 0; i < 5; ++i) {
+    p[i] = probs[i];
+  }
+  
+  if( ignoreBGs ) {
+    p[2] = p[4] = 0.0;
+  }
+}
+
+neuralnet*
+Trainer::positionInputs(uint const k, float p[5], float* const arInput,
+			const PositionInputs* const inputs) const
+{
+  DataPosition const& t = positions[k];
+
+  desired(k, p, inputs);
+
+  if( inputs ) {
+    uint const pc = inputs->classes[k];
+
+    if( pc == PositionInputs::NO_CLASS ) {
+      return 0;
+    }
+    
+    neuralnet* const nn = TrainNet(pc, pruneNet);
+    uint64_t const i = inputs->offsets[k];
+    
+    DenseInputs(inputs->words + i, inputs->offsets[k+1] - i, arInput,
+		nn->cInput);
+    return nn;
+  }
+  
+  Board board;
+  PositionFromKey(board, const_cast<unsigned char*>(t.auch));
+
+  return TrainPositionInputs(board, p, pruneNet, arInput);
+}
+
+neuralnet*
+Trainer::sparseInputs(uint const k, float p[5], nnsparse& ns,
+		      const PositionInputs& inputs) const
+{
+  uint const pc = inputs.classes[k];
+
+  if( pc == PositionInputs::NO_CLASS ) {
+    return 0;
+  }
+    
+  desired(k, p, &inputs);
+
+  uint64_t const i = inputs.offsets[k];
+  
+  SparseInputsList(inputs.words + i, inputs.offsets[k+1] - i, &ns);
+
+  return TrainNet(pc, pruneNet);
+}
 
 void
 Trainer::errors(Errors& e) const
 {
   Board board;
-  float p[5];
+  float p[5], arInput[MAX_NUM_INPUTS];
+  const PositionInputs* const in = inputs();
 
   for(uint k = 0; k < nPositions; ++k) {
     DataPosition const& t = positions[k];
     
     PositionFromKey(board, const_cast<unsigned char*>(t.auch));
 
-    if( pruneNet ) {
-      evalPrune(board, p);
-    } else {
-      EvaluatePositionFast(board, p);
+    uint const pc = in ? in->classes[k] : uint(PositionInputs::NO_CLASS);
+    bool done = false;
+    
+    if( pc != PositionInputs::NO_CLASS ) {
+      uint64_t const i = in->offsets[k];
+      
+      DenseInputs(in->words + i, in->offsets[k+1] - i, arInput,
+		  TrainNet(pc, pruneNet)->cInput);
+      done = EvaluatePositionInputs(board, pc, pruneNet, arInput, p) == 0;
+    }
+    
+    if( ! done ) {
+      if( pruneNet ) {
+	evalPrune(board, p);
+      } else {
+	EvaluatePositionFast(board, p);
+      }
     }
 
     e.add_eq(eqErr(p, t.probs));
@@ -187,31 +467,166 @@ Trainer::errors(Errors& e) const
 void
 Trainer::train(double const a, const int* const order) const
 {
-  Board board;
+  trainPositions(a, order, 0, nPositions, inputs());
+}
 
-  for(uint k = 0; k < nPositions; ++k) {
-    DataPosition const& t = positions[order ? order[k] : k];
+void
+Trainer::trainPositions(double const a, const int* const order,
+			uint const from, uint const to,
+			const PositionInputs* const inputs) const
+{
+  float p[5], arInput[MAX_NUM_INPUTS], arOutput[NUM_OUTPUTS];
+  nnsparse ns;
+
+  // precomputed inputs are trained from the non zero inputs only,
+  // unless only some inputs are trained (tList)
+  bool const sparse = inputs && (pruneNet || ! tList);
+  
+  for(uint k = from; k < to; ++k) {
+    uint const i = order ? order[k] : k;
+    neuralnet* const nn = sparse ? sparseInputs(i, p, ns, *inputs) :
+      positionInputs(i, p, arInput, inputs);
+
+    if( ! nn ) {
+      continue;
+    }
+
+    {                                      assert( ! pruneNet || a > 0 ); }
+    float const r = pruneNet ? a : TrainRate(nn, a);
     
-    PositionFromKey(board, const_cast<unsigned char*>(t.auch));
+    if( sparse ) {
+      NeuralNetTrainSparse(nn, &ns, arOutput, p, r);
+    } else if( pruneNet || ! tList ) {
+      NeuralNetTrain(nn, arInput, arOutput, p, r);
+    } else {
+      NeuralNetTrainS(nn, arInput, arOutput, p, r, tList);
+    }
+  }
+}
 
-    if( ignoreBGs ) {
-      float p[5] = {t.probs[0], t.probs[1], 0.0, t.probs[3], 0.0};
-      if( pruneNet ) {
-	PruneTrainPosition(board, p, a);
-      } else {
-	TrainPosition(board, p, a, tList);
+void
+Trainer::addPosition(uint const k, NetDeltas& deltas,
+		     const PositionInputs* const inputs) const
+{
+  float p[5], arInput[MAX_NUM_INPUTS], arOutput[NUM_OUTPUTS];
+  const int* const l = pruneNet ? 0 : tList;
+
+  if( inputs && ! l ) {
+    nnsparse ns;
+    
+    if( neuralnet* const nn = sparseInputs(k, p, ns, *inputs) ) {
+      if( neuralnetdelta* const d = deltas.get(nn) ) {
+	NeuralNetDeltaAddSparse(nn, d, &ns, arOutput, p);
       }
-    } else {
-      if( pruneNet ) {
-	PruneTrainPosition(board, const_cast<float*>(t.probs), a);
-      } else {
-	TrainPosition(board, const_cast<float*>(t.probs), a, tList);
+    }
+  } else if( neuralnet* const nn = positionInputs(k, p, arInput, inputs) ) {
+    if( neuralnetdelta* const d = deltas.get(nn) ) {
+      NeuralNetDeltaAdd(nn, d, arInput, arOutput, p, l);
+    }
+  }
+}
+
+namespace {
+struct TrainContext {
+  const Trainer*	trainer;
+  double		a;
+  const int*		order;
+  uint			batch;
+  uint			nThreads;
+  bool			hogwild;
+  NetDeltas*		deltas;		// one per thread
+  Barrier*		barrier;
+  const PositionInputs*	inputs;
+};
+
+struct TrainThread {
+  TrainContext*		context;
+  uint			index;
+};
+
+void
+trainShare(TrainContext& c, uint const index)
+{
+  Trainer const& t = *c.trainer;
+
+  // wait for all threads to be created (c.nThreads is final then)
+  c.barrier->wait();
+  
+  if( c.hogwild ) {
+    t.trainPositions(c.a, c.order,
+		     (t.nPositions * index) / c.nThreads,
+		     (t.nPositions * (index + 1)) / c.nThreads, c.inputs);
+    return;
+  }
+
+  for(uint b = 0; b < t.nPositions; b += c.batch) {
+    uint const n = std::min(c.batch, t.nPositions - b);
+    uint const to = b + (n * (index + 1)) / c.nThreads;
+    
+    for(uint k = b + (n * index) / c.nThreads; k < to; ++k) {
+      t.addPosition(c.order ? c.order[k] : k, c.deltas[index], c.inputs);
+    }
+
+    c.barrier->wait();
+
+    if( index == 0 ) {
+      for(uint i = 1; i < c.nThreads; ++i) {
+	c.deltas[0].collect(c.deltas[i]);
       }
+      c.deltas[0].apply(c.a);
     }
+    
+    c.barrier->wait();
   }
 }
 
+void*
+trainThread(void* const p)
+{
+  TrainThread* const tt = static_cast<TrainThread*>(p);
+  trainShare(*tt->context, tt->index);
+  return 0;
+}
+}
+
+void
+Trainer::train(double const a, const int* const order, uint const batch,
+	       uint const nThreads, bool const hogwild) const
+{
+  Barrier barrier(nThreads);
+  NetDeltas* const deltas = new NetDeltas [nThreads];
+  TrainThread* const threads = new TrainThread [nThreads];
+  pthread_t* const ids = new pthread_t [nThreads];
+  
+  TrainContext c = {this, a, order, std::max(batch, 1U), nThreads, hogwild,
+		    deltas, &barrier, inputs()};
+
+  uint n = 1;
+  for(/**/; n < nThreads; ++n) {
+    threads[n].context = &c;
+    threads[n].index = n;
+    
+    if( pthread_create(&ids[n], 0, trainThread, &threads[n]) != 0 ) {
+      break;
+    }
+  }
+
+  // go on with the threads we have
+  c.nThreads = n;
+  for(uint k = n; k < nThreads; ++k) {
+    barrier.leave();
+  }
 
+  trainShare(c, 0);
+  
+  for(uint k = 1; k < n; ++k) {
+    pthread_join(ids[k], 0);
+  }
+
+  delete [] ids;
+  delete [] threads;
+  delete [] deltas;
+}
 
 struct TrainerObject : PyObject {
   Trainer*	trainer;
@@ -230,13 +645,30 @@ trainer_errors(PyObject* self, PyObject*);
 static PyObject*
 trainer_train(PyObject* self, PyObject* args);
 
+static PyObject*
+trainer_size(PyObject* self, PyObject*);
+
+static PyObject*
+trainer_cacheInputs(PyObject* self, PyObject*);
+
 
 static PyMethodDef trainer_methods[] = {
   {"errors",	trainer_errors, METH_NOARGS,
    ""},
 
   {"train",	trainer_train, METH_VARARGS,
-   ""},
+   "train(alpha [, order, threads, batch, hogwild]): one pass over the\n"
+   "positions. With more than one thread or a batch size, the positions\n"
+   "are trained in batches (64 per thread by default), or directly by\n"
+   "each thread with hogwild."},
+
+  {"size",	trainer_size, METH_NOARGS,
+   "Number of positions."},
+
+  {"cacheinputs", trainer_cacheInputs, METH_NOARGS,
+   "Compute the net inputs of all positions once, to speed up the\n"
+   "following train() and errors(). Returns the memory used. The cache is\n"
+   "not used once the nets use other input functions."},
   
   {0,0,0,0}		/* sentinel */
 };
@@ -320,6 +752,29 @@ trainer_errors(PyObject* self, PyObject*)
 		       e.noBGerror, e.maxNoBGerror);
 }
 
+static PyObject*
+trainer_size(PyObject* self, PyObject*)
+{
+  {                                 assert( self->ob_type == &Trainer_Type ); }
+
+  return PyInt_FromLong(static_cast<TrainerObject*>(self)->trainer->nPositions);
+}
+
+static PyObject*
+trainer_cacheInputs(PyObject* self, PyObject*)
+{
+  {                                 assert( self->ob_type == &Trainer_Type ); }
+
+  Trainer& t = *static_cast<TrainerObject*>(self)->trainer;
+  size_t n;
+
+  Py_BEGIN_ALLOW_THREADS
+  n = t.cacheInputs();
+  Py_END_ALLOW_THREADS
+  
+  return PyLong_FromUnsignedLongLong(n);
+}
+
 static PyObject*
 trainer_train(PyObject* self, PyObject* args)
 {
@@ -329,15 +784,23 @@ trainer_train(PyObject* self, PyObject* args)
   
   double a;
   PyObject* porder = 0;
+  int nThreads = 1;
+  int batch = 0;
+  int hogwild = 0;
   
-  if( !PyArg_ParseTuple(args, "d|O", &a, &porder) ) {
+  if( !PyArg_ParseTuple(args, "d|Oiii", &a, &porder, &nThreads, &batch,
+			&hogwild) ) {
     PyErr_SetString(PyExc_ValueError, "wrong args.") ;
     return 0;
   }
 
+  if( nThreads < 1 || batch < 0 ) {
+    PyErr_SetString(PyExc_ValueError, "invalid threads or batch.") ;
+    return 0;
+  }
 
   int* order = 0;
-  if( porder ) {
+  if( porder && porder != Py_None ) {
     if( !(PySequence_Check(porder) &&
 	  PySequence_Size(porder) == int(t.nPositions))) {
 
@@ -353,7 +816,13 @@ trainer_train(PyObject* self, PyObject* args)
     }
   }
   
-  t.train(a, order);
+  if( nThreads == 1 && ! batch ) {
+    t.train(a, order);
+  } else {
+    Py_BEGIN_ALLOW_THREADS
+    t.train(a, order, batch ? batch : 64 * nThreads, nThreads, hogwild);
+    Py_END_ALLOW_THREADS
+  }
 
   delete [] order;
   
@@ -362,6 +831,60 @@ trainer_train(PyObject* self, PyObject* args)
 }
 
 
+namespace {
+// Training data lines of data, 0 if one is not valid
+DataPosition*
+readPositions(PyObject* const data)
+{
+  uint const nTrain = PySequence_Size(data);
+  DataPosition* const positions = new DataPosition [nTrain];
+  
+  for(uint k = 0; k < nTrain; ++k) {
+    PyObject* const pl = PySequence_Fast_GET_ITEM(data, k);
+    if( ! (pl && PyString_Check(pl)) ) {
+      PyErr_SetString(PyExc_ValueError, "not a string.") ;
+      delete [] positions;
+      return 0;
+    }
+
+    const char* const l = PyString_AS_STRING(pl);
+
+    if( ! parsePosition(l, positions[k]) ) {
+      PyErr_Format(PyExc_ValueError, "invalid position (%s).", l);
+      delete [] positions;
+      return 0;
+    }
+  }
+
+  return positions;
+}
+
+Trainer*
+openTrainer(PyObject* const data)
+{
+  if( PyString_Check(data) ) {
+    const char* const name = PyString_AS_STRING(data);
+    TrainSet* const set = new TrainSet;
+    
+    if( const char* const err = set->open(name) ) {
+      PyErr_Format(PyExc_IOError, "%s: %s.", name, err);
+      delete set;
+      return 0;
+    }
+    return new Trainer(set);
+  }
+  
+  if( ! PySequence_Check(data) ) {
+    PyErr_SetString(PyExc_ValueError, "not a list or a file name.") ;
+    return 0;
+  }
+
+  DataPosition* const positions = readPositions(data);
+  
+  return positions ? new Trainer(PySequence_Size(data), positions) : 0;
+}
+}
+
 PyObject*
 newTrainer(PyObject* const args)
 {
@@ -374,21 +897,23 @@ newTrainer(PyObject* const args)
     return 0;
   }
 
-  if( ! PySequence_Check(data) ) {
+  if( tList && ! PySequence_Check(tList) ) {
+    PyErr_SetString(PyExc_ValueError, "not a list.") ;
     return 0;
   }
   
-  uint const nTrain = PySequence_Size(data);
-  Trainer& t = *(new Trainer(nTrain));
+  Trainer* const pt = openTrainer(data);
+
+  if( ! pt ) {
+    return 0;
+  }
+  
+  Trainer& t = *pt;
 
   t.ignoreBGs = flag;
   t.pruneNet = prune;
 
   if( tList ) {
-    if( ! PySequence_Check(tList) ) {
-      PyErr_SetString(PyExc_ValueError, "not a list.") ;
-      return 0;
-    }
     if( uint const s = PySequence_Size(tList) ) {
       t.tList = new int [s+1];
 
@@ -399,41 +924,37 @@ newTrainer(PyObject* const args)
       t.tList[s] = -1;
     }
   }
-  
-  for(uint k = 0; k < nTrain; ++k) {
-    DataPosition& p = t.positions[k];
-
-    PyObject* const pl = PySequence_Fast_GET_ITEM(data, k);
-    if( ! (pl && PyString_Check(pl)) ) {
-      return 0;
-    }
-
-    const char* l = PyString_AS_STRING(pl);
 
-    if( strlen(l) < 20 ) {
-      PyErr_Format(PyExc_ValueError, "invalid pos id (%s).", l);
-      delete &t;
-      return 0;
-    }
-      
-    char id[20];
+  TrainerObject* o = PyObject_New(TrainerObject, &Trainer_Type);
+  o->trainer = &t;
+  
+  return o;
+}
 
-    strncpy(id, l, sizeof(id));
+PyObject*
+writeTrainSet(PyObject* const args)
+{
+  char* datName;
+  char* fileName;
+  int withInputs = 0;
+  int prune = 0;
+  
+  if( !PyArg_ParseTuple(args, "ss|ii", &datName, &fileName, &withInputs,
+			&prune) ) {
+    return 0;
+  }
 
-    memcpy(p.auch, auchFromSring(id), sizeof(p.auch));
+  const char* err;
+  
+  Py_BEGIN_ALLOW_THREADS
+  err = writeTrainSet(datName, fileName, withInputs, prune);
+  Py_END_ALLOW_THREADS
 
-    l += 20;
-    {
-      char* endp = 0;
-      for(uint j = 0; j < 5; ++j) {
-	p.probs[j] = strtod(l, &endp);
-	l = endp;
-      }
-    }
+  if( err ) {
+    PyErr_Format(PyExc_IOError, "%s: %s.", fileName, err);
+    return 0;
   }
-
-  TrainerObject* o = PyObject_New(TrainerObject, &Trainer_Type);
-  o->trainer = &t;
   
-  return o;
+  Py_INCREF(Py_None);
+  return Py_None;
 }
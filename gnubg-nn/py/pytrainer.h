@@ -26,4 +26,7 @@
 extern PyObject*
 newTrainer(PyObject* const args);
 
+extern PyObject*
+writeTrainSet(PyObject* const args);
+
 #endif
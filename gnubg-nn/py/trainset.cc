@@ -0,0 +1,598 @@
+/*
+ * trainset.cc
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#if HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <assert.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
+#include <vector>
+
+extern "C" {
+#include <positionid.h>
+#include <eval.h>
+#include <inputs.h>
+#include <neuralnet.h>
+}
+
+#include "trainset.h"
+#include "defs.h"
+
+namespace {
+inline bool
+auchFromString(const char* const s, unsigned char auch[10])
+{
+  for(uint i = 0; i < 20; ++i) {
+    if( !('A' <= s[i] && s[i] < 'A' + 16) ) {
+      return false;
+    }
+  }
+
+  for(uint i = 0; i < 10; ++i) {
+    auch[i] = ((s[2*i+0] - 'A') << 4) +  (s[2*i+1] - 'A');
+  }
+  return true;
+}
+
+inline uint64_t
+align8(uint64_t const n)
+{
+  return (n + 7) & ~uint64_t(7);
+}
+
+bool
+writeData(FILE* const f, const void* const p, size_t const n, uint64_t& pos)
+{
+  if( n && fwrite(p, n, 1, f) != 1 ) {
+    return false;
+  }
+  pos += n;
+  return true;
+}
+
+bool
+pad8(FILE* const f, uint64_t& pos)
+{
+  static const char zeros[8] = {0};
+
+  return writeData(f, zeros, align8(pos) - pos, pos);
+}
+
+// true if count items of itemSize bytes at offset are within size bytes
+inline bool
+inFile(uint64_t const offset, uint64_t const count, uint64_t const itemSize,
+       uint64_t const size)
+{
+  return offset <= size && count <= (size - offset) / itemSize;
+}
+
+// true if the n words at w are a complete sparse encoding of at most
+// NN_SPARSE_MAX inputs, all less than nInputs
+bool
+validInputs(const unsigned short* const w, uint64_t const n,
+	    uint const nInputs)
+{
+  uint c = 0;
+
+  for(uint64_t i = 0; i < n; ++c) {
+    if( c == NN_SPARSE_MAX || uint(w[i] & ~SPARSE_VALUE) >= nInputs ) {
+      return false;
+    }
+
+    if( w[i] & SPARSE_VALUE ) {
+      if( n - i < 3 ) {
+	return false;
+      }
+      i += 3;
+    } else {
+      ++i;
+    }
+  }
+  return true;
+}
+
+typedef int Board[2][25];
+}
+
+bool
+parsePosition(const char* l, DataPosition& p)
+{
+  if( strlen(l) < 20 || ! auchFromString(l, p.auch) ) {
+    return false;
+  }
+
+  l += 20;
+  for(uint j = 0; j < 5; ++j) {
+    char* endp = 0;
+    p.probs[j] = strtod(l, &endp);
+    if( endp == l ) {
+      return false;
+    }
+    l = endp;
+  }
+  return true;
+}
+
+TrainSet::TrainSet(void) :
+  nPositions(0),
+  positions(0),
+  header(0),
+  base(0),
+  size(0),
+  mapped(false)
+{
+  checked[0] = checked[1] = 0;
+}
+
+TrainSet::~TrainSet()
+{
+#if HAVE_MMAP
+  if( mapped ) {
+    munmap(base, size);
+    return;
+  }
+#endif
+  free(base);
+}
+
+const char*
+TrainSet::open(const char* const fileName)
+{
+  int const h = ::open(fileName, O_RDONLY);
+  struct stat st;
+
+  if( h < 0 ) {
+    return "can't open file";
+  }
+
+  if( fstat(h, &st) != 0 || size_t(st.st_size) < sizeof(TrainSetHeader) ) {
+    close(h);
+    return "not a training set file";
+  }
+
+  size = st.st_size;
+
+#if HAVE_MMAP
+  base = mmap(0, size, PROT_READ, MAP_SHARED, h, 0);
+  mapped = base != MAP_FAILED;
+  if( ! mapped ) {
+    base = 0;
+  }
+#endif
+
+  if( ! base ) {
+    char* p = static_cast<char*>(malloc(size));
+    base = p;
+
+    for(size_t n = 0; p && n < size; /**/) {
+      ssize_t const r = read(h, p + n, size - n);
+      if( r <= 0 ) {
+	close(h);
+	return "can't read file";
+      }
+      n += r;
+    }
+  }
+  close(h);
+
+  if( ! base ) {
+    return "out of memory";
+  }
+
+  const TrainSetHeader& th = *static_cast<const TrainSetHeader*>(base);
+  const char* const b = static_cast<const char*>(base);
+
+  if( memcmp(th.magic, TRAINSET_MAGIC, sizeof(th.magic)) != 0 ) {
+    return "not a training set file";
+  }
+
+  if( th.version != TRAINSET_VERSION || th.byteOrder != TRAINSET_BYTE_ORDER
+      || th.recordSize != sizeof(DataPosition) ) {
+    return "training set written by another version or machine";
+  }
+
+  uint64_t const n = th.nPositions;
+
+  if( th.positionsOffset % 4 != 0 ||
+      ! inFile(th.positionsOffset, n, sizeof(DataPosition), size) ) {
+    return "truncated training set file";
+  }
+
+  header = &th;
+  nPositions = n;
+  positions = reinterpret_cast<const DataPosition*>(b + th.positionsOffset);
+
+  inps.classes = 0;
+  inps.offsets = 0;
+  inps.words = 0;
+  inps.probs = 0;
+  checked[0] = checked[1] = 0;
+
+  if( th.nClasses ) {
+    if( th.nClasses > TRAINSET_MAX_CLASSES
+	|| ! inFile(th.classesOffset, n, 1, size)
+	|| th.offsetsOffset % 8 != 0
+	|| ! inFile(th.offsetsOffset, n + 1, sizeof(uint64_t), size)
+	|| th.wordsOffset % 2 != 0
+	|| th.probsOffset % 4 != 0
+	|| ! inFile(th.probsOffset, n, sizeof(*inps.probs), size) ) {
+      return "truncated training set file";
+    }
+
+    inps.classes = reinterpret_cast<const unsigned char*>
+      (b + th.classesOffset);
+    inps.offsets = reinterpret_cast<const uint64_t*>(b + th.offsetsOffset);
+    inps.words = reinterpret_cast<const unsigned short*>(b + th.wordsOffset);
+    inps.probs = reinterpret_cast<const float (*)[5]>(b + th.probsOffset);
+
+    if( ! inFile(th.wordsOffset, inps.offsets[n], sizeof(unsigned short),
+		 size) ) {
+      return "truncated training set file";
+    }
+
+    for(uint k = 0; k < n; ++k) {
+      uint const c = inps.classes[k];
+
+      if( inps.offsets[k] > inps.offsets[k+1]
+	  || (c >= th.nClasses && c != PositionInputs::NO_CLASS) ) {
+	return "corrupt training set file";
+      }
+    }
+  }
+
+  return 0;
+}
+
+namespace {
+// true if the inputs computed with the input functions inputNames can be
+// used with the current nets
+bool
+sameInputs(const char inputNames[][32], bool const prune)
+{
+  for(uint pc = 0; pc < N_CLASSES; ++pc) {
+    const char* const name = inputNames[pc];
+
+    if( name[0] && ! (TrainNet(pc, prune) &&
+		      strcmp(name, TrainInputsName(pc, prune)) == 0) ) {
+      return false;
+    }
+  }
+  return true;
+}
+}
+
+const PositionInputs*
+TrainSet::inputs(bool const prune) const
+{
+  if( ! (header && header->nClasses == N_CLASSES
+	 && bool(header->prune) == prune
+	 && sameInputs(header->inputNames, prune)) ) {
+    return 0;
+  }
+
+  // The file only gives the input functions by name: check every record
+  // once against the nets it is used with. The trainer computes the
+  // inputs itself when they don't fit.
+  int& ok = checked[prune];
+
+  if( ! ok ) {
+    ok = 1;
+
+    for(uint k = 0; k < nPositions && ok > 0; ++k) {
+      uint const pc = inps.classes[k];
+
+      if( pc != PositionInputs::NO_CLASS
+	  && ! validInputs(inps.words + inps.offsets[k],
+			   inps.offsets[k+1] - inps.offsets[k],
+			   TrainNet(pc, prune)->cInput) ) {
+	ok = -1;
+      }
+    }
+  }
+
+  return ok > 0 ? &inps : 0;
+}
+
+InputCache::InputCache(const DataPosition* const positions, uint const n,
+		       bool const prune) :
+  prune(prune),
+  classes(n),
+  offsets(n + 1),
+  probs(n)
+{
+  memset(inputNames, 0, sizeof(inputNames));
+  
+  offsets[0] = 0;
+  
+  for(uint k = 0; k < n; ++k) {
+    Board board;
+    float arInput[MAX_NUM_INPUTS];
+    unsigned short aw[MAX_SPARSE_WORDS];
+    uint nw = 0;
+    float* const p = probs[k].p;
+    
+    memcpy(p, positions[k].probs, sizeof(probs[k].p));
+    
+    PositionFromKey(board, const_cast<unsigned char*>(positions[k].auch));
+
+    int const pc = TrainClassInputs(board, p, prune, arInput);
+
+    if( pc >= 0 ) {
+      nw = SparseInputs(arInput, TrainNet(pc, prune)->cInput, aw);
+      words.insert(words.end(), aw, aw + nw);
+      
+      if( ! inputNames[pc][0] ) {
+	strncpy(inputNames[pc], TrainInputsName(pc, prune),
+		sizeof(inputNames[pc]) - 1);
+      }
+    }
+
+    classes[k] = pc >= 0 ? pc : int(PositionInputs::NO_CLASS);
+    offsets[k+1] = offsets[k] + nw;
+  }
+
+  std::vector<unsigned short>(words).swap(words);
+  
+  inps.classes = n ? &classes[0] : 0;
+  inps.offsets = &offsets[0];
+  inps.words = words.empty() ? 0 : &words[0];
+  inps.probs = n ? &probs[0].p : 0;
+}
+
+const PositionInputs*
+InputCache::inputs(bool const pruneNet) const
+{
+  return pruneNet == prune && sameInputs(inputNames, prune) ? &inps : 0;
+}
+
+size_t
+InputCache::size(void) const
+{
+  return classes.size() * sizeof(classes[0])
+    + offsets.size() * sizeof(offsets[0])
+    + words.size() * sizeof(words[0])
+    + probs.size() * sizeof(probs[0]);
+}
+
+bool
+isTrainSet(const char* const fileName)
+{
+  char magic[8];
+  FILE* const f = fopen(fileName, "rb");
+
+  if( ! f ) {
+    return false;
+  }
+
+  bool const is = fread(magic, sizeof(magic), 1, f) == 1 &&
+    memcmp(magic, TRAINSET_MAGIC, sizeof(magic)) == 0;
+
+  fclose(f);
+  return is;
+}
+
+namespace {
+// The inputs are written to a temporary file first, since their total
+// size is known only at the end.
+const char*
+writePositions(FILE* const in, FILE* const out, FILE* const words,
+	       TrainSetHeader& h, uint64_t& pos,
+	       std::vector<unsigned char>& classes,
+	       std::vector<uint64_t>& offsets, std::vector<float>& probs)
+{
+  char line[1024];
+
+  while( fgets(line, sizeof(line), in) ) {
+    if( ! isupper(line[0]) ) {
+      continue;
+    }
+
+    DataPosition p;
+    memset(&p, 0, sizeof(p));
+
+    if( ! parsePosition(line, p) ) {
+      return "invalid position";
+    }
+
+    if( words ) {
+      Board board;
+      float arInput[MAX_NUM_INPUTS];
+      unsigned short aw[MAX_SPARSE_WORDS];
+      float ar[5];
+      uint n = 0;
+
+      PositionFromKey(board, p.auch);
+
+      // the record keeps the probabilities as they are
+      memcpy(ar, p.probs, sizeof(ar));
+
+      int const pc = TrainClassInputs(board, ar, h.prune, arInput);
+
+      if( pc >= 0 ) {
+	n = SparseInputs(arInput, TrainNet(pc, h.prune)->cInput, aw);
+
+	if( ! h.inputNames[pc][0] ) {
+	  strncpy(h.inputNames[pc], TrainInputsName(pc, h.prune),
+		  sizeof(h.inputNames[pc]) - 1);
+	}
+
+	if( fwrite(aw, sizeof(*aw), n, words) != n ) {
+	  return "can't write temporary file";
+	}
+      }
+
+      classes.push_back(pc >= 0 ? pc : int(PositionInputs::NO_CLASS));
+      offsets.push_back(offsets.back() + n);
+      probs.insert(probs.end(), ar, ar + 5);
+    }
+
+    if( h.nPositions == 0xffffffffU ) {
+      return "too many positions";
+    }
+
+    if( ! writeData(out, &p, sizeof(p), pos) ) {
+      return "write failed";
+    }
+    ++h.nPositions;
+  }
+
+  return ferror(in) ? "read failed" : 0;
+}
+
+const char*
+writeInputs(FILE* const out, FILE* const words, TrainSetHeader& h,
+	    uint64_t& pos, std::vector<unsigned char> const& classes,
+	    std::vector<uint64_t> const& offsets,
+	    std::vector<float> const& probs)
+{
+  {                          assert( N_CLASSES <= TRAINSET_MAX_CLASSES ); }
+
+  h.nClasses = N_CLASSES;
+
+  h.classesOffset = pos;
+  if( ! classes.empty()
+      && ! writeData(out, &classes[0], classes.size(), pos) ) {
+    return "write failed";
+  }
+
+  if( ! pad8(out, pos) ) {
+    return "write failed";
+  }
+
+  h.wordsOffset = pos;
+  rewind(words);
+
+  char buf[65536];
+  size_t n;
+  while( (n = fread(buf, 1, sizeof(buf), words)) > 0 ) {
+    if( ! writeData(out, buf, n, pos) ) {
+      return "write failed";
+    }
+  }
+
+  if( ferror(words)
+      || pos - h.wordsOffset != offsets.back() * sizeof(unsigned short) ) {
+    return "can't read temporary file";
+  }
+
+  if( ! pad8(out, pos) ) {
+    return "write failed";
+  }
+
+  h.offsetsOffset = pos;
+  if( ! writeData(out, &offsets[0], offsets.size() * sizeof(uint64_t), pos) ) {
+    return "write failed";
+  }
+
+  h.probsOffset = pos;
+  if( ! probs.empty()
+      && ! writeData(out, &probs[0], probs.size() * sizeof(float), pos) ) {
+    return "write failed";
+  }
+
+  return 0;
+}
+}
+
+const char*
+writeTrainSet(const char* const datName, const char* const fileName,
+	      bool const withInputs, bool const prune)
+{
+  FILE* const in = fopen(datName, "r");
+
+  if( ! in ) {
+    return "can't open data file";
+  }
+
+  FILE* const out = fopen(fileName, "wb");
+
+  if( ! out ) {
+    fclose(in);
+    return "can't create file";
+  }
+
+  FILE* const words = withInputs ? tmpfile() : 0;
+  const char* err = 0;
+
+  if( withInputs && ! words ) {
+    err = "can't create temporary file";
+  }
+
+  TrainSetHeader h;
+  memset(&h, 0, sizeof(h));
+
+  memcpy(h.magic, TRAINSET_MAGIC, sizeof(h.magic));
+  h.version = TRAINSET_VERSION;
+  h.byteOrder = TRAINSET_BYTE_ORDER;
+  h.recordSize = sizeof(DataPosition);
+  h.prune = prune;
+
+  uint64_t pos = 0;
+
+  // written again at the end, with the counts and offsets
+  if( ! err && ! writeData(out, &h, sizeof(h), pos) ) {
+    err = "write failed";
+  }
+  h.positionsOffset = pos;
+
+  std::vector<unsigned char> classes;
+  std::vector<uint64_t> offsets(1, 0);
+  std::vector<float> probs;
+
+  if( ! err ) {
+    err = writePositions(in, out, words, h, pos, classes, offsets, probs);
+  }
+
+  if( ! err && withInputs ) {
+    err = writeInputs(out, words, h, pos, classes, offsets, probs);
+  }
+
+  if( ! err && (fseek(out, 0, SEEK_SET) != 0
+		|| fwrite(&h, sizeof(h), 1, out) != 1) ) {
+    err = "write failed";
+  }
+
+  if( words ) {
+    fclose(words);
+  }
+  fclose(in);
+
+  if( fclose(out) != 0 && ! err ) {
+    err = "write failed";
+  }
+
+  if( err ) {
+    unlink(fileName);
+  }
+
+  return err;
+}
@@ -0,0 +1,172 @@
+// -*- C++ -*-
+
+/*
+ * trainset.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of version 2 of the GNU General Public License as
+ * published by the Free Software Foundation.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ *
+ */
+
+#if !defined( TRAINSET_H )
+#define TRAINSET_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+
+struct DataPosition {
+  unsigned char	auch[10];
+
+  float		probs[5];
+};
+
+// Parse a line of a training data (.dat) file: a 20 letters position id
+// followed by the 5 probabilities.
+bool
+parsePosition(const char* l, DataPosition& p);
+
+// Inputs of each position, in the sparse form of SparseInputs(). The
+// inputs of position k are words[offsets[k]] .. words[offsets[k+1] - 1],
+// computed for the net of classes[k] (NO_CLASS when there is no net to
+// train the position with).
+struct PositionInputs {
+  enum { NO_CLASS = 0xff };
+
+  const unsigned char*	classes;
+  const uint64_t*	offsets;
+  const unsigned short*	words;
+
+  // The desired outputs, sanity checked as TrainClassInputs does. 0 when
+  // the probabilities of the positions are already checked.
+  const float		(*probs)[5];
+};
+
+/* Binary training set file (.tds)
+
+   A training data file converted once, so that it can be mapped into
+   memory instead of being parsed each time it is used. All numbers are
+   in the byte order of the machine that wrote it, which is checked with
+   byteOrder.
+
+   header		TrainSetHeader
+   positions		nPositions DataPosition records
+
+   and, optionally, the net inputs of each position (as PositionInputs),
+   for the input functions named in inputNames (by class):
+
+   classes		nPositions bytes
+   words		offsets[nPositions] words
+   offsets		nPositions + 1 offsets (8 byte aligned)
+   probs		nPositions times 5 floats
+
+   The positions keep the probabilities of the data file. probs are the
+   desired outputs the inputs were computed with, sanity checked as for
+   training (no gammons when a side has borne off, ...).
+*/
+
+#define TRAINSET_MAGIC "gnubgTS"
+#define TRAINSET_VERSION 2
+#define TRAINSET_BYTE_ORDER 0x01020304
+#define TRAINSET_MAX_CLASSES 16
+
+struct TrainSetHeader {
+  char		magic[8];
+  uint32_t	version;
+  uint32_t	byteOrder;
+  uint32_t	recordSize;		// sizeof(DataPosition)
+  uint32_t	nPositions;
+
+  // 1 when the inputs are those of the pruning nets
+  uint32_t	prune;
+
+  // number of entries in inputNames, 0 when there are no inputs
+  uint32_t	nClasses;
+
+  uint64_t	positionsOffset;
+  uint64_t	classesOffset;
+  uint64_t	wordsOffset;
+  uint64_t	offsetsOffset;
+  uint64_t	probsOffset;
+
+  char		inputNames[TRAINSET_MAX_CLASSES][32];
+};
+
+// A training set file, mapped read only
+class TrainSet {
+public:
+  TrainSet(void);
+
+  ~TrainSet();
+
+  // 0 if OK, otherwise the reason it failed
+  const char*	open(const char* fileName);
+
+  // Precomputed inputs, if there are any, the current nets still use
+  // the same input functions and the inputs are valid for these nets.
+  const PositionInputs*	inputs(bool prune) const;
+
+  unsigned int			nPositions;
+  const DataPosition*		positions;
+
+private:
+  const TrainSetHeader*		header;
+  PositionInputs		inps;
+  // inputs checked against the nets: 0 not yet, 1 valid, -1 invalid (by
+  // prune)
+  mutable int			checked[2];
+
+  void*				base;
+  size_t			size;
+  bool				mapped;
+};
+
+// Inputs of positions computed once, in memory, so that training epochs
+// don't compute them again.
+class InputCache {
+public:
+  InputCache(const DataPosition* positions, unsigned int n, bool prune);
+
+  // The inputs, if the current nets still use the same input functions.
+  const PositionInputs*	inputs(bool prune) const;
+
+  // Memory used, in bytes
+  size_t		size(void) const;
+
+private:
+  struct Probs {
+    float		p[5];
+  };
+
+  PositionInputs		inps;
+  bool				prune;
+  char				inputNames[TRAINSET_MAX_CLASSES][32];
+  
+  std::vector<unsigned char>	classes;
+  std::vector<uint64_t>		offsets;
+  std::vector<unsigned short>	words;
+  std::vector<Probs>		probs;
+};
+
+// true if fileName is a training set file
+bool
+isTrainSet(const char* fileName);
+
+// Convert the training data file datName to the training set file
+// fileName, with the inputs of the (pruning) nets when withInputs is
+// set. Returns 0 if OK, otherwise the reason it failed.
+const char*
+writeTrainSet(const char* datName, const char* fileName, bool withInputs,
+	      bool prune);
+
+#endif
@@ -47,6 +47,10 @@ Number of games for OSR evaluation (@samp{O} command).
 @item @tab --no-shortcuts @tab
 Disable usage of small net pruning.
 
+@item @tab --moves-cache=@var{N} @tab
+Memory for the best moves cache of cube rollouts (@samp{c} command), in MB.
+Default is 64, 0 disables the cache.
+
 @item @tab --resume @tab
 Resume an interrupted run. Both @file{cmd-file} and @file{output-file} must be
 given.
@@ -166,6 +170,7 @@ the 80 bit GNUbg position ID.
 
 #include "GetOpt.h"
 #include <analyze.h>
+#include <danalyze.h>
 #include <bms.h>
 #include <bm.h>
 #include <equities.h>
@@ -273,6 +278,7 @@ static uint const N_EP = 263;
 static uint const N_SC = 264;
 static uint const N_OG = 265;
 static uint const N_OSRO = 266;
+static uint const N_MC = 267;
 
 static const GetOptLongOption
 longOpt[] =
@@ -289,6 +295,7 @@ longOpt[] =
   { "no-shortcuts",     GetOptLongOption::no_argument,          0,  N_SC },
   { "n-osr",            GetOptLongOption::required_argument,    0,  N_OG },
   { "osr-in-roll",      GetOptLongOption::required_argument,    0,  N_OSRO },
+  { "moves-cache",      GetOptLongOption::required_argument,    0,  N_MC },
   { "resume",           GetOptLongOption::no_argument,          0,  N_RS } ,
   
   { "verbose",		GetOptLongOption::optional_argument,	0, 'v' } , 
@@ -311,6 +318,8 @@ usage(const char* const p)
        << "  --cube-away=N             Use (N,N) away for cube decisions."
        << "  --eval-plies=N            Evaluate using N-ply."
        << endl
+       << "  --moves-cache=N           Memory (MB) of the cube rollouts moves"
+          " cache." << endl
        << "  --resume                  Resume an interrupted session."
           " (both 'cmd-file' and 'output-file' must be given)."
        << endl
@@ -427,6 +436,17 @@ main(int argc, char* argv[])
 	shortCuts = false;
 	break;
       }
+      case N_MC:
+      {
+	int i = atoi(opt.optarg);
+
+	if( i < 0 ) {
+	  cerr << endl << "negative moves cache size" << endl;
+	  exit(1);
+	}
+	setMovesCacheSize(size_t(i) * 1024 * 1024);
+	break;
+      }
       case 'h':
       default:
       {
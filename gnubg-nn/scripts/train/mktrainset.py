@@ -0,0 +1,29 @@
+#!/usr/bin/env pygnubg 
+"""mktrainset [--inputs] [--prune] [-w weights] dat-file tds-file
+Convert a training data file to a binary training set, which train.py maps
+into memory instead of reading it. With --inputs, the inputs of the nets
+(of the pruning nets with --prune) are computed once and kept in the file;
+they are used as long as the nets use the same input functions."""
+
+import sys, getopt
+
+from bgutil import *
+
+withInputs = 0
+prune = 0
+
+optlist, args = getopt.getopt(sys.argv[1:], "w:", ["inputs", "prune"])
+
+for o, a in optlist:
+  if o == '--inputs':
+    withInputs = 1
+  elif o == '--prune':
+    prune = 1
+  elif o == '-w':
+    gnubg.net.set(gnubg.net.get(a))
+
+if len(args) != 2 :
+  print >> sys.stderr, __doc__
+  sys.exit(1)
+
+gnubg.trainset(args[0], args[1], withInputs, prune)
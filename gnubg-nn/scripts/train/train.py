@@ -1,5 +1,5 @@
 #!/usr/bin/env pygnubg 
-""" train [-a alpha -l low-alpha -b benchnark -v -n] dat-file net-base-name"""
+""" train [-a alpha -l low-alpha -b benchnark -v -n -t threads --batch n --hogwild --cache] dat-file net-base-name"""
 
 import sys, string, os, time, glob, getopt
 
@@ -30,9 +30,14 @@ targetClass = gnubg.c_contact
 benchmarkFile = None
 iTrain = list()
 ignoreBG = 0
+nThreads = 1
+batch = 0
+hogwild = 0
+cacheInputs = 0
 
-optlist, args = getopt.getopt(sys.argv[1:], "a:l:nvb:i:", \
-                              ["class=", "ignorebg"])
+optlist, args = getopt.getopt(sys.argv[1:], "a:l:nvb:i:t:", \
+                              ["class=", "ignorebg", "batch=", "hogwild",
+                               "cache"])
 
 for o, a in optlist:
   if o == '-a':
@@ -51,21 +56,27 @@ for o, a in optlist:
     ignoreBG = 1
   elif o == '-i':
     iTrain = [int(x) for x in a.split()]
+  elif o == '-t':
+    nThreads = int(a)
+  elif o == '--batch':
+    batch = int(a)
+  elif o == '--hogwild':
+    hogwild = 1
+  elif o == '--cache':
+    cacheInputs = 1
     
 
 
 try: 
   dataFileName,baseName = args[0:2]
 except :
-  print >> sys.stderr, "Usage:", sys.argv[0],"dat-file net-base-name"
+  print >> sys.stderr, "Usage:", sys.argv[0],"dat-file|tds-file net-base-name"
   sys.exit(1)
   
 if verbose:
   print "reading training data file"
   
-data = readData(dataFileName)
-
-nPos = len(data)
+data = trainingData(dataFileName)
 
 # Should training ignore backgammons?
 ignoreBGs = ignoreBG or targetClass == gnubg.c_race
@@ -77,6 +88,15 @@ trainer = gnubg.trainer(data, ignoreBGs, 0, iTrain)
   
 del data
 
+nPos = trainer.size()
+
+if cacheInputs :
+  if verbose :
+    print "computing inputs"
+  n = trainer.cacheinputs()
+  if verbose :
+    print "inputs cache uses %d MB" % (n >> 20)
+
 alpha = alphaStart
 
 prever = 100
@@ -211,7 +231,7 @@ while 1 :
 
       cstart = time.time()
     
-    trainer.train(alpha, order)
+    trainer.train(alpha, order, nThreads, batch, hogwild)
     
     if verbose :
       nsec = time.time() - cstart
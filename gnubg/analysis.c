@@ -187,6 +187,8 @@ LuckFirst(const TanBoard anBoard, const int n0, const int n1, cubeinfo * pci, co
     float aar[6][6], ar[NUM_ROLLOUT_OUTPUTS], rMean = 0.0f;
     cubeinfo ciOpp;
     movelist ml;
+    arena *pa = MT_GetArena();
+    arenamark mark = ArenaMark(pa);
 
     /* first with player pci->fMove on roll */
 
@@ -198,9 +200,9 @@ LuckFirst(const TanBoard anBoard, const int n0, const int n1, cubeinfo * pci, co
             memcpy(&anBoardTemp[0][0], &anBoard[0][0], 2 * 25 * sizeof(int));
 
             /* Find the best move for each roll at ply 0 only. */
-            if (FindnSaveBestMoves(&ml, i + 1, j + 1, (ConstTanBoard) anBoardTemp, NULL, 0.0f,
-                                   pci, pec, defaultFilters) < 0) {
-                g_free(ml.amMoves);
+            if (FindnSaveBestMovesArena(&ml, i + 1, j + 1, (ConstTanBoard) anBoardTemp, NULL, 0.0f,
+                                        pci, pec, defaultFilters) < 0) {
+                ArenaRelease(pa, mark);
                 return ERR_VAL;
             }
 
@@ -221,7 +223,7 @@ LuckFirst(const TanBoard anBoard, const int n0, const int n1, cubeinfo * pci, co
 
             } else {
                 aar[i][j] = ml.amMoves[0].rScore;
-                g_free(ml.amMoves);
+                ArenaRelease(pa, mark);
             }
 
             rMean += aar[i][j];
@@ -236,9 +238,9 @@ LuckFirst(const TanBoard anBoard, const int n0, const int n1, cubeinfo * pci, co
             SwapSides(anBoardTemp);
 
             /* Find the best move for each roll at ply 0 only. */
-            if (FindnSaveBestMoves(&ml, i + 1, j + 1, (ConstTanBoard) anBoardTemp, NULL, 0.0f,
-                                   &ciOpp, pec, defaultFilters) < 0) {
-                g_free(ml.amMoves);
+            if (FindnSaveBestMovesArena(&ml, i + 1, j + 1, (ConstTanBoard) anBoardTemp, NULL, 0.0f,
+                                        &ciOpp, pec, defaultFilters) < 0) {
+                ArenaRelease(pa, mark);
                 return ERR_VAL;
             }
 
@@ -259,7 +261,7 @@ LuckFirst(const TanBoard anBoard, const int n0, const int n1, cubeinfo * pci, co
 
             } else {
                 aar[i][j] = -ml.amMoves[0].rScore;
-                g_free(ml.amMoves);
+                ArenaRelease(pa, mark);
             }
 
             rMean += aar[i][j];
@@ -282,6 +284,8 @@ LuckNormal(const TanBoard anBoard, const int n0, const int n1, const cubeinfo *
     float aar[6][6], ar[NUM_ROLLOUT_OUTPUTS], rMean = 0.0f;
     cubeinfo ciOpp;
     movelist ml;
+    arena *pa = MT_GetArena();
+    arenamark mark = ArenaMark(pa);
 
     memcpy(&ciOpp, pci, sizeof(cubeinfo));
     ciOpp.fMove = !pci->fMove;
@@ -291,9 +295,9 @@ LuckNormal(const TanBoard anBoard, const int n0, const int n1, const cubeinfo *
             memcpy(&anBoardTemp[0][0], &anBoard[0][0], 2 * 25 * sizeof(int));
 
             /* Find the best move for each roll at ply 0 only. */
-            if (FindnSaveBestMoves(&ml, i + 1, j + 1, (ConstTanBoard) anBoardTemp, NULL, 0.0f,
-                                   pci, pec, defaultFilters) < 0) {
-                g_free(ml.amMoves);
+            if (FindnSaveBestMovesArena(&ml, i + 1, j + 1, (ConstTanBoard) anBoardTemp, NULL, 0.0f,
+                                        pci, pec, defaultFilters) < 0) {
+                ArenaRelease(pa, mark);
                 return ERR_VAL;
             }
 
@@ -314,7 +318,7 @@ LuckNormal(const TanBoard anBoard, const int n0, const int n1, const cubeinfo *
 
             } else {
                 aar[i][j] = ml.amMoves[0].rScore;
-                g_free(ml.amMoves);
+                ArenaRelease(pa, mark);
             }
 
             rMean += (i == j) ? aar[i][j] : aar[i][j] * 2.0f;
@@ -903,19 +907,19 @@ AnalyzeMove(moverecord * pmr, matchstate * pms, const listOLD * plParentGame,
 
                 {
                     movelist ml;
+                    arena *pa = MT_GetArena();
+                    arenamark mark = ArenaMark(pa);
                     MT_Release();
-                    if (FindnSaveBestMoves(&ml, pmr->anDice[0],
-                                           pmr->anDice[1],
-                                           (ConstTanBoard) pms->anBoard, &key,
-                                           arSkillLevel[SKILL_DOUBTFUL], &ci, &pesChequer->ec, aamf) < 0) {
-                        g_free(ml.amMoves);
+                    if (FindnSaveBestMovesArena(&ml, pmr->anDice[0],
+                                                pmr->anDice[1],
+                                                (ConstTanBoard) pms->anBoard, &key,
+                                                arSkillLevel[SKILL_DOUBTFUL], &ci, &pesChequer->ec, aamf) < 0) {
+                        ArenaRelease(pa, mark);
                         return -1;
                     }
                     MT_Exclusive();
                     CopyMoveList(&pmr->ml, &ml); /*! clang+LeakSanitizer complain about an unfreed malloc...*/
-                    if (ml.cMoves){
-                        g_free(ml.amMoves);
-                    }
+                    ArenaRelease(pa, mark);
                 }
             }
             
@@ -1395,7 +1399,7 @@ AnalyzeGame(listOLD * plGame, int wait)
                 pParentTask = NULL;
             }
             multi_debug("add task: analysis");
-            MT_AddTask((Task *) pt, TRUE);
+            MT_AddTask((Task *) pt);
         }
 
         FixMatchState(&msAnalyse, pmr);
@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2024 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * $Id$
+ */
+
+/*
+ * Per thread scratch memory, see arena.h
+ */
+
+#include "config.h"
+
+#include <glib.h>
+
+#include "arena.h"
+
+/* large enough for a few full move lists, so that a 2-ply search
+ * normally fits in the first block */
+#define ARENA_BLOCK (1024 * 1024)
+
+static arenablock *
+NewBlock(size_t cb)
+{
+    arenablock *pb = (arenablock *) g_malloc(sizeof(arenablock) + cb);
+
+    pb->pNext = NULL;
+    pb->cb = cb;
+    pb->cbUsed = 0;
+
+    return pb;
+}
+
+extern arena *
+ArenaNew(void)
+{
+    arena *pa = g_new(arena, 1);
+
+    pa->pFirst = pa->pCurrent = NewBlock(ARENA_BLOCK);
+
+    return pa;
+}
+
+extern void
+ArenaFree(arena * pa)
+{
+    arenablock *pb, *pbNext;
+
+    if (!pa)
+        return;
+
+    for (pb = pa->pFirst; pb; pb = pbNext) {
+        pbNext = pb->pNext;
+        g_free(pb);
+    }
+
+    g_free(pa);
+}
+
+/* The current block is full: continue in the next one, which is
+ * allocated (or replaced, if it is too small) the first time a search
+ * goes that deep. The blocks already in use can't move. */
+
+extern void *
+ArenaAllocNewBlock(arena * pa, size_t cb)
+{
+    arenablock *pb = pa->pCurrent;
+    arenablock *pbNext = pb->pNext;
+
+    if (!pbNext || pbNext->cb < cb) {
+        arenablock *pbRest = pbNext ? pbNext->pNext : NULL;
+
+        g_free(pbNext);
+        pbNext = NewBlock(MAX(cb, ARENA_BLOCK));
+        pbNext->pNext = pbRest;
+        pb->pNext = pbNext;
+    }
+
+    pbNext->cbUsed = cb;
+    pa->pCurrent = pbNext;
+
+    return pbNext + 1;
+}
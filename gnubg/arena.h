@@ -0,0 +1,95 @@
+/*
+ * Copyright (C) 2024 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * $Id$
+ */
+
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stddef.h>
+
+/*
+ * Scratch memory of one thread (move lists, task arrays, ...).
+ *
+ * Allocations are carved from a list of blocks and are never freed one
+ * by one: ArenaMark() records the current position and ArenaRelease()
+ * gives back everything allocated after it. Marks must be released in
+ * the reverse order they were taken, which is what happens naturally
+ * when each function releases its own mark before returning. The blocks
+ * are kept for reuse, so once a thread has warmed up it doesn't call
+ * malloc any more.
+ */
+
+#define ARENA_ALIGN 16
+
+typedef struct arenablock {
+    struct arenablock *pNext;
+    size_t cb;                  /* usable size */
+    size_t cbUsed;
+    size_t cbPad;               /* keeps the data ARENA_ALIGN aligned */
+} arenablock;
+
+typedef struct {
+    arenablock *pFirst;
+    arenablock *pCurrent;
+} arena;
+
+typedef struct {
+    arenablock *pb;
+    size_t cbUsed;
+} arenamark;
+
+extern arena *ArenaNew(void);
+extern void ArenaFree(arena * pa);
+extern void *ArenaAllocNewBlock(arena * pa, size_t cb);
+
+static inline void *
+ArenaAlloc(arena * pa, size_t cb)
+{
+    arenablock *pb = pa->pCurrent;
+    void *p;
+
+    cb = (cb + ARENA_ALIGN - 1) & ~((size_t) ARENA_ALIGN - 1);
+
+    if (pb->cb - pb->cbUsed < cb)
+        return ArenaAllocNewBlock(pa, cb);
+
+    p = (char *) (pb + 1) + pb->cbUsed;
+    pb->cbUsed += cb;
+
+    return p;
+}
+
+static inline arenamark
+ArenaMark(const arena * pa)
+{
+    arenamark m;
+
+    m.pb = pa->pCurrent;
+    m.cbUsed = pa->pCurrent->cbUsed;
+
+    return m;
+}
+
+static inline void
+ArenaRelease(arena * pa, arenamark m)
+{
+    pa->pCurrent = m.pb;
+    m.pb->cbUsed = m.cbUsed;
+}
+
+#endif
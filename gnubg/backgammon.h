@@ -580,6 +580,7 @@ extern void CommandAnnotateVeryUnlucky(char *);
 extern void CommandCalibrate(char *);
 extern void CommandClearCache(char *);
 extern void CommandClearHint(char *);
+extern void CommandClearPerformance(char *);
 extern void CommandClearTurn(char *);
 extern void CommandCMarkCubeSetNone(char *);
 extern void CommandCMarkCubeSetRollout(char *);
@@ -754,7 +755,10 @@ extern void CommandSetEvalParamRollout(char *);
 extern void CommandSetEvalParamType(char *);
 extern void CommandSetEvalPlies(char *);
 extern void CommandSetEvalPrune(char *);
+extern void CommandSetEvalQuantized(char *);
 extern void CommandSetEvalSameAsAnalysis(char *);
+extern void CommandSetEvalSplit(char *);
+extern void CommandSetEvalStore(char *);
 extern void CommandSetExportCubeDisplayActual(char *);
 extern void CommandSetExportCubeDisplayBad(char *);
 extern void CommandSetExportCubeDisplayClose(char *);
@@ -850,6 +854,7 @@ extern void CommandSetOutputRawboard(char *);
 extern void CommandSetOutputWinPC(char *);
 extern void CommandSetPanels(char *);
 extern void CommandSetPanelWidth(char *);
+extern void CommandSetPerformance(char *);
 extern void CommandSetPlayer(char *);
 extern void CommandSetPlayerChequerplay(char *);
 extern void CommandSetPlayerCubedecision(char *);
@@ -887,6 +892,7 @@ extern void CommandSetRNGRandomDotOrg(char *);
 extern void CommandSetRolloutBearoffTruncationExact(char *);
 extern void CommandSetRolloutBearoffTruncationOS(char *);
 extern void CommandSetRollout(char *);
+extern void CommandSetRolloutCheckInterval(char *);
 extern void CommandSetRolloutChequerplay(char *);
 extern void CommandSetRolloutCubedecision(char *);
 extern void CommandSetRolloutCubeEqualChequer(char *);
@@ -906,6 +912,7 @@ extern void CommandSetRolloutLatePlies(char *);
 extern void CommandSetRolloutLimit(char *);
 extern void CommandSetRolloutLimitEnable(char *);
 extern void CommandSetRolloutLimitMinGames(char *);
+extern void CommandSetRolloutLockstep(char *);
 extern void CommandSetRolloutLogEnable(char *);
 extern void CommandSetRolloutLogFile(char *);
 extern void CommandSetRolloutMaxError(char *);
@@ -918,6 +925,7 @@ extern void CommandSetRolloutPlayerLateCubedecision(char *);
 extern void CommandSetRolloutPlayerLateMoveFilter(char *);
 extern void CommandSetRolloutPlayerMoveFilter(char *);
 extern void CommandSetRolloutPlayersAreSame(char *);
+extern void CommandSetRolloutProcesses(char *);
 extern void CommandSetRolloutRNG(char *);
 extern void CommandSetRolloutRotate(char *);
 extern void CommandSetRolloutSeed(char *);
@@ -965,6 +973,7 @@ extern void CommandSetMarkedSamePlayer(char *);
 extern void CommandSetTheoryWindow(char *);
 extern void CommandSetThreads(char *);
 extern void CommandSetToolbar(char *);
+extern void CommandSetTranspositions(char *);
 extern void CommandSetTurn(char *);
 extern void CommandSetTutorChequer(char *);
 extern void CommandSetTutorCube(char *);
@@ -1026,10 +1035,12 @@ extern void CommandShowMWC(char *);
 extern void CommandShowOneSidedRollout(char *);
 extern void CommandShowOutput(char *);
 extern void CommandShowPanels(char *);
+extern void CommandShowPerformance(char *);
 extern void CommandShowPipCount(char *);
 extern void CommandShowPlayer(char *);
 extern void CommandShowPostCrawford(char *);
 extern void CommandShowPrompt(char *);
+extern void CommandShowQuantized(char *);
 extern void CommandShowRatingOffset(char *);
 extern void CommandShowRNG(char *);
 extern void CommandShowRollout(char *);
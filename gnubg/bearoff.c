@@ -256,11 +256,10 @@ HeuristicDatabase(void (*pfProgress) (unsigned int))
 }
 
 
+/* the caller holds the lock */
 static void
-ReadBearoffFile(const bearoffcontext * pbc, unsigned int offset, unsigned char *buf, unsigned int nBytes)
+ReadBearoffBytes(const bearoffcontext * pbc, unsigned int offset, unsigned char *buf, unsigned int nBytes)
 {
-    MT_Exclusive();
-
     if ((fseek(pbc->pf, (long) offset, SEEK_SET) < 0) || (fread(buf, 1, nBytes, pbc->pf) < nBytes)) {
         if (errno)
             perror(_("bearoff database"));
@@ -268,9 +267,14 @@ ReadBearoffFile(const bearoffcontext * pbc, unsigned int offset, unsigned char *
             fprintf(stderr, _("Error reading bearoff database"));
 
         memset(buf, 0, nBytes);
-        return;
     }
+}
 
+static void
+ReadBearoffFile(const bearoffcontext * pbc, unsigned int offset, unsigned char *buf, unsigned int nBytes)
+{
+    MT_Exclusive();
+    ReadBearoffBytes(pbc, offset, buf, nBytes);
     MT_Release();
 }
 
@@ -365,32 +369,26 @@ ReadHypergammon(const bearoffcontext * pbc, const unsigned int iPos, float arOut
 }
 
 
+/* Outputs from the bearoff distributions of both sides, an[] being
+ * their position ids. The sums over "the opponent is off no sooner"
+ * are suffix sums, so each probability is a single pass over the
+ * rolls. */
+
 static int
-BearoffEvalOneSided(const bearoffcontext * pbc, const TanBoard anBoard, float arOutput[])
+OneSidedOutputs(const bearoffcontext * pbc, const TanBoard anBoard, const unsigned int an[2],
+                const float aarProb[2][32], const float aarGammonProb[2][32], float arOutput[])
 {
     int i, j;
-    float aarProb[2][32];
-    float aarGammonProb[2][32];
-    float r;
+    float r, rSum;
     unsigned int anOn[2] = { 0 };
-    unsigned int an[2];
-    float ar[2][4];
-
-    /* get bearoff probabilities */
-
-    for (i = 0; i < 2; ++i) {
-
-        an[i] = PositionBearoff(anBoard[i], pbc->nPoints, pbc->nChequers);
-        if (BearoffDist(pbc, an[i], aarProb[i], aarGammonProb[i], ar[i], NULL, NULL))
-            return -1;
-    }
 
     /* calculate winning chance */
 
-    r = 0.0;
-    for (i = 0; i < 32; ++i)
-        for (j = i; j < 32; ++j)
-            r += aarProb[1][i] * aarProb[0][j];
+    r = rSum = 0.0f;
+    for (i = 31; i >= 0; --i) {
+        rSum += aarProb[0][i];
+        r += aarProb[1][i] * rSum;
+    }
 
     arOutput[OUTPUT_WIN] = r;
 
@@ -407,19 +405,21 @@ BearoffEvalOneSided(const bearoffcontext * pbc, const TanBoard anBoard, float ar
             /* my gammon chance: I'm out in i rolls and my opponent isn't inside
              * home quadrant in less than i rolls */
 
-            r = 0;
-            for (i = 0; i < 32; i++)
-                for (j = i; j < 32; j++)
-                    r += aarProb[1][i] * aarGammonProb[0][j];
+            r = rSum = 0.0f;
+            for (i = 31; i >= 0; --i) {
+                rSum += aarGammonProb[0][i];
+                r += aarProb[1][i] * rSum;
+            }
 
             arOutput[OUTPUT_WINGAMMON] = r;
 
             /* opp gammon chance */
 
-            r = 0;
-            for (i = 0; i < 32; i++)
-                for (j = i + 1; j < 32; j++)
-                    r += aarProb[0][i] * aarGammonProb[1][j];
+            r = rSum = 0.0f;
+            for (i = 31; i >= 0; --i) {
+                r += aarProb[0][i] * rSum;
+                rSum += aarGammonProb[1][i];
+            }
 
             arOutput[OUTPUT_LOSEGAMMON] = r;
 
@@ -444,6 +444,28 @@ BearoffEvalOneSided(const bearoffcontext * pbc, const TanBoard anBoard, float ar
     return 0;
 }
 
+static int
+BearoffEvalOneSided(const bearoffcontext * pbc, const TanBoard anBoard, float arOutput[])
+{
+    int i;
+    float aarProb[2][32];
+    float aarGammonProb[2][32];
+    unsigned int an[2];
+    float ar[2][4];
+
+    /* get bearoff probabilities */
+
+    for (i = 0; i < 2; ++i) {
+
+        an[i] = PositionBearoff(anBoard[i], pbc->nPoints, pbc->nChequers);
+        if (BearoffDist(pbc, an[i], aarProb[i], aarGammonProb[i], ar[i], NULL, NULL))
+            return -1;
+    }
+
+    return OneSidedOutputs(pbc, anBoard, an, (const float (*)[32]) aarProb, (const float (*)[32]) aarGammonProb,
+                           arOutput);
+}
+
 
 extern int
 BearoffHyper(const bearoffcontext * pbc, const unsigned int iPos, float arOutput[], float arEquity[])
@@ -1191,6 +1213,129 @@ BearoffDist(const bearoffcontext * pbc, const unsigned int nPosID,
         return ReadBearoffOneSidedExact(pbc, nPosID, arProb, arGammonProb, ar, ausProb, ausGammonProb);
 }
 
+typedef struct {
+    unsigned int iPos;
+    unsigned int k;
+} bearoffread;
+
+static int
+CompareBearoffReads(const void *p1, const void *p2)
+{
+    unsigned int const i1 = ((const bearoffread *) p1)->iPos;
+    unsigned int const i2 = ((const bearoffread *) p2)->iPos;
+
+    return (i1 > i2) - (i1 < i2);
+}
+
+static int
+BearoffEvalTwoSidedBatch(const bearoffcontext * pbc, const TanBoard aanBoard[], const unsigned int ai[],
+                         unsigned int c, float *aarOutput[])
+{
+    unsigned int const n = Combination(pbc->nPoints + pbc->nChequers, pbc->nPoints);
+    unsigned int const cb = pbc->fCubeful ? 8 : 2;
+    bearoffread *abr = (bearoffread *) g_alloca(c * sizeof(bearoffread));
+    unsigned char (*aac)[2] = g_alloca(c * sizeof(*aac));
+    unsigned int k;
+
+    for (k = 0; k < c; ++k) {
+        const unsigned int (*anBoard)[25] = aanBoard[ai[k]];
+
+        abr[k].iPos = PositionBearoff(anBoard[1], pbc->nPoints, pbc->nChequers) * n
+            + PositionBearoff(anBoard[0], pbc->nPoints, pbc->nChequers);
+        abr[k].k = k;
+    }
+
+    if (pbc->p) {
+        for (k = 0; k < c; ++k)
+            memcpy(aac[k], pbc->p + 40 + cb * abr[k].iPos, 2);
+    } else {
+        /* read in file order, holding the lock once */
+        qsort(abr, c, sizeof(bearoffread), CompareBearoffReads);
+
+        MT_Exclusive();
+        for (k = 0; k < c; ++k)
+            ReadBearoffBytes(pbc, 40 + cb * abr[k].iPos, aac[abr[k].k], 2);
+        MT_Release();
+    }
+
+    for (k = 0; k < c; ++k) {
+        unsigned short int us = aac[k][0] | (unsigned short) (aac[k][1] << 8);
+        float r = us / 32767.5f - 1.0f;
+
+        memset(aarOutput[k], 0, 5 * sizeof(float));
+        aarOutput[k][OUTPUT_WIN] = r / 2.0f + 0.5f;
+    }
+
+    return 0;
+}
+
+static int
+BearoffEvalOneSidedBatch(const bearoffcontext * pbc, const TanBoard aanBoard[], const unsigned int ai[],
+                         unsigned int c, float *aarOutput[])
+{
+    float (*aaarProb)[2][32] = g_alloca(c * sizeof(*aaarProb));
+    float (*aaarGammonProb)[2][32] = g_alloca(c * sizeof(*aaarGammonProb));
+    unsigned int (*aan)[2] = g_alloca(c * sizeof(*aan));
+    unsigned short int aus[64];
+    unsigned int i, k;
+
+    for (k = 0; k < c; ++k)
+        for (i = 0; i < 2; ++i)
+            aan[k][i] = PositionBearoff(aanBoard[ai[k]][i], pbc->nPoints, pbc->nChequers);
+
+    /* When scoring moves the side not on roll is the same in all the
+     * positions; decode each distinct distribution once */
+    for (k = 0; k < c; ++k)
+        for (i = 0; i < 2; ++i) {
+            if (k && aan[k][i] == aan[k - 1][i]) {
+                memcpy(aaarProb[k][i], aaarProb[k - 1][i], sizeof(aaarProb[k][i]));
+                memcpy(aaarGammonProb[k][i], aaarGammonProb[k - 1][i], sizeof(aaarGammonProb[k][i]));
+                continue;
+            }
+
+            if (pbc->fCompressed)
+                GetDistCompressed(aus, pbc, aan[k][i]);
+            else
+                GetDistUncompressed(aus, pbc, aan[k][i]);
+
+            AssignOneSided(aaarProb[k][i], aaarGammonProb[k][i], NULL, NULL, NULL, aus, aus + 32);
+        }
+
+    for (k = 0; k < c; ++k)
+        if (OneSidedOutputs(pbc, aanBoard[ai[k]], aan[k], (const float (*)[32]) aaarProb[k],
+                            (const float (*)[32]) aaarGammonProb[k], aarOutput[k]))
+            return -1;
+
+    return 0;
+}
+
+/* Evaluate the c positions aanBoard[ai[k]] into aarOutput[k], with the
+ * same results as BearoffEval(). All the position ids are computed
+ * first, then the database entries are fetched in one pass. */
+
+extern int
+BearoffEvalBatch(const bearoffcontext * pbc, const TanBoard aanBoard[], const unsigned int ai[], unsigned int c,
+                 float *aarOutput[])
+{
+    unsigned int k;
+
+    g_return_val_if_fail(pbc, -1);
+
+    if (pbc->bt == BEAROFF_TWOSIDED)
+        return BearoffEvalTwoSidedBatch(pbc, aanBoard, ai, c, aarOutput);
+
+    if (pbc->bt == BEAROFF_ONESIDED && pbc->p && !pbc->fND)
+        return BearoffEvalOneSidedBatch(pbc, aanBoard, ai, c, aarOutput);
+
+    /* one-sided databases on disk are read in two steps (index, then
+     * distribution) and hypergammon is not used in move scoring */
+    for (k = 0; k < c; ++k)
+        if (BearoffEval(pbc, aanBoard[ai[k]], aarOutput[k]))
+            return -1;
+
+    return 0;
+}
+
 extern int
 isBearoff(const bearoffcontext * pbc, const TanBoard anBoard)
 {
@@ -62,6 +62,10 @@ extern bearoffcontext *BearoffInit(const char *szFilename, const unsigned int bo
 extern int
  BearoffEval(const bearoffcontext * pbc, const TanBoard anBoard, float arOutput[]);
 
+extern int
+ BearoffEvalBatch(const bearoffcontext * pbc, const TanBoard aanBoard[], const unsigned int ai[], unsigned int c,
+                  float *aarOutput[]);
+
 extern void
  BearoffStatus(const bearoffcontext * pbc, char *sz);
 
@@ -29,6 +29,7 @@
 #include "isaac.h"
 #include "md5.h"
 #include "bearoffgammon.h"
+#include "evalstore.h"
 #include "positionid.h"
 #include "matchid.h"
 #include "matchequity.h"
@@ -194,18 +195,24 @@ enum {
 #define NUM_INPUTS ((25 * MINPPERPOINT + MORE_INPUTS) * 2)
 #define NUM_RACE_INPUTS ( HALF_RACE_INPUTS * 2 )
 #define NUM_PRUNING_INPUTS (25 * MINPPERPOINT * 2)
+/* row length of the input blocks passed to NeuralNetEvaluateBatch() */
+#define NUM_INPUTS_ALIGNED ((NUM_INPUTS + 7) & ~7)
 
 
 #if !defined(LOCKING_VERSION)
 
 f_FindnSaveBestMoves FindnSaveBestMoves = FindnSaveBestMovesNoLocking;
+f_FindnSaveBestMovesArena FindnSaveBestMovesArena = FindnSaveBestMovesArenaNoLocking;
 f_FindBestMove FindBestMove = FindBestMoveNoLocking;
 f_EvaluatePosition EvaluatePosition = EvaluatePositionNoLocking;
 f_ScoreMove ScoreMove = ScoreMoveNoLocking;
 f_GeneralCubeDecisionE GeneralCubeDecisionE = GeneralCubeDecisionENoLocking;
 f_GeneralEvaluationE GeneralEvaluationE = GeneralEvaluationENoLocking;
+f_EvaluateMovesAhead EvaluateMovesAhead = EvaluateMovesAheadNoLocking;
 
 #define FindnSaveBestMoves FindnSaveBestMovesNoLocking
+#define FindnSaveBestMovesArena FindnSaveBestMovesArenaNoLocking
+#define SaveBestMoves SaveBestMovesNoLocking
 #define FindBestMove FindBestMoveNoLocking
 #define EvaluatePosition EvaluatePositionNoLocking
 #define ScoreMove ScoreMoveNoLocking
@@ -216,10 +223,12 @@ f_GeneralEvaluationE GeneralEvaluationE = GeneralEvaluationENoLocking;
 #define GeneralEvaluationEPlied GeneralEvaluationEPliedNoLocking
 #define EvaluatePositionCubeful3 EvaluatePositionCubeful3NoLocking
 #define ScoreMoves ScoreMovesNoLocking
-#define ScoreMovesPruned ScoreMovesPrunedNoLocking
 #define FindBestMoveInEval FindBestMoveInEvalNoLocking
 #define GeneralEvaluationEPliedCubeful GeneralEvaluationEPliedCubefulNoLocking
 #define EvaluatePositionCubeful4 EvaluatePositionCubeful4NoLocking
+#define EvaluatePositionsBatch EvaluatePositionsBatchNoLocking
+#define EvaluateMovesBatch EvaluateMovesBatchNoLocking
+#define EvaluateMovesAhead EvaluateMovesAheadNoLocking
 #define CacheAdd CacheAddNoLocking
 #define CacheLookup CacheLookupNoLocking
 
@@ -239,15 +248,42 @@ neuralnet nnContact, nnRace, nnCrashed;
 
 neuralnet nnpContact, nnpRace, nnpCrashed;
 
+/* int8 copies of the main nets, used when fQuantizedEval is set */
+static neuralnetq nnqContact, nnqRace, nnqCrashed;
+int fQuantizedEval = FALSE;
+
+/* interior nodes with at least nSplitPlies plies left evaluate their
+ * rolls as separate tasks (0: never) */
+unsigned int nSplitPlies = 0;
+
 bearoffcontext *pbcOS = NULL;
 bearoffcontext *pbcTS = NULL;
 bearoffcontext *pbc1 = NULL;
 bearoffcontext *pbc2 = NULL;
 bearoffcontext *apbcHyper[3] = { NULL, NULL, NULL };
 
-evalCache cEval;
+evalCache acEval[CACHE_MAX_SHARDS];
+unsigned int cCacheShards = 1;
 evalCache cpEval;
 unsigned int cCache;
+
+/* Bumped when the evaluation cache is flushed; the per thread front
+ * caches are flushed lazily when they see a new value */
+int nEvalCacheGeneration = 0;
+
+/* The per thread front caches. They outlive the threads so that their
+ * counters are kept when the number of threads changes. */
+static evalCacheL1 *apCacheL1[MAX_NUMTHREADS + 1];
+
+/* The per thread transposition tables, allocated when a thread first
+ * searches at 2 plies or more. 0 disables them. */
+unsigned int cTranspositions = 1 << 15;
+/* the last search started, by any thread, and the number of times
+ * these numbers wrapped around (see TranspositionsBegin()) */
+int nTranspositionSearch = 0;
+int nTranspositionWrap = 0;
+static transpositionTable *apTT[MAX_NUMTHREADS + 1];
+
 int fInterrupt = FALSE;
 int fMatchCancelled = FALSE;
 
@@ -496,6 +532,12 @@ DestroyWeights(void)
     NeuralNetDestroy(&nnpContact);
     NeuralNetDestroy(&nnpCrashed);
     NeuralNetDestroy(&nnpRace);
+
+    if (nnqContact.pnn) {
+        NeuralNetQuantizedDestroy(&nnqContact);
+        NeuralNetQuantizedDestroy(&nnqCrashed);
+        NeuralNetQuantizedDestroy(&nnqRace);
+    }
 }
 
 extern int
@@ -513,15 +555,27 @@ EvalShutdown(void)
     for (i = 0; i < 3; ++i)
         BearoffClose(apbcHyper[i]);
 
+    EvalStoreClose();
+
     /* destroy neural nets */
 
     DestroyWeights();
 
     /* destroy cache */
 
-    CacheDestroy(&cEval);
+    for (i = 0; i < (int) cCacheShards; ++i)
+        CacheDestroy(&acEval[i]);
     CacheDestroy(&cpEval);
 
+    for (i = 0; i < MAX_NUMTHREADS + 1; ++i) {
+        g_free(apCacheL1[i]);
+        apCacheL1[i] = NULL;
+        if (apTT[i])
+            g_free(apTT[i]->entries);
+        g_free(apTT[i]);
+        apTT[i] = NULL;
+    }
+
     return 0;
 
 }
@@ -628,12 +682,16 @@ EvalInitialise(char *szWeights, char *szWeightsBinary, int fNoBearoff, void (*pf
             exit(EXIT_FAILURE);
         }
 #endif
-        cCache = 0x1 << CACHE_SIZE_DEFAULT;
-        if (CacheCreate(&cEval, cCache)) {
+#if defined(USE_MULTITHREAD)
+        cCacheShards = MIN(MT_GetNumaNodes(), CACHE_MAX_SHARDS);
+#endif
+        if (EvalCacheResize(0x1 << CACHE_SIZE_DEFAULT) < 0) {
             PrintError(_("Evaluation cache allocation failed"));
             return;
         }
 
+        cpEval.nNumaNode = -1;
+        cpEval.fnPlace = NULL;
         if (CacheCreate(&cpEval, 0x1 << 16)) {
             PrintError(_("Evaluation cache allocation failed"));
             return;
@@ -750,6 +808,23 @@ EvalInitialise(char *szWeights, char *szWeightsBinary, int fNoBearoff, void (*pf
         exit(EXIT_FAILURE);
     }
 
+    if (NeuralNetQuantize(&nnqContact, &nnContact) || NeuralNetQuantize(&nnqCrashed, &nnCrashed)
+        || NeuralNetQuantize(&nnqRace, &nnRace)) {
+        outputerrf(_("Failed to build the quantized neural nets."));
+        exit(EXIT_FAILURE);
+    }
+}
+
+/* Select the quantized or float main nets. The cached evaluations come
+ * from the other engine, so the caches are flushed. */
+
+extern void
+EvalSetQuantized(int f)
+{
+    if (f != fQuantizedEval) {
+        fQuantizedEval = f;
+        EvalCacheFlush();
+    }
 }
 
 /* Calculates inputs for any contact position, for one player only. */
@@ -1545,15 +1620,14 @@ menOffNonCrashed(const unsigned int *anBoard, float *afInput)
 
 }
 
-/* Calculates contact neural net inputs from the board position. */
+/* The inputs of the contact net after the base inputs, 2 * MORE_INPUTS
+ * of them. */
 
 static void
-CalculateContactInputs(const TanBoard anBoard, float arInput[])
+ContactMoreInputs(const TanBoard anBoard, float arMore[])
 {
-    baseInputs(anBoard, arInput);
-
     {
-        float *b = arInput + MINPPERPOINT * 25 * 2;
+        float *b = arMore;
 
         /* I accidentally switched sides (0 and 1) when I trained the net */
         menOffNonCrashed(anBoard[0], b + I_OFF1);
@@ -1562,7 +1636,7 @@ CalculateContactInputs(const TanBoard anBoard, float arInput[])
     }
 
     {
-        float *b = arInput + (MINPPERPOINT * 25 * 2 + MORE_INPUTS);
+        float *b = arMore + MORE_INPUTS;
 
         menOffNonCrashed(anBoard[1], b + I_OFF1);
 
@@ -1570,15 +1644,13 @@ CalculateContactInputs(const TanBoard anBoard, float arInput[])
     }
 }
 
-/* Calculates crashed neural net inputs from the board position. */
+/* The inputs of the crashed net after the base inputs */
 
 static void
-CalculateCrashedInputs(const TanBoard anBoard, float arInput[])
+CrashedMoreInputs(const TanBoard anBoard, float arMore[])
 {
-    baseInputs(anBoard, arInput);
-
     {
-        float *b = arInput + MINPPERPOINT * 25 * 2;
+        float *b = arMore;
 
         menOffAll(anBoard[1], b + I_OFF1);
 
@@ -1586,7 +1658,7 @@ CalculateCrashedInputs(const TanBoard anBoard, float arInput[])
     }
 
     {
-        float *b = arInput + (MINPPERPOINT * 25 * 2 + MORE_INPUTS);
+        float *b = arMore + MORE_INPUTS;
 
         menOffAll(anBoard[0], b + I_OFF1);
 
@@ -1594,6 +1666,50 @@ CalculateCrashedInputs(const TanBoard anBoard, float arInput[])
     }
 }
 
+/* Calculates contact neural net inputs from the board position. */
+
+static void
+CalculateContactInputs(const TanBoard anBoard, float arInput[])
+{
+    baseInputs(anBoard, arInput);
+
+    ContactMoreInputs(anBoard, arInput + MINPPERPOINT * 25 * 2);
+}
+
+/* Calculates crashed neural net inputs from the board position. */
+
+static void
+CalculateCrashedInputs(const TanBoard anBoard, float arInput[])
+{
+    baseInputs(anBoard, arInput);
+
+    CrashedMoreInputs(anBoard, arInput + MINPPERPOINT * 25 * 2);
+}
+
+/* The same inputs, as the sparse lists of NeuralNetEvaluateSparse() */
+
+static void
+CalculateContactInputsSparse(const TanBoard anBoard, nnsparse * pns)
+{
+    float arMore[2 * MORE_INPUTS];
+
+    baseInputsSparse(anBoard, pns);
+
+    ContactMoreInputs(anBoard, arMore);
+    SparseInputsAppend(pns, MINPPERPOINT * 25 * 2, arMore, 2 * MORE_INPUTS);
+}
+
+static void
+CalculateCrashedInputsSparse(const TanBoard anBoard, nnsparse * pns)
+{
+    float arMore[2 * MORE_INPUTS];
+
+    baseInputsSparse(anBoard, pns);
+
+    CrashedMoreInputs(anBoard, arMore);
+    SparseInputsAppend(pns, MINPPERPOINT * 25 * 2, arMore, 2 * MORE_INPUTS);
+}
+
 extern void
 swap_us(unsigned int *p0, unsigned int *p1)
 {
@@ -2116,10 +2232,12 @@ EvalRace(const TanBoard anBoard, float arOutput[], const bgvariation bgv, NNStat
 
     CalculateRaceInputs(anBoard, arInput);
 
+    if (fQuantizedEval)
+        NeuralNetEvaluateQuantized(&nnqRace, arInput, arOutput);
 #if defined(USE_SIMD_INSTRUCTIONS)
-    if (NeuralNetEvaluateSSE(&nnRace, arInput, arOutput, nnStates ? nnStates + (CLASS_RACE - CLASS_RACE) : NULL))
+    else if (NeuralNetEvaluateSSE(&nnRace, arInput, arOutput, nnStates ? nnStates + (CLASS_RACE - CLASS_RACE) : NULL))
 #else
-    if (NeuralNetEvaluate(&nnRace, arInput, arOutput, nnStates ? nnStates + (CLASS_RACE - CLASS_RACE) : NULL))
+    else if (NeuralNetEvaluate(&nnRace, arInput, arOutput, nnStates ? nnStates + (CLASS_RACE - CLASS_RACE) : NULL))
 #endif
         return -1;
 
@@ -2132,13 +2250,27 @@ EvalRace(const TanBoard anBoard, float arOutput[], const bgvariation bgv, NNStat
     return 0;
 }
 
+/* Most of the contact and crashed inputs are 0, so unless the evaluation
+ * is incremental (0-ply move scoring, where the base inputs are shared)
+ * only the weights of the others are read. */
+
 static int
 EvalContact(const TanBoard anBoard, float arOutput[], const bgvariation UNUSED(bgv), NNState * nnStates)
 {
     SSE_ALIGN(float arInput[NUM_INPUTS]);
 
+    if (!fQuantizedEval && (!nnStates || nnStates[CLASS_CONTACT - CLASS_RACE].state == NNSTATE_NONE)) {
+        nnsparse ns;
+
+        CalculateContactInputsSparse(anBoard, &ns);
+        return NeuralNetEvaluateSparse(&nnContact, &ns, arOutput);
+    }
+
     CalculateContactInputs(anBoard, arInput);
 
+    if (fQuantizedEval)
+        return NeuralNetEvaluateQuantized(&nnqContact, arInput, arOutput);
+
 #if defined(USE_SIMD_INSTRUCTIONS)
     return NeuralNetEvaluateSSE(&nnContact, arInput, arOutput,
                                 nnStates ? nnStates + (CLASS_CONTACT - CLASS_RACE) : NULL);
@@ -2152,8 +2284,18 @@ EvalCrashed(const TanBoard anBoard, float arOutput[], const bgvariation UNUSED(b
 {
     SSE_ALIGN(float arInput[NUM_INPUTS]);
 
+    if (!fQuantizedEval && (!nnStates || nnStates[CLASS_CRASHED - CLASS_RACE].state == NNSTATE_NONE)) {
+        nnsparse ns;
+
+        CalculateCrashedInputsSparse(anBoard, &ns);
+        return NeuralNetEvaluateSparse(&nnCrashed, &ns, arOutput);
+    }
+
     CalculateCrashedInputs(anBoard, arInput);
 
+    if (fQuantizedEval)
+        return NeuralNetEvaluateQuantized(&nnqCrashed, arInput, arOutput);
+
 #if defined(USE_SIMD_INSTRUCTIONS)
     return NeuralNetEvaluateSSE(&nnCrashed, arInput, arOutput,
                                 nnStates ? nnStates + (CLASS_CRASHED - CLASS_RACE) : NULL);
@@ -2162,6 +2304,97 @@ EvalCrashed(const TanBoard anBoard, float arOutput[], const bgvariation UNUSED(b
 #endif
 }
 
+/* Static evaluation of the c positions aanBoard[ai[0..c-1]], all of
+ * class pc (race, crashed or contact), as one block through
+ * NeuralNetEvaluateBatch(). The outputs are post-processed as
+ * EvaluatePositionFull() does for a single leaf. */
+
+extern int
+EvalNetBatch(positionclass pc, const TanBoard aanBoard[], const unsigned int ai[], unsigned int c,
+             float *aarOutput[], const bgvariation bgv)
+{
+    SSE_ALIGN(float aarInput[NN_BATCH_MAX][NUM_INPUTS_ALIGNED]);
+    float *apInput[NN_BATCH_MAX];
+    neuralnet *pnn;
+    unsigned int k;
+
+    g_assert(c <= NN_BATCH_MAX && pc >= CLASS_RACE);
+
+    pnn = pc == CLASS_RACE ? &nnRace : pc == CLASS_CRASHED ? &nnCrashed : &nnContact;
+
+    for (k = 0; k < c; k++) {
+        apInput[k] = aarInput[k];
+
+        if (pc == CLASS_RACE)
+            CalculateRaceInputs(aanBoard[ai[k]], aarInput[k]);
+        else if (pc == CLASS_CRASHED)
+            CalculateCrashedInputs(aanBoard[ai[k]], aarInput[k]);
+        else
+            CalculateContactInputs(aanBoard[ai[k]], aarInput[k]);
+    }
+
+    if (fQuantizedEval) {
+        const neuralnetq *pnq = pc == CLASS_RACE ? &nnqRace : pc == CLASS_CRASHED ? &nnqCrashed : &nnqContact;
+
+        for (k = 0; k < c; k++)
+            NeuralNetEvaluateQuantized(pnq, apInput[k], aarOutput[k]);
+    } else if (NeuralNetEvaluateBatch(pnn, c, apInput, aarOutput))
+        return -1;
+
+    for (k = 0; k < c; k++) {
+        /* special evaluation of backgammons overrides net output */
+        if (pc == CLASS_RACE)
+            EvalRaceBG(aanBoard[ai[k]], aarOutput[k], bgv);
+
+        SanityCheck(aanBoard[ai[k]], aarOutput[k]);
+    }
+
+    return 0;
+}
+
+/* Evaluate a race, crashed or contact position with both the float and
+ * the quantized nets (raw net outputs, no post-processing). Returns the
+ * class of the position, or -1 if it is not evaluated by these nets. */
+
+extern int
+EvalQuantizedCompare(const TanBoard anBoard, const bgvariation bgv, float arFloat[NUM_OUTPUTS],
+                     float arQuantized[NUM_OUTPUTS])
+{
+    SSE_ALIGN(float arInput[NUM_INPUTS]);
+    positionclass pc = ClassifyPosition(anBoard, bgv);
+    neuralnet *pnn;
+    const neuralnetq *pnq;
+
+    switch (pc) {
+    case CLASS_RACE:
+        CalculateRaceInputs(anBoard, arInput);
+        pnn = &nnRace;
+        pnq = &nnqRace;
+        break;
+    case CLASS_CRASHED:
+        CalculateCrashedInputs(anBoard, arInput);
+        pnn = &nnCrashed;
+        pnq = &nnqCrashed;
+        break;
+    case CLASS_CONTACT:
+        CalculateContactInputs(anBoard, arInput);
+        pnn = &nnContact;
+        pnq = &nnqContact;
+        break;
+    default:
+        return -1;
+    }
+
+    NeuralNetEvaluateQuantized(pnq, arInput, arQuantized);
+#if defined(USE_SIMD_INSTRUCTIONS)
+    NeuralNetEvaluateSSE(pnn, arInput, arFloat, NULL);
+#else
+    NeuralNetEvaluate(pnn, arInput, arFloat, NULL);
+#endif
+
+    return (int) pc;
+}
+
 extern int
 EvalOver(const TanBoard anBoard, float arOutput[], const bgvariation bgv, NNState * UNUSED(nnStates))
 {
@@ -2880,6 +3113,9 @@ GenerateMoves(movelist * pml, const TanBoard anBoard, int n0, int n1, int fParti
 {
 
     int anRoll[4], anMoves[8];
+    perfcounters *ppc = MT_GetPerf();
+    uint64_t t0 = PerfStart();
+
     anRoll[0] = n0;
     anRoll[1] = n1;
 
@@ -2895,6 +3131,9 @@ GenerateMoves(movelist * pml, const TanBoard anBoard, int n0, int n1, int fParti
         GenerateMovesSub(pml, anRoll, 0, 23, 0, anBoard, anMoves, fPartial);
     }
 
+    ppc->cGenerateMoves++;
+    PerfStop(ppc, PERF_TIMER_GENERATE, t0);
+
     return pml->cMoves;
 }
 
@@ -3187,7 +3426,14 @@ GetCubeRecommendation(const cubedecision cd)
 extern void
 EvalCacheFlush(void)
 {
-    CacheFlush(&cEval);
+    unsigned int i;
+
+    for (i = 0; i < cCacheShards; ++i)
+        CacheFlush(&acEval[i]);
+
+    ++nEvalCacheGeneration;
+
+    EvalStoreSettingsChanged();
 }
 
 void
@@ -3199,10 +3445,10 @@ CommandClearCache(char *UNUSED(sz))
 extern double
 GetEvalCacheSize(void)
 {
-    if (cEval.size == 0)
+    if (cCache == 0)
         return 0;
     else {
-        double value = log(cEval.size) / log(2);
+        double value = log(cCache) / log(2);
         if (value < 15)
             return 0;
         if (value < 17)
@@ -3235,18 +3481,138 @@ GetCacheMB(int size)
         return (1 << (size + 15)) * (int) sizeof(cacheNode) / (1024 * 1024);
 }
 
+/* The shards get an equal share of cNew, rounded down to a power of 2.
+ * Shard i is used by the threads of node i (see EvalCacheShard()), so
+ * its pages are bound to that node before CacheCreate() first touches
+ * them from the calling thread. */
+
 extern int
 EvalCacheResize(unsigned int cNew)
 {
-    cCache = CacheResize(&cEval, cNew);
-    return cCache;
+    unsigned int cShard = cNew / cCacheShards;
+    unsigned int i;
+
+    while ((cShard & (cShard - 1)) != 0)
+        cShard &= (cShard - 1);
+
+    for (i = 0; i < cCacheShards; ++i) {
+        acEval[i].nNumaNode = cCacheShards > 1 ? (int) i : -1;
+#if defined(USE_MULTITHREAD)
+        acEval[i].fnPlace = MT_BindToNumaNode;
+#endif
+        if (CacheResize(&acEval[i], cShard) < 0) {
+            cCache = 0;
+            return -1;
+        }
+    }
+
+    cCache = cShard * cCacheShards;
+    ++nEvalCacheGeneration;
+
+    return (int) cCache;
+}
+
+/* Front cache for thread id (-1 for the main thread) */
+
+extern evalCacheL1 *
+EvalCacheL1(int id)
+{
+    unsigned int i = (unsigned int) (id + 1);
+
+    g_assert(i <= MAX_NUMTHREADS);
+
+    if (!apCacheL1[i]) {
+        apCacheL1[i] = g_malloc0(sizeof(evalCacheL1));
+        CacheL1Flush(apCacheL1[i]);
+        apCacheL1[i]->nGeneration = nEvalCacheGeneration;
+    }
+
+    return apCacheL1[i];
+}
+
+/* Transposition table for thread id (-1 for the main thread); the
+ * entries are allocated by TranspositionsBegin() */
+
+extern transpositionTable *
+EvalTranspositions(int id)
+{
+    unsigned int i = (unsigned int) (id + 1);
+
+    g_assert(i <= MAX_NUMTHREADS);
+
+    if (!apTT[i])
+        apTT[i] = g_malloc0(sizeof(transpositionTable));
+
+    return apTT[i];
+}
+
+/* Set the number of entries of each thread's table, rounded down to a
+ * power of 2. The threads resize their own tables when they start their
+ * next search. */
+
+extern int
+EvalTranspositionsResize(unsigned int cNew)
+{
+    while ((cNew & (cNew - 1)) != 0)
+        cNew &= (cNew - 1);
+
+    cTranspositions = cNew == 1 ? 2 : cNew;
+
+    return (int) cTranspositions;
+}
+
+extern void
+EvalTranspositionsStats(uint64_t * pcLookup, uint64_t * pcHit)
+{
+    unsigned int i;
+
+    *pcLookup = *pcHit = 0;
+
+    for (i = 0; i < MAX_NUMTHREADS + 1; ++i)
+        if (apTT[i]) {
+            *pcLookup += apTT[i]->cLookup;
+            *pcHit += apTT[i]->cHit;
+        }
+}
+
+/* Lookups and hits per cache level, since startup. The counters of the
+ * running threads are read without synchronisation; they may be
+ * slightly behind. */
+
+extern void
+EvalCacheStats(uint64_t acLookup[N_CACHE_LEVELS], uint64_t acHit[N_CACHE_LEVELS])
+{
+    unsigned int i;
+
+    memset(acLookup, 0, N_CACHE_LEVELS * sizeof(uint64_t));
+    memset(acHit, 0, N_CACHE_LEVELS * sizeof(uint64_t));
+
+    for (i = 0; i < MAX_NUMTHREADS + 1; ++i) {
+        const evalCacheL1 *pl1 = apCacheL1[i];
+
+        if (!pl1)
+            continue;
+
+        acLookup[CACHE_LEVEL_THREAD] += pl1->cLookup;
+        acHit[CACHE_LEVEL_THREAD] += pl1->cHit;
+        acLookup[CACHE_LEVEL_SHARED] += pl1->cLookup - pl1->cHit;
+        acHit[CACHE_LEVEL_SHARED] += pl1->cSharedHit;
+    }
 }
 
 #if CACHE_STATS
 extern int
-EvalCacheStats(unsigned int *pcUsed, unsigned int *pcLookup, unsigned int *pcHit)
+EvalCacheUsage(unsigned int *pcUsed, unsigned int *pcLookup, unsigned int *pcHit)
 {
-    CacheStats(&cEval, pcLookup, pcHit, pcUsed);
+    unsigned int i, cUsed, cLookup, cHit;
+
+    pcUsed[0] = pcLookup[0] = pcHit[0] = 0;
+    for (i = 0; i < cCacheShards; ++i) {
+        CacheStats(&acEval[i], &cLookup, &cHit, &cUsed);
+        pcUsed[0] += cUsed;
+        pcLookup[0] += cLookup;
+        pcHit[0] += cHit;
+    }
     CacheStats(&cpEval, pcLookup + 1, pcHit + 1, pcUsed + 1);
     return 0;
 }
@@ -5040,13 +5406,17 @@ getPercent(const cubedecision cd, const float arDouble[])
 extern void
 RefreshMoveList(movelist * pml, int *ai)
 {
-    movelist ml;
+    arena *pa = MT_GetArena();
+    arenamark mark = ArenaMark(pa);
+    move *amOld = NULL;
 
     if (!pml->cMoves)
         return;
 
-    if (ai)
-        CopyMoveList(&ml, pml);
+    if (ai) {
+        amOld = (move *) ArenaAlloc(pa, pml->cMoves * sizeof(move));
+        memcpy(amOld, pml->amMoves, pml->cMoves * sizeof(move));
+    }
 
     qsort(pml->amMoves, pml->cMoves, sizeof(move), (cfunc) CompareMovesGeneral);
 
@@ -5057,13 +5427,13 @@ RefreshMoveList(movelist * pml, int *ai)
 
             for (unsigned int j = 0; j < pml->cMoves; j++) {
 
-                if (!memcmp(ml.amMoves[j].anMove, pml->amMoves[i].anMove, 8 * sizeof(int)))
+                if (!memcmp(amOld[j].anMove, pml->amMoves[i].anMove, 8 * sizeof(int)))
                     ai[j] = i;
 
             }
         }
 
-        g_free(ml.amMoves);
+        ArenaRelease(pa, mark);
     }
 }
 
@@ -5271,6 +5641,8 @@ DoubleType(const int fDoubled, const int fMove, const int fTurn)
 #else
 
 #define FindnSaveBestMoves FindnSaveBestMovesWithLocking
+#define FindnSaveBestMovesArena FindnSaveBestMovesArenaWithLocking
+#define SaveBestMoves SaveBestMovesWithLocking
 #define FindBestMove FindBestMoveWithLocking
 #define EvaluatePosition EvaluatePositionWithLocking
 #define ScoreMove ScoreMoveWithLocking
@@ -5281,10 +5653,12 @@ DoubleType(const int fDoubled, const int fMove, const int fTurn)
 #define GeneralEvaluationEPlied GeneralEvaluationEPliedWithLocking
 #define EvaluatePositionCubeful3 EvaluatePositionCubeful3WithLocking
 #define ScoreMoves ScoreMovesWithLocking
-#define ScoreMovesPruned ScoreMovesPrunedWithLocking
 #define FindBestMoveInEval FindBestMoveInEvalWithLocking
 #define GeneralEvaluationEPliedCubeful GeneralEvaluationEPliedCubefulWithLocking
 #define EvaluatePositionCubeful4 EvaluatePositionCubeful4WithLocking
+#define EvaluatePositionsBatch EvaluatePositionsBatchWithLocking
+#define EvaluateMovesBatch EvaluateMovesBatchWithLocking
+#define EvaluateMovesAhead EvaluateMovesAheadWithLocking
 #define CacheAdd CacheAddWithLocking
 #define CacheLookup CacheLookupWithLocking
 
@@ -5302,12 +5676,173 @@ static int GeneralEvaluationEPlied(NNState * nnStates, float arOutput[NUM_ROLLOU
 static int EvaluatePositionCubeful3(NNState * nnStates, const TanBoard anBoard, float arOutput[NUM_OUTPUTS],
                                     float arCubeful[], const cubeinfo aciCubePos[], int cci, cubeinfo * const pciMove,
                                     const evalcontext * pec, int nPlies, int fTop);
+static int SaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoard, positionkey * keyMove,
+                         const float rThr, const cubeinfo * pci, const evalcontext * pec,
+                         movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES], arena * pa);
 
 /* Functions that have both locking and non-locking versions below here */
 
-static int ScoreMoves(movelist * pml, const cubeinfo * pci, const evalcontext * pec, int nPlies);
-static int ScoreMovesPruned(movelist * pml, const cubeinfo * pci, const evalcontext * pec, unsigned int *bmovesi,
-                            unsigned int prune_moves);
+/* Evaluation cache access: the thread's front cache first, then the
+ * shard of its NUMA node. Returns CACHEHIT or the value to pass to
+ * EvalCacheAdd(). */
+
+static inline evalCache *
+EvalCacheShard(const ThreadLocalData * ptld)
+{
+    return &acEval[(unsigned int) ptld->nNumaNode % cCacheShards];
+}
+
+static inline uint32_t
+EvalCacheLookup(const evalcache * pec, float arOutput[], float *arCubeful)
+{
+    const ThreadLocalData *ptld = MT_GetTLD();
+    evalCacheL1 *pl1 = ptld->pCacheL1;
+    float rCubeful;
+    uint32_t l;
+
+    if (pl1->nGeneration != nEvalCacheGeneration) {
+        CacheL1Flush(pl1);
+        pl1->nGeneration = nEvalCacheGeneration;
+    }
+
+    ++pl1->cLookup;
+    if (CacheL1Lookup(pl1, pec, arOutput, arCubeful)) {
+        ++pl1->cHit;
+        return CACHEHIT;
+    }
+
+    if ((l = CacheLookup(EvalCacheShard(ptld), pec, arOutput, &rCubeful)) == CACHEHIT) {
+        evalcache ec = *pec;
+
+        memcpy(ec.ar, arOutput, sizeof(float) * NUM_OUTPUTS);
+        ec.ar[5] = rCubeful;
+        CacheL1Add(pl1, &ec);
+
+        if (arCubeful)
+            *arCubeful = rCubeful;
+        ++pl1->cSharedHit;
+    }
+
+    return l;
+}
+
+static inline void
+EvalCacheAdd(const evalcache * pec, uint32_t l)
+{
+    const ThreadLocalData *ptld = MT_GetTLD();
+
+    CacheL1Add(ptld->pCacheL1, pec);
+    CacheAdd(EvalCacheShard(ptld), pec, l);
+}
+
+/* Allocate (or resize) the entries of a thread's table if needed and
+ * make nSearch its current search. Only the owner does this, between
+ * two searches. Search numbers are shared by all the threads, so that
+ * tasks of one search running elsewhere (see ScoreMovesParallel()) keep
+ * the entries they made for each other, and the entries of other
+ * searches never match. They are only cleared once the numbers have
+ * wrapped around. */
+
+static void
+TranspositionsSetSearch(transpositionTable * ptt, unsigned int nSearch, unsigned int c)
+{
+    unsigned int const nWrap = (unsigned int) MT_SafeGet(&nTranspositionWrap);
+
+    if (!ptt->entries || (1u << ptt->cBits) != c) {
+        g_free(ptt->entries);
+        ptt->entries = g_malloc0(c * sizeof(transpositionEntry));
+        for (ptt->cBits = 0; (1u << ptt->cBits) < c; ++ptt->cBits);
+        ptt->nWrap = nWrap;
+    } else if (ptt->nWrap != nWrap) {
+        memset(ptt->entries, 0, c * sizeof(transpositionEntry));
+        ptt->nWrap = nWrap;
+    }
+
+    ptt->nSearch = nSearch;
+}
+
+/* Searches at 2 plies or more use the thread's transposition table.
+ * Searches started inside another one (ScoreMove() for the candidates
+ * of FindnSaveBestMoves(), ...) carry on with the same entries.
+ * Returns what to pass to TranspositionsEnd(). */
+
+static transpositionTable *
+TranspositionsBegin(unsigned int nPlies)
+{
+    transpositionTable *ptt = MT_GetTLD()->pTT;
+    unsigned int const c = cTranspositions;
+    unsigned int nSearch;
+
+    if (ptt->cDepth) {
+        ++ptt->cDepth;
+        return ptt;
+    }
+
+    if (nPlies < 2 || !c)
+        return NULL;
+
+    /* 0 means no search */
+    while ((nSearch = (unsigned int) MT_SafeIncValue(&nTranspositionSearch)) == 0)
+        MT_SafeInc(&nTranspositionWrap);
+
+    TranspositionsSetSearch(ptt, nSearch, c);
+    ptt->cDepth = 1;
+
+    return ptt;
+}
+
+/* Carry on search nSearch (0 for none) of another thread, for one of
+ * its tasks */
+
+static transpositionTable *
+TranspositionsJoin(unsigned int nSearch)
+{
+    transpositionTable *ptt = MT_GetTLD()->pTT;
+    unsigned int const c = cTranspositions;
+
+    if (ptt->cDepth) {
+        /* the thread is waiting for the task in this very search */
+        ++ptt->cDepth;
+        return ptt;
+    }
+
+    if (!nSearch || !c)
+        return NULL;
+
+    TranspositionsSetSearch(ptt, nSearch, c);
+    ptt->cDepth = 1;
+
+    return ptt;
+}
+
+static inline void
+TranspositionsEnd(transpositionTable * ptt)
+{
+    if (ptt)
+        --ptt->cDepth;
+}
+
+/* The table of the search in progress, if any */
+
+static inline transpositionTable *
+ActiveTranspositions(void)
+{
+    transpositionTable *ptt = MT_GetTLD()->pTT;
+
+    return ptt->cDepth ? ptt : NULL;
+}
+
+/* Evaluations kept in the persistent store (see evalstore.c): the
+ * expensive ones, from the float nets, standard variation only */
+
+static inline int
+UseEvalStore(int nPlies, const cubeinfo * pci)
+{
+    return MT_SafeGet(&fEvalStore) && nPlies > 0 && pci->bgv == VARIATION_STANDARD && !fQuantizedEval;
+}
+
+static int ScoreMoves(movelist * pml, const unsigned int *ai, unsigned int cMoves, const cubeinfo * pci,
+                      const evalcontext * pec, int nPlies);
 /*
  * The pruning nets select the best MIN_PRUNE_MOVES +
  * floor(log2(number of legal moves)) moves instead of 10 as they used
@@ -5328,6 +5863,10 @@ FindBestMoveInEval(NNState * nnStates, int const nDice0, int const nDice1, const
     positionclass evalClass = CLASS_OVER;
     unsigned int bmovesi[MAX_PRUNE_MOVES];
     unsigned int prune_moves;
+    perfcounters *ppc;
+    arena *pa;
+    arenamark mark;
+    float *arPrune;
 
     GenerateMoves(&ml, anBoardIn, nDice0, nDice1, FALSE);
 
@@ -5347,12 +5886,19 @@ FindBestMoveInEval(NNState * nnStates, int const nDice0, int const nDice1, const
     prune_moves = MIN_PRUNE_MOVES + LogCube(ml.cMoves);
 
     if (ml.cMoves <= prune_moves) {
-        ScoreMoves(&ml, pci, pec, 0);
+        ScoreMoves(&ml, NULL, ml.cMoves, pci, pec, 0);
         PositionFromKey(anBoardOut, &ml.amMoves[ml.iMoveBest].key);
         return;
     }
 
     pci->fMove = !pci->fMove;
+    ppc = MT_GetPerf();
+
+    /* the pruning scores are kept apart from the moves, where the
+     * selection below reads them */
+    pa = MT_GetArena();
+    mark = ArenaMark(pa);
+    arPrune = (float *) ArenaAlloc(pa, ml.cMoves * sizeof(float));
 
     for (i = 0; i < ml.cMoves; i++) {
         positionclass pc;
@@ -5376,20 +5922,24 @@ FindBestMoveInEval(NNState * nnStates, int const nDice0, int const nDice1, const
         CopyKey(pm->key, ec.key);
         ec.nEvalContext = 0;
         if ((l = CacheLookup(&cpEval, &ec, arOutput, NULL)) != CACHEHIT) {
-            SSE_ALIGN(float arInput[NUM_PRUNING_INPUTS]);
-
-            baseInputs((ConstTanBoard) anBoardOut, arInput);
             {
                 const neuralnet *nets[] = { &nnpRace, &nnpCrashed, &nnpContact };
                 const neuralnet *n = nets[pc - CLASS_RACE];
 #if defined(USE_SIMD_INSTRUCTIONS)
+                nnsparse ns;
+
                 (void) nnStates;        /* silence compiler warning */
-                NeuralNetEvaluateSSE(n, arInput, arOutput, NULL);
+                baseInputsSparse((ConstTanBoard) anBoardOut, &ns);
+                NeuralNetEvaluateSparse(n, &ns, arOutput);
 #else
+                SSE_ALIGN(float arInput[NUM_PRUNING_INPUTS]);
+
+                baseInputs((ConstTanBoard) anBoardOut, arInput);
                 if (nnStates)
                     nnStates[pc - CLASS_RACE].state = (i == 0) ? NNSTATE_INCREMENTAL : NNSTATE_DONE;
                 NeuralNetEvaluate(n, arInput, arOutput, nnStates);
 #endif
+                ppc->acEval[pc]++;
                 if (pc == CLASS_RACE)
                     /* special evaluation of backgammons
                      * overrides net output */
@@ -5401,18 +5951,18 @@ FindBestMoveInEval(NNState * nnStates, int const nDice0, int const nDice1, const
             ec.ar[5] = 0.f;
             CacheAdd(&cpEval, &ec, l);
         }
-        pm->rScore = UtilityME(arOutput, pci);
+        arPrune[i] = UtilityME(arOutput, pci);
         if (i < prune_moves) {
             bmovesi[i] = i;
-            if (pm->rScore > ml.amMoves[bmovesi[0]].rScore) {
+            if (arPrune[i] > arPrune[bmovesi[0]]) {
                 bmovesi[i] = bmovesi[0];
                 bmovesi[0] = i;
             }
-        } else if (pm->rScore < ml.amMoves[bmovesi[0]].rScore) {
+        } else if (arPrune[i] < arPrune[bmovesi[0]]) {
             unsigned int m = 0, k;
             bmovesi[0] = i;
             for (k = 1; k < prune_moves; ++k) {
-                if (ml.amMoves[bmovesi[k]].rScore > ml.amMoves[bmovesi[m]].rScore) {
+                if (arPrune[bmovesi[k]] > arPrune[bmovesi[m]]) {
                     m = k;
                 }
             }
@@ -5422,15 +5972,344 @@ FindBestMoveInEval(NNState * nnStates, int const nDice0, int const nDice1, const
     }
 
     pci->fMove = !pci->fMove;
+    ArenaRelease(pa, mark);
 
     if (i == ml.cMoves)
-        ScoreMovesPruned(&ml, pci, pec, bmovesi, prune_moves);
+        ScoreMoves(&ml, bmovesi, prune_moves, pci, pec, 0);
     else
-        ScoreMoves(&ml, pci, pec, 0);
+        ScoreMoves(&ml, NULL, ml.cMoves, pci, pec, 0);
 
     PositionFromKey(anBoardOut, &ml.amMoves[ml.iMoveBest].key);
 }
 
+static const bearoffcontext *
+BearoffClassContext(positionclass pc)
+{
+    switch (pc) {
+    case CLASS_BEAROFF2:
+        return pbc2;
+    case CLASS_BEAROFF_TS:
+        return pbcTS;
+    case CLASS_BEAROFF1:
+        return pbc1;
+    case CLASS_BEAROFF_OS:
+        return pbcOS;
+    default:
+        g_assert_not_reached();
+        return NULL;
+    }
+}
+
+/* Evaluate the cache misses among c positions of class pc (bearoff
+ * database, race, crashed or contact) as one block and add them to the
+ * evaluation cache. */
+
+static void
+EvaluateBatchClass(positionclass pc, const TanBoard aanBoard[], const unsigned int ai[],
+                   evalcache aec[], const uint32_t al[], unsigned int c, bgvariation bgv)
+{
+    float *apOutput[NN_BATCH_MAX];
+    perfcounters *ppc = MT_GetPerf();
+    uint64_t t0 = PerfStart();
+    unsigned int k;
+
+    for (k = 0; k < c; k++)
+        apOutput[k] = aec[k].ar;
+
+    if (pc < CLASS_RACE) {
+        if (BearoffEvalBatch(BearoffClassContext(pc), aanBoard, ai, c, apOutput))
+            return;
+    } else if (EvalNetBatch(pc, aanBoard, ai, c, apOutput, bgv))
+        return;
+
+    ppc->acEval[pc] += c;
+    PerfStop(ppc, PERF_TIMER_EVAL, t0);
+
+    for (k = 0; k < c; k++) {
+        aec[k].ar[5] = 0.f;
+        EvalCacheAdd(&aec[k], al[k]);
+    }
+}
+
+/* Pre-evaluate cBoards positions at 0-ply for the evaluation context
+ * pec. The neural net and bearoff database evaluations are done in
+ * blocks and stored in the cache, so that the following
+ * EvaluatePositionCache() calls for these positions are cache hits.
+ * Only the classes from pcFirst up are considered; cubeful leaves
+ * evaluate two-sided bearoff positions without the cache. Does nothing
+ * when the evaluation can't be cached. */
+
+static void
+EvaluatePositionsBatch(const TanBoard aanBoard[], unsigned int cBoards, const cubeinfo * pci,
+                       const evalcontext * pec, positionclass pcFirst)
+{
+    evalcache aec[NN_BATCH_MAX];
+    uint32_t al[NN_BATCH_MAX];
+    unsigned int ai[NN_BATCH_MAX];
+    float arOutput[NUM_OUTPUTS];
+    positionclass *apc;
+    positionclass pc;
+    perfcounters *ppc;
+    unsigned int i, k, c;
+    int nEvalContext;
+
+    if (!cCache || pec->rNoise != 0.0f)
+        return;
+
+    ppc = MT_GetPerf();
+
+    nEvalContext = EvalKey(pec, 0, pci, FALSE);
+
+    apc = (positionclass *) g_alloca(cBoards * sizeof(positionclass));
+    for (i = 0; i < cBoards; i++)
+        apc[i] = ClassifyPosition(aanBoard[i], pci->bgv);
+
+    for (pc = pcFirst; pc <= CLASS_CONTACT; pc++) {
+        for (c = 0, i = 0; i < cBoards; i++) {
+            if (apc[i] != pc)
+                continue;
+
+            PositionKey(aanBoard[i], &aec[c].key);
+            aec[c].nEvalContext = nEvalContext;
+
+            for (k = 0; k < c; k++)
+                if (EqualKeys(aec[k].key, aec[c].key))
+                    break;
+
+            if (k < c)
+                continue;
+
+            ppc->acLookup[0]++;
+            if ((al[c] = EvalCacheLookup(&aec[c], arOutput, NULL)) == CACHEHIT) {
+                ppc->acHit[0]++;
+                continue;
+            }
+
+            ai[c] = i;
+
+            if (++c == NN_BATCH_MAX) {
+                EvaluateBatchClass(pc, aanBoard, ai, aec, al, c, pci->bgv);
+                c = 0;
+            }
+        }
+
+        if (c)
+            EvaluateBatchClass(pc, aanBoard, ai, aec, al, c, pci->bgv);
+    }
+}
+
+/* Pre-evaluate at 0-ply the positions after the cMoves moves akey[]
+ * by the player on roll in pci, ahead of ScoreMove() or FindBestMove()
+ * with pec. The moves may come from several move lists. */
+
+extern void
+EvaluateMovesAhead(const positionkey akey[], unsigned int cMoves, const cubeinfo * pci, const evalcontext * pec)
+{
+    TanBoard aanBoard[NN_BATCH_MAX];
+    cubeinfo ci = *pci;
+    unsigned int i, j, c;
+    positionclass pcFirst = CLASS_BEAROFF2;
+
+    /* ScoreMove() evaluates from the opponent's point of view, and
+     * cubeful evaluations use ecBasic at the leaves */
+    ci.fMove = !ci.fMove;
+    if (pec->fCubeful) {
+        pec = &ecBasic;
+        pcFirst = CLASS_BEAROFF1;
+    }
+
+    for (i = 0; i < cMoves; i += c) {
+        c = MIN(cMoves - i, NN_BATCH_MAX);
+
+        for (j = 0; j < c; j++)
+            PositionFromKeySwapped(aanBoard[j], &akey[i + j]);
+
+        EvaluatePositionsBatch((const TanBoard *) aanBoard, c, &ci, pec, pcFirst);
+    }
+}
+
+/* Pre-evaluate the positions after the moves of pml (all of them, or
+ * the cMoves listed in ai) at 0-ply, ahead of ScoreMove(). */
+
+static void
+EvaluateMovesBatch(const movelist * pml, const unsigned int *ai, unsigned int cMoves,
+                   const cubeinfo * pci, const evalcontext * pec)
+{
+    arena *pa = MT_GetArena();
+    arenamark mark = ArenaMark(pa);
+    positionkey *akey = (positionkey *) ArenaAlloc(pa, cMoves * sizeof(positionkey));
+    unsigned int i;
+
+    for (i = 0; i < cMoves; i++)
+        akey[i] = pml->amMoves[ai ? ai[i] : i].key;
+
+    EvaluateMovesAhead(akey, cMoves, pci, pec);
+
+    ArenaRelease(pa, mark);
+}
+
+#if defined(LOCKING_VERSION)
+/* One roll of an interior node: the best move for the player on roll
+ * in pci, then the evaluation of the resulting position one ply less
+ * deep (cubeful if aciCube is set). With fMoveOnly the resulting
+ * position is left in anBoardNew for the caller to evaluate. */
+typedef struct {
+    const TanBoard *panBoard;
+    const cubeinfo *pci;
+    const cubeinfo *aciCube;
+    int cciCube;
+    const evalcontext *pec;
+    unsigned int nPlies;
+    int n0, n1;
+    int fUsePrune;
+    int fMoveOnly;
+    TanBoard anBoardNew;
+    float ar[NUM_OUTPUTS];
+    float *arCf;
+    int r;
+} evalrolltask;
+
+static void
+EvaluateRollTask(void *p)
+{
+    evalrolltask *pert = (evalrolltask *) p;
+    NNState *nnStates = MT_Get_nnState();
+    cubeinfo ci = *pert->pci;
+    cubeinfo ciOpp;
+    TanBoard *panBoardNew = &pert->anBoardNew;
+
+    if (fInterrupt) {
+        pert->r = -1;
+        return;
+    }
+
+    memcpy(*panBoardNew, *pert->panBoard, sizeof(TanBoard));
+
+    if (pert->fUsePrune)
+        FindBestMoveInEval(nnStates, pert->n0, pert->n1, *pert->panBoard, *panBoardNew, &ci, pert->pec);
+    else
+        FindBestMovePlied(NULL, pert->n0, pert->n1, *panBoardNew, &ci, pert->pec, 0, defaultFilters);
+
+    SwapSides(*panBoardNew);
+
+    if (pert->fMoveOnly) {
+        pert->r = 0;
+        return;
+    }
+
+    SetCubeInfo(&ciOpp, ci.nCube, ci.fCubeOwner, !ci.fMove, ci.nMatchTo, ci.anScore, ci.fCrawford, ci.fJacoby,
+                ci.fBeavers, ci.bgv);
+
+    if (pert->aciCube)
+        pert->r = EvaluatePositionCubeful3(nnStates, (ConstTanBoard) * panBoardNew, pert->ar, pert->arCf,
+                                           pert->aciCube, pert->cciCube, &ciOpp, pert->pec, (int) pert->nPlies - 1,
+                                           FALSE);
+    else
+        pert->r = EvaluatePositionCache(nnStates, (ConstTanBoard) * panBoardNew, pert->ar, &ciOpp, pert->pec,
+                                        (int) pert->nPlies - 1, ClassifyPosition((ConstTanBoard) * panBoardNew,
+                                                                                 ciOpp.bgv));
+}
+
+/* Evaluate the 21 rolls of an interior node on the thread pool and sum
+ * them up, weighted, in the same order as the sequential loops. At 1 ply
+ * the tasks only find the moves: the leaves are then evaluated as one
+ * block, as EvaluatePositionFull() does. */
+
+static int
+EvaluateRollsParallel(const TanBoard anBoard, float arOutput[NUM_OUTPUTS], float arCf[],
+                      const cubeinfo * pci, const cubeinfo aciCube[], int cciCube,
+                      const evalcontext * pec, unsigned int nPlies, int fUsePrune)
+{
+    arena *pa = MT_GetArena();
+    arenamark mark = ArenaMark(pa);
+    evalrolltask *aert = (evalrolltask *) ArenaAlloc(pa, 21 * sizeof(evalrolltask));
+    float *arCfAll = aciCube ? (float *) ArenaAlloc(pa, 21 * cciCube * sizeof(float)) : NULL;
+    TaskGroup tg = { 0 };
+    int const fLeaves = nPlies == 1 && !aciCube;
+    int i, n0, n1, iRoll;
+    int r = 0;
+
+    for (iRoll = 0, n0 = 1; n0 <= 6; n0++) {
+        for (n1 = 1; n1 <= n0; n1++, iRoll++) {
+            evalrolltask *pert = aert + iRoll;
+
+            pert->panBoard = (const TanBoard *) anBoard;
+            pert->pci = pci;
+            pert->aciCube = aciCube;
+            pert->cciCube = cciCube;
+            pert->pec = pec;
+            pert->nPlies = nPlies;
+            pert->n0 = n0;
+            pert->n1 = n1;
+            pert->fUsePrune = fUsePrune;
+            pert->fMoveOnly = fLeaves;
+            pert->arCf = arCfAll ? arCfAll + iRoll * cciCube : NULL;
+            pert->r = -1;       /* until the task has run */
+
+            MT_AddGroupTask(&tg, EvaluateRollTask, pert);
+        }
+    }
+
+    /* dropped tasks would leave their rolls out of the sum */
+    if (MT_WaitForGroup(&tg) < 0 || fInterrupt) {
+        if (fInterrupt)
+            errno = EINTR;
+        r = -1;
+        goto done;
+    }
+
+    if (fLeaves) {
+        NNState *nnStates = MT_Get_nnState();
+        TanBoard *aanBoardNew = (TanBoard *) ArenaAlloc(pa, 21 * sizeof(TanBoard));
+        cubeinfo ciOpp;
+
+        SetCubeInfo(&ciOpp, pci->nCube, pci->fCubeOwner, !pci->fMove,
+                    pci->nMatchTo, pci->anScore, pci->fCrawford, pci->fJacoby, pci->fBeavers, pci->bgv);
+
+        for (iRoll = 0; iRoll < 21; iRoll++) {
+            if (aert[iRoll].r || fInterrupt) {
+                errno = EINTR;
+                r = -1;
+                goto done;
+            }
+            memcpy(aanBoardNew[iRoll], aert[iRoll].anBoardNew, sizeof(TanBoard));
+        }
+
+        EvaluatePositionsBatch((const TanBoard *) aanBoardNew, 21, &ciOpp, pec, CLASS_BEAROFF2);
+
+        for (iRoll = 0; iRoll < 21; iRoll++)
+            aert[iRoll].r = EvaluatePositionCache(nnStates, (ConstTanBoard) aanBoardNew[iRoll], aert[iRoll].ar,
+                                                  &ciOpp, pec, 0, ClassifyPosition((ConstTanBoard)
+                                                                                   aanBoardNew[iRoll], ciOpp.bgv));
+    }
+
+    for (iRoll = 0, n0 = 1; n0 <= 6; n0++) {
+        for (n1 = 1; n1 <= n0; n1++, iRoll++) {
+            float w = (n0 == n1) ? 1.0f : 2.0f;
+
+            if (aert[iRoll].r) {
+                if (fInterrupt)
+                    errno = EINTR;
+                r = -1;
+                goto done;
+            }
+
+            for (i = 0; i < NUM_OUTPUTS; i++)
+                arOutput[i] += w *aert[iRoll].ar[i];
+            for (i = 0; i < cciCube; i++)
+                arCf[i] += w *aert[iRoll].arCf[i];
+        }
+    }
+
+  done:
+    ArenaRelease(pa, mark);
+
+    return r;
+}
+
+#define SPLIT_NODE(nPlies) (nSplitPlies && (nPlies) >= nSplitPlies && MT_GetNumThreads() > 1)
+#endif
+
 static int
 EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, float arOutput[],
                      cubeinfo * const pci, const evalcontext * pec, unsigned int nPlies, positionclass pc)
@@ -5441,26 +6320,35 @@ EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, float arOutput[
     if (pc > CLASS_PERFECT && nPlies > 0) {
         /* internal node; recurse */
 
-        TanBoard anBoardNew;
+        TanBoard aanBoardNew[21];
         /* int anMove[ 8 ]; */
         cubeinfo ciOpp;
         float rTemp;
-        int n0, n1;
+        int n0, n1, iRoll;
 
         int const usePrune = pec->fUsePrune && pec->rNoise == 0.0f && pci->bgv == VARIATION_STANDARD;
 
         for (i = 0; i < NUM_OUTPUTS; i++)
             arOutput[i] = 0.0;
 
-        /* loop over rolls */
+        SetCubeInfo(&ciOpp, pci->nCube, pci->fCubeOwner, !pci->fMove,
+                    pci->nMatchTo, pci->anScore, pci->fCrawford, pci->fJacoby, pci->fBeavers, pci->bgv);
 
-        for (n0 = 1; n0 <= 6; n0++) {
-            for (n1 = 1; n1 <= n0; n1++) {
-                float w = (n0 == n1) ? 1.0f : 2.0f;
+#if defined(LOCKING_VERSION)
+        if (SPLIT_NODE(nPlies)) {
+            if (EvaluateRollsParallel(anBoard, arOutput, NULL, pci, NULL, 0, pec, nPlies, usePrune))
+                return -1;
+            goto normalize;
+        }
+#endif
 
+        /* loop over rolls: find the best move for each */
+
+        for (iRoll = 0, n0 = 1; n0 <= 6; n0++) {
+            for (n1 = 1; n1 <= n0; n1++, iRoll++) {
                 for (i = 0; i < 25; i++) {
-                    anBoardNew[0][i] = anBoard[0][i];
-                    anBoardNew[1][i] = anBoard[1][i];
+                    aanBoardNew[iRoll][0][i] = anBoard[0][i];
+                    aanBoardNew[iRoll][1][i] = anBoard[1][i];
                 }
 
                 if (fInterrupt) {
@@ -5469,21 +6357,28 @@ EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, float arOutput[
                 }
 
                 if (usePrune) {
-                    FindBestMoveInEval(nnStates, n0, n1, anBoard, anBoardNew, pci, pec);
+                    FindBestMoveInEval(nnStates, n0, n1, anBoard, aanBoardNew[iRoll], pci, pec);
                 } else {
 
-                    FindBestMovePlied(NULL, n0, n1, anBoardNew, pci, pec, 0, defaultFilters);
+                    FindBestMovePlied(NULL, n0, n1, aanBoardNew[iRoll], pci, pec, 0, defaultFilters);
                 }
 
-                SwapSides(anBoardNew);
+                SwapSides(aanBoardNew[iRoll]);
+            }
+        }
 
-                SetCubeInfo(&ciOpp, pci->nCube, pci->fCubeOwner, !pci->fMove,
-                            pci->nMatchTo, pci->anScore, pci->fCrawford, pci->fJacoby, pci->fBeavers, pci->bgv);
+        /* the resulting positions are leaves: evaluate them as one block */
+        if (nPlies == 1)
+            EvaluatePositionsBatch((const TanBoard *) aanBoardNew, 21, &ciOpp, pec, CLASS_BEAROFF2);
+
+        for (iRoll = 0, n0 = 1; n0 <= 6; n0++) {
+            for (n1 = 1; n1 <= n0; n1++, iRoll++) {
+                float w = (n0 == n1) ? 1.0f : 2.0f;
 
                 /* Evaluate at 0-ply */
-                if (EvaluatePositionCache(nnStates, (ConstTanBoard) anBoardNew, arVariationOutput,
+                if (EvaluatePositionCache(nnStates, (ConstTanBoard) aanBoardNew[iRoll], arVariationOutput,
                                           &ciOpp, pec, nPlies - 1,
-                                          ClassifyPosition((ConstTanBoard) anBoardNew, ciOpp.bgv)))
+                                          ClassifyPosition((ConstTanBoard) aanBoardNew[iRoll], ciOpp.bgv)))
                     return -1;
 
                 for (i = 0; i < NUM_OUTPUTS; i++)
@@ -5492,6 +6387,9 @@ EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, float arOutput[
 
         }
 
+#if defined(LOCKING_VERSION)
+      normalize:
+#endif
         /* normalize */
         for (i = 0; i < NUM_OUTPUTS; i++)
             arOutput[i] /= 36;
@@ -5510,9 +6408,15 @@ EvaluatePositionFull(NNState * nnStates, const TanBoard anBoard, float arOutput[
     } else {
         /* at leaf node; use static evaluation */
 
+        perfcounters *ppc = MT_GetPerf();
+        uint64_t t0 = PerfStart();
+
         if (acef[pc] (anBoard, arOutput, pci->bgv, nnStates))
             return -1;
 
+        ppc->acEval[pc]++;
+        PerfStop(ppc, PERF_TIMER_EVAL, t0);
+
         if (pec->rNoise > 0.0f && pc != CLASS_OVER) {
             for (i = 0; i < NUM_OUTPUTS; i++) {
                 arOutput[i] += Noise(pec, anBoard, i);
@@ -5536,6 +6440,9 @@ EvaluatePositionCache(NNState * nnStates, const TanBoard anBoard, float arOutput
 {
     evalcache ec;
     uint32_t l;
+    transpositionTable *ptt;
+    perfcounters *ppc;
+    int iPly;
     /* This should be a part of the code that is called in all
      * time-consuming operations at a relatively steady rate, so is a
      * good choice for a callback function. */
@@ -5546,7 +6453,33 @@ EvaluatePositionCache(NNState * nnStates, const TanBoard anBoard, float arOutput
     PositionKey(anBoard, &ec.key);
 
     ec.nEvalContext = EvalKey(pecx, nPlies, pci, FALSE);
-    if ((l = CacheLookup(&cEval, &ec, arOutput, NULL)) == CACHEHIT) {
+
+    ppc = MT_GetPerf();
+    iPly = MIN(nPlies, PERF_PLIES - 1);
+    ppc->acLookup[iPly]++;
+
+    /* only interior nodes are worth keeping for the rest of the search */
+    if ((ptt = nPlies > 0 ? ActiveTranspositions() : NULL) && TranspositionLookup(ptt, &ec, arOutput, NULL)) {
+        ppc->acHit[iPly]++;
+        return 0;
+    }
+
+    if ((l = EvalCacheLookup(&ec, arOutput, NULL)) == CACHEHIT) {
+        ppc->acHit[iPly]++;
+        if (ptt) {
+            memcpy(ec.ar, arOutput, sizeof(float) * NUM_OUTPUTS);
+            ec.ar[5] = 0.f;
+            TranspositionAdd(ptt, &ec);
+        }
+        return 0;
+    }
+
+    if (UseEvalStore(nPlies, pci) && EvalStoreLookup(&ec, pci, arOutput, NULL)) {
+        memcpy(ec.ar, arOutput, sizeof(float) * NUM_OUTPUTS);
+        ec.ar[5] = 0.f;
+        EvalCacheAdd(&ec, l);
+        if (ptt)
+            TranspositionAdd(ptt, &ec);
         return 0;
     }
 
@@ -5555,7 +6488,13 @@ EvaluatePositionCache(NNState * nnStates, const TanBoard anBoard, float arOutput
 
     memcpy(ec.ar, arOutput, sizeof(float) * NUM_OUTPUTS);
     ec.ar[5] = 0.f;
-    CacheAdd(&cEval, &ec, l);
+    EvalCacheAdd(&ec, l);
+    if (ptt)
+        TranspositionAdd(ptt, &ec);
+
+    if (UseEvalStore(nPlies, pci))
+        EvalStoreAdd(&ec, pci);
+
     return 0;
 }
 
@@ -5608,26 +6547,67 @@ ScoreMove(NNState * nnStates, move * pm, const cubeinfo * pci, const evalcontext
     return 0;
 }
 
-static int
-ScoreMoves(movelist * pml, const cubeinfo * pci, const evalcontext * pec, int nPlies)
+#if defined(LOCKING_VERSION)
+typedef struct {
+    move *pm;
+    const cubeinfo *pci;
+    const evalcontext *pec;
+    int nPlies;
+    unsigned int nSearch;       /* of the transposition tables */
+    int r;
+} scoremovetask;
+
+static void
+ScoreMoveTask(void *p)
 {
-    unsigned int i;
-    int r = 0;                  /* return value */
-    NNState *nnStates = MT_Get_nnState();
+    scoremovetask *psmt = (scoremovetask *) p;
+    transpositionTable *ptt = TranspositionsJoin(psmt->nSearch);
 
-    pml->rBestScore = -99999.9f;
+    /* each thread evaluates with its own NNState */
+    psmt->r = ScoreMove(MT_Get_nnState(), psmt->pm, psmt->pci, psmt->pec, psmt->nPlies);
 
-    if (nPlies == 0) {
-        /* start incremental evaluations */
-        nnStates[0].state = nnStates[1].state = nnStates[2].state = NNSTATE_INCREMENTAL;
+    TranspositionsEnd(ptt);
+}
+
+/* Score the candidates of a multi-ply search concurrently on the thread
+ * pool. The best move is picked afterwards in list order, so the result
+ * doesn't depend on which thread finished first. The tasks carry on the
+ * caller's search, so the positions they reach in common are searched
+ * once per thread rather than once per candidate. */
+
+static int
+ScoreMovesParallel(movelist * pml, const unsigned int *ai, unsigned int cMoves, const cubeinfo * pci,
+                   const evalcontext * pec, int nPlies)
+{
+    arena *pa = MT_GetArena();
+    arenamark mark = ArenaMark(pa);
+    scoremovetask *asmt = (scoremovetask *) ArenaAlloc(pa, cMoves * sizeof(scoremovetask));
+    TaskGroup tg = { 0 };
+    transpositionTable *ptt = TranspositionsBegin((unsigned int) nPlies);
+    unsigned int j;
+    int r = 0;
+
+    for (j = 0; j < cMoves; j++) {
+        asmt[j].pm = pml->amMoves + (ai ? ai[j] : j);
+        asmt[j].pci = pci;
+        asmt[j].pec = pec;
+        asmt[j].nPlies = nPlies;
+        asmt[j].nSearch = ptt ? ptt->nSearch : 0;
+        asmt[j].r = -1;         /* until the task has run */
+        MT_AddGroupTask(&tg, ScoreMoveTask, asmt + j);
     }
 
+    if (MT_WaitForGroup(&tg) < 0 || fInterrupt)
+        r = -1;
+    TranspositionsEnd(ptt);
 
-    for (i = 0; i < pml->cMoves; i++) {
-        if (ScoreMove(nnStates, pml->amMoves + i, pci, pec, nPlies) < 0) {
+    /* no score is used unless all the candidates were scored */
+    for (j = 0; j < cMoves && !r; j++)
+        if (asmt[j].r < 0)
             r = -1;
-            break;
-        }
+
+    for (j = 0; j < cMoves && !r; j++) {
+        unsigned int i = ai ? ai[j] : j;
 
         if ((pml->amMoves[i].rScore > pml->rBestScore) || ((pml->amMoves[i].rScore == pml->rBestScore)
                                                            && (pml->amMoves[i].rScore2 >
@@ -5637,18 +6617,21 @@ ScoreMoves(movelist * pml, const cubeinfo * pci, const evalcontext * pec, int nP
         }
     }
 
-    if (nPlies == 0) {
-        /* reset to none */
+    ArenaRelease(pa, mark);
 
-        nnStates[0].state = nnStates[1].state = nnStates[2].state = NNSTATE_NONE;
-    }
+    if (r && fInterrupt)
+        errno = EINTR;
 
     return r;
 }
+#endif
+
+/* Score the cMoves moves of pml listed in ai (all of them if ai is
+ * NULL) and set pml->iMoveBest to the best of them */
 
 static int
-ScoreMovesPruned(movelist * pml, const cubeinfo * pci, const evalcontext * pec, unsigned int *bmovesi,
-                 unsigned int prune_moves)
+ScoreMoves(movelist * pml, const unsigned int *ai, unsigned int cMoves, const cubeinfo * pci,
+           const evalcontext * pec, int nPlies)
 {
     unsigned int j;
     int r = 0;                  /* return value */
@@ -5656,14 +6639,25 @@ ScoreMovesPruned(movelist * pml, const cubeinfo * pci, const evalcontext * pec,
 
     pml->rBestScore = -99999.9f;
 
-    /* start incremental evaluations */
-    nnStates[0].state = nnStates[1].state = nnStates[2].state = NNSTATE_INCREMENTAL;
+#if defined(LOCKING_VERSION)
+    /* Not when the other threads have work of their own already (a
+     * rollout, an analysis...): the tasks would only add overhead */
+    if (nPlies > 0 && cMoves > 1 && MT_GetIdleThreads() > 0)
+        return ScoreMovesParallel(pml, ai, cMoves, pci, pec, nPlies);
+#endif
+
+    if (nPlies == 0) {
+        /* evaluate the resulting positions in blocks */
+        EvaluateMovesBatch(pml, ai, cMoves, pci, pec);
 
-    for (j = 0; j < prune_moves; j++) {
+        /* start incremental evaluations */
+        nnStates[0].state = nnStates[1].state = nnStates[2].state = NNSTATE_INCREMENTAL;
+    }
 
-        unsigned int i = bmovesi[j];
+    for (j = 0; j < cMoves; j++) {
+        unsigned int i = ai ? ai[j] : j;
 
-        if (ScoreMove(nnStates, pml->amMoves + i, pci, pec, 0) < 0) {
+        if (ScoreMove(nnStates, pml->amMoves + i, pci, pec, nPlies) < 0) {
             r = -1;
             break;
         }
@@ -5676,7 +6670,11 @@ ScoreMovesPruned(movelist * pml, const cubeinfo * pci, const evalcontext * pec,
         }
     }
 
-    nnStates[0].state = nnStates[1].state = nnStates[2].state = NNSTATE_NONE;
+    if (nPlies == 0) {
+        /* reset to none */
+
+        nnStates[0].state = nnStates[1].state = nnStates[2].state = NNSTATE_NONE;
+    }
 
     return r;
 }
@@ -5693,6 +6691,8 @@ FindBestMovePlied(int anMove[8], int nDice0, int nDice1,
     evalcontext ec;
     movelist ml;
     unsigned int i;
+    arena *pa = MT_GetArena();
+    arenamark mark = ArenaMark(pa);
 
     memcpy(&ec, pec, sizeof(evalcontext));
     ec.nPlies = nPlies;
@@ -5701,8 +6701,8 @@ FindBestMovePlied(int anMove[8], int nDice0, int nDice1,
         for (i = 0; i < 8; ++i)
             anMove[i] = -1;
 
-    if (FindnSaveBestMoves(&ml, nDice0, nDice1, (ConstTanBoard) anBoard, NULL, 0.0f, pci, &ec, aamf) < 0) {
-        g_free(ml.amMoves);
+    if (SaveBestMoves(&ml, nDice0, nDice1, (ConstTanBoard) anBoard, NULL, 0.0f, pci, &ec, aamf, pa) < 0) {
+        ArenaRelease(pa, mark);
         return -1;
     }
 
@@ -5714,7 +6714,7 @@ FindBestMovePlied(int anMove[8], int nDice0, int nDice1,
     if (ml.cMoves)
         PositionFromKey(anBoard, &ml.amMoves[ml.iMoveBest].key);
 
-    g_free(ml.amMoves);
+    ArenaRelease(pa, mark);
 
     return ml.cMaxMoves * 2;
 }
@@ -5730,10 +6730,50 @@ FindBestMove(int anMove[8], int nDice0, int nDice1,
     return FindBestMovePlied(anMove, nDice0, nDice1, anBoard, pci, pec ? pec : &ecBasic, pec ? pec->nPlies : 0, aamf);
 }
 
-extern int
-FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoard, positionkey * keyMove, const
-                   float rThr, const cubeinfo * pci, const evalcontext * pec,
-                   movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES])
+/* While the candidates are filtered, they are sorted as small records
+ * of their scores and index instead of moving whole moves around. The
+ * move list is put in that order once, at the end. */
+
+typedef struct {
+    float rScore, rScore2;
+    unsigned int i;
+} movescore;
+
+static int
+CompareMoveScores(const movescore * pms0, const movescore * pms1)
+{
+    /* high score first, then in the order the moves were generated */
+    if (pms0->rScore != pms1->rScore)
+        return pms1->rScore > pms0->rScore ? 1 : -1;
+    if (pms0->rScore2 != pms1->rScore2)
+        return pms1->rScore2 > pms0->rScore2 ? 1 : -1;
+
+    return pms0->i < pms1->i ? -1 : 1;
+}
+
+static void
+SortCandidates(const movelist * pml, unsigned int ai[], unsigned int cMoves, movescore ams[])
+{
+    unsigned int j;
+
+    for (j = 0; j < cMoves; j++) {
+        ams[j].rScore = pml->amMoves[ai[j]].rScore;
+        ams[j].rScore2 = pml->amMoves[ai[j]].rScore2;
+        ams[j].i = ai[j];
+    }
+
+    qsort(ams, cMoves, sizeof(movescore), (cfunc) CompareMoveScores);
+
+    for (j = 0; j < cMoves; j++)
+        ai[j] = ams[j].i;
+}
+
+/* The saved moves are allocated from pa if it is set, else on the heap */
+
+static int
+SaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoard, positionkey * keyMove, const
+              float rThr, const cubeinfo * pci, const evalcontext * pec,
+              movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES], arena * pa)
 {
 
     /* Find best moves. 
@@ -5745,6 +6785,13 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
     movefilter *mFilters;
     unsigned int nMaxPly = 0;
     unsigned int cOldMoves;
+    transpositionTable *ptt;
+    arena *paScratch = MT_GetArena();
+    arenamark mark;
+    unsigned int *ai;           /* the moves, in the order of the last sort */
+    unsigned int cCandidates;   /* how many of them are still considered */
+    movescore *ams;
+    move *amSorted;
 
     /* Find all moves -- note that pml contains internal pointers to static
      * data, so we can't call GenerateMoves again (or anything that calls
@@ -5758,15 +6805,30 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
         return 0;
     }
 
+    /* the candidates are scored in one search */
+    ptt = TranspositionsBegin(pec->nPlies);
+
     /* Save moves */
+    if (pa) {
+        pm = (move *) ArenaAlloc(pa, pml->cMoves * sizeof(move));
+        memcpy(pm, pml->amMoves, pml->cMoves * sizeof(move));
+    } else {
 #if GLIB_CHECK_VERSION (2,67,4)
-    pm = (move *) g_memdup2(pml->amMoves, pml->cMoves * sizeof(move));
+        pm = (move *) g_memdup2(pml->amMoves, pml->cMoves * sizeof(move));
 #else
-    pm = (move *) g_memdup(pml->amMoves, pml->cMoves * sizeof(move));
+        pm = (move *) g_memdup(pml->amMoves, pml->cMoves * sizeof(move));
 #endif
+    }
     pml->amMoves = pm;
     nMoves = pml->cMoves;
 
+    mark = ArenaMark(paScratch);
+    ai = (unsigned int *) ArenaAlloc(paScratch, nMoves * sizeof(unsigned int));
+    ams = (movescore *) ArenaAlloc(paScratch, nMoves * sizeof(movescore));
+    for (i = 0; i < nMoves; i++)
+        ai[i] = i;
+    cCandidates = nMoves;
+
     mFilters = (pec->nPlies > 0 && pec->nPlies <= MAX_FILTER_PLIES) ?
         aamf[pec->nPlies - 1] : aamf[MAX_FILTER_PLIES - 1];
 
@@ -5780,25 +6842,20 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
             continue;
         }
 
-        if (ScoreMoves(pml, pci, pec, iPly) < 0) {
-            g_free(pm);
-            pml->cMoves = 0;
-            pml->amMoves = NULL;
-            return -1;
-        }
+        if (ScoreMoves(pml, ai, cCandidates, pci, pec, iPly) < 0)
+            goto error;
 
-        qsort(pml->amMoves, pml->cMoves, sizeof(move), (cfunc) CompareMoves);
-        pml->iMoveBest = 0;
+        SortCandidates(pml, ai, cCandidates, ams);
 
-        k = pml->cMoves;
+        k = cCandidates;
         /* we check for mFilter->Accept < 0 above */
-        pml->cMoves = MIN((unsigned int) mFilter->Accept, pml->cMoves);
+        cCandidates = MIN((unsigned int) mFilter->Accept, cCandidates);
 
         {
-            unsigned int limit = MIN(k, pml->cMoves + mFilter->Extra);
+            unsigned int limit = MIN(k, cCandidates + mFilter->Extra);
 
-            for ( /**/; pml->cMoves < limit; ++pml->cMoves) {
-                if (pml->amMoves[pml->cMoves].rScore < pml->amMoves[0].rScore - mFilter->Threshold) {
+            for ( /**/; cCandidates < limit; ++cCandidates) {
+                if (ams[cCandidates].rScore < ams[0].rScore - mFilter->Threshold) {
                     break;
                 }
             }
@@ -5806,7 +6863,7 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
 
         nMaxPly = iPly;
 
-        if (pml->cMoves == 1 && mFilter->Accept != 1)
+        if (cCandidates == 1 && mFilter->Accept != 1)
             /* if there is only one move to evaluate there is no need to continue */
             goto finished;
 
@@ -5815,24 +6872,27 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
 
     /* evaluate moves on top ply */
 
-    if (ScoreMoves(pml, pci, pec, pec->nPlies) < 0) {
-        g_free(pm);
-        pml->cMoves = 0;
-        pml->amMoves = NULL;
-        return -1;
-    }
+    if (ScoreMoves(pml, ai, cCandidates, pci, pec, pec->nPlies) < 0)
+        goto error;
 
     nMaxPly = pec->nPlies;
 
     /* Resort the moves, in case the new evaluation reordered them. */
-    qsort(pml->amMoves, pml->cMoves, sizeof(move), (cfunc) CompareMoves);
-    pml->iMoveBest = 0;
-
-    /* set the proper size of the movelist */
+    SortCandidates(pml, ai, cCandidates, ams);
 
   finished:
 
-    cOldMoves = pml->cMoves;
+    /* put the move list in the final order */
+    amSorted = (move *) ArenaAlloc(paScratch, nMoves * sizeof(move));
+    for (i = 0; i < nMoves; i++)
+        memcpy(amSorted + i, pml->amMoves + ai[i], sizeof(move));
+    memcpy(pml->amMoves, amSorted, nMoves * sizeof(move));
+    ArenaRelease(paScratch, mark);
+
+    pml->iMoveBest = 0;
+    pml->rBestScore = pml->amMoves[0].rScore;
+
+    cOldMoves = cCandidates;
     pml->cMoves = nMoves;
 
     /* Make sure that keyMove and top move are both  
@@ -5884,8 +6944,34 @@ FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoar
             }
     }
 
+    TranspositionsEnd(ptt);
+
     return 0;
 
+  error:
+    ArenaRelease(paScratch, mark);
+    if (!pa)
+        g_free(pm);
+    pml->cMoves = 0;
+    pml->amMoves = NULL;
+    TranspositionsEnd(ptt);
+    return -1;
+}
+
+extern int
+FindnSaveBestMoves(movelist * pml, int nDice0, int nDice1, const TanBoard anBoard, positionkey * keyMove, const
+                   float rThr, const cubeinfo * pci, const evalcontext * pec,
+                   movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES])
+{
+    return SaveBestMoves(pml, nDice0, nDice1, anBoard, keyMove, rThr, pci, pec, aamf, NULL);
+}
+
+extern int
+FindnSaveBestMovesArena(movelist * pml, int nDice0, int nDice1, const TanBoard anBoard, positionkey * keyMove, const
+                        float rThr, const cubeinfo * pci, const evalcontext * pec,
+                        movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES])
+{
+    return SaveBestMoves(pml, nDice0, nDice1, anBoard, keyMove, rThr, pci, pec, aamf, MT_GetArena());
 }
 
 extern int
@@ -5964,21 +7050,22 @@ extern int
 GeneralEvaluationEPlied(NNState * nnStates, float arOutput[NUM_ROLLOUT_OUTPUTS],
                         const TanBoard anBoard, cubeinfo * const pci, const evalcontext * pec, int nPlies)
 {
+    transpositionTable *ptt = TranspositionsBegin((unsigned int) nPlies);
+    int n;
 
     if (pec->fCubeful) {
 
-        if (GeneralEvaluationEPliedCubeful(nnStates, arOutput, anBoard, pci, pec, nPlies))
-            return -1;
-
-    } else {
-        if (EvaluatePositionCache(nnStates, anBoard, arOutput, pci, pec, nPlies, ClassifyPosition(anBoard, pci->bgv)))
-            return -1;
+        n = GeneralEvaluationEPliedCubeful(nnStates, arOutput, anBoard, pci, pec, nPlies);
 
+    } else if (!(n = EvaluatePositionCache(nnStates, anBoard, arOutput, pci, pec, nPlies,
+                                           ClassifyPosition(anBoard, pci->bgv)))) {
         arOutput[OUTPUT_EQUITY] = UtilityME(arOutput, pci);
         arOutput[OUTPUT_CUBEFUL_EQUITY] = 0.0f;
     }
 
-    return 0;
+    TranspositionsEnd(ptt);
+
+    return n ? -1 : 0;
 
 }
 
@@ -6025,6 +7112,14 @@ EvaluatePositionCubeful4(NNState * nnStates, const TanBoard anBoard,
 
         MakeCubePos(aciCubePos, cci, fTop, aci, TRUE);
 
+#if defined(LOCKING_VERSION)
+        if (SPLIT_NODE(nPlies)) {
+            if (EvaluateRollsParallel(anBoard, arOutput, arCf, pciMove, aci, 2 * cci, pec, nPlies, usePrune))
+                return -1;
+            goto flip;
+        }
+#endif
+
         /* loop over rolls */
 
         for (n0 = 1; n0 <= 6; n0++) {
@@ -6071,6 +7166,9 @@ EvaluatePositionCubeful4(NNState * nnStates, const TanBoard anBoard,
 
         }
 
+#if defined(LOCKING_VERSION)
+      flip:
+#endif
         /* Flip evals */
 #define sumW 36
 
@@ -6305,6 +7403,9 @@ EvaluatePositionCubeful3(NNState * nnStates, const TanBoard anBoard,
     int ici;
     int fAll;
     evalcache ec;
+    transpositionTable *ptt;
+    perfcounters *ppc;
+    int iPly;
 
     if (!cCache || pec->rNoise != 0.0f)
         /* non-deterministic evaluation; never cache */
@@ -6318,6 +7419,9 @@ EvaluatePositionCubeful3(NNState * nnStates, const TanBoard anBoard,
     /* check cache for existence for earlier calculation */
 
     fAll = !fTop;               /* FIXME: fTop should be a part of EvalKey */
+    ptt = fAll && nPlies > 0 ? ActiveTranspositions() : NULL;
+    ppc = MT_GetPerf();
+    iPly = MIN(nPlies, PERF_PLIES - 1);
 
     for (ici = 0; ici < cci && fAll; ++ici) {
 
@@ -6326,10 +7430,24 @@ EvaluatePositionCubeful3(NNState * nnStates, const TanBoard anBoard,
         }
 
         ec.nEvalContext = EvalKey(pec, nPlies, &aciCubePos[ici], TRUE);
+        ppc->acLookup[iPly]++;
 
-        if (CacheLookup(&cEval, &ec, arOutput, arCubeful + ici) != CACHEHIT) {
-            fAll = FALSE;
+        if (ptt && TranspositionLookup(ptt, &ec, arOutput, arCubeful + ici)) {
+            ppc->acHit[iPly]++;
+            continue;
         }
+
+        if (EvalCacheLookup(&ec, arOutput, arCubeful + ici) == CACHEHIT) {
+            ppc->acHit[iPly]++;
+            continue;
+        }
+
+        if (UseEvalStore(nPlies, &aciCubePos[ici]) && EvalStoreLookup(&ec, &aciCubePos[ici], arOutput, arCubeful + ici)) {
+            memcpy(ec.ar, arOutput, sizeof(float) * NUM_OUTPUTS);
+            ec.ar[5] = arCubeful[ici];
+            EvalCacheAdd(&ec, GetHashKey(EvalCacheShard(MT_GetTLD())->hashMask, &ec));
+        } else
+            fAll = FALSE;
     }
 
     /* get equities */
@@ -6353,8 +7471,12 @@ EvaluatePositionCubeful3(NNState * nnStates, const TanBoard anBoard,
                 ec.ar[5] = arCubeful[ici];      /* Cubeful equity stored in slot 5 */
                 ec.nEvalContext = EvalKey(pec, nPlies, &aciCubePos[ici], TRUE);
 
-                CacheAdd(&cEval, &ec, GetHashKey(cEval.hashMask, &ec));
+                EvalCacheAdd(&ec, GetHashKey(EvalCacheShard(MT_GetTLD())->hashMask, &ec));
+                if (ptt)
+                    TranspositionAdd(ptt, &ec);
 
+                if (UseEvalStore(nPlies, &aciCubePos[ici]))
+                    EvalStoreAdd(&ec, &aciCubePos[ici]);
             }
         }
     }
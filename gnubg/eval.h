@@ -339,6 +339,17 @@ extern classevalfunc acef[N_CLASSES];
 #define CACHE_SIZE_DEFAULT 19
 #define CACHE_SIZE_GUIMAX 23
 
+/* The evaluation cache is split in one shard per NUMA node (up to
+ * this many), each thread using the shard of its node */
+#define CACHE_MAX_SHARDS 8
+
+/* Levels of the evaluation cache, for EvalCacheStats() */
+typedef enum {
+    CACHE_LEVEL_THREAD,         /* per thread front cache */
+    CACHE_LEVEL_SHARED,         /* NUMA node shard */
+    N_CACHE_LEVELS
+} cachelevel;
+
 #define CFMONEY(arEquity,pci) \
    ( ( (pci)->fCubeOwner == -1 ) ? arEquity[ 2 ] : \
    ( ( (pci)->fCubeOwner == (pci)->fMove ) ? arEquity[ 1 ] : arEquity[ 3 ] ) )
@@ -371,11 +382,22 @@ extern void
 EXP_LOCK_FUN(int, FindBestMove, int anMove[8], int nDice0, int nDice1,
              TanBoard anBoard, const cubeinfo * pci, evalcontext * pec, movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES]);
 
+EXP_LOCK_FUN(void, EvaluateMovesAhead, const positionkey akey[], unsigned int cMoves, const cubeinfo * pci,
+             const evalcontext * pec);
+
 EXP_LOCK_FUN(int, FindnSaveBestMoves, movelist * pml,
              int nDice0, int nDice1, const TanBoard anBoard,
              positionkey * keyMove, const float rThr,
              const cubeinfo * pci, const evalcontext * pec, movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES]);
 
+/* As FindnSaveBestMoves(), but pml->amMoves is scratch memory of the
+ * calling thread (see arena.h): it must not be freed, and it is only
+ * valid until the caller releases an arena mark taken before the call */
+EXP_LOCK_FUN(int, FindnSaveBestMovesArena, movelist * pml,
+             int nDice0, int nDice1, const TanBoard anBoard,
+             positionkey * keyMove, const float rThr,
+             const cubeinfo * pci, const evalcontext * pec, movefilter aamf[MAX_FILTER_PLIES][MAX_FILTER_PLIES]);
+
 extern void
  PipCount(const TanBoard anBoard, unsigned int anPips[2]);
 
@@ -401,15 +423,31 @@ extern int
 
 extern void EvalCacheFlush(void);
 extern int EvalCacheResize(unsigned int cNew);
-extern int EvalCacheStats(unsigned int *pcUsed, unsigned int *pcLookup, unsigned int *pcHit);
+extern void EvalCacheStats(uint64_t acLookup[N_CACHE_LEVELS], uint64_t acHit[N_CACHE_LEVELS]);
+#if CACHE_STATS
+extern int EvalCacheUsage(unsigned int *pcUsed, unsigned int *pcLookup, unsigned int *pcHit);
+#endif
+extern evalCacheL1 *EvalCacheL1(int id);
+extern transpositionTable *EvalTranspositions(int id);
+extern int EvalTranspositionsResize(unsigned int cNew);
+extern void EvalTranspositionsStats(uint64_t * pcLookup, uint64_t * pcHit);
 extern double GetEvalCacheSize(void);
 void SetEvalCacheSize(unsigned int size);
 extern unsigned int GetEvalCacheEntries(void);
 extern int GetCacheMB(int size);
 
-extern evalCache cEval;
+extern int fQuantizedEval;
+extern unsigned int nSplitPlies;
+extern void EvalSetQuantized(int f);
+
+extern evalCache acEval[CACHE_MAX_SHARDS];
+extern unsigned int cCacheShards;
+extern int nEvalCacheGeneration;
 extern evalCache cpEval;
 extern unsigned int cCache;
+extern unsigned int cTranspositions;
+extern int nTranspositionSearch;
+extern int nTranspositionWrap;
 
 extern int
  GenerateMoves(movelist * pml, const TanBoard anBoard, int n0, int n1, int fPartial);
@@ -422,6 +460,10 @@ extern positionclass ClassifyPosition(const TanBoard anBoard, const bgvariation
 
 /* internal use only */
 extern void EvalRaceBG(const TanBoard anBoard, float arOutput[], const bgvariation bgv);
+extern int EvalQuantizedCompare(const TanBoard anBoard, const bgvariation bgv, float arFloat[NUM_OUTPUTS],
+                                float arQuantized[NUM_OUTPUTS]);
+extern int EvalNetBatch(positionclass pc, const TanBoard aanBoard[], const unsigned int ai[], unsigned int c,
+                        float *aarOutput[], const bgvariation bgv);
 
 extern float
  Utility(float ar[NUM_OUTPUTS], const cubeinfo * pci);
@@ -541,6 +583,15 @@ extern int
 extern void
  baseInputs(const TanBoard anBoard, float arInput[]);
 
+extern void
+ baseInputsSparse(const TanBoard anBoard, nnsparse * pns);
+
+extern void
+ SparseInputsAppend(nnsparse * pns, unsigned int iFirst, const float ar[], unsigned int c);
+
+extern void
+ SparseInputsToDense(const nnsparse * pns, float arInput[], unsigned int cInput);
+
 extern int CompareMoves(const move * pm0, const move * pm1);
 extern float EvalEfficiency(const TanBoard anBoard, positionclass pc, int ply);
 extern float Cl2CfMoney(float arOutput[NUM_OUTPUTS], cubeinfo * pci, float rCubeX);
@@ -0,0 +1,546 @@
+/*
+ * Copyright (C) 2024 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * $Id$
+ */
+
+/*
+ * Persistent evaluation store.
+ *
+ * An append-only file of evaluations kept behind the evaluation cache,
+ * so that they survive restarts. Only evaluations worth keeping (1-ply
+ * and more) are stored.
+ *
+ * The file is a header followed by fixed size records. The header holds
+ * the MD5 digest of the neural net weights and of the bearoff databases
+ * in use: a file written with other ones (or by another version of this
+ * code) is discarded. Records are in native byte order.
+ *
+ * The records present when the store is opened are mapped read-only.
+ * New records are kept in memory and written to the end of the file in
+ * chunks, by a separate thread when threads are available. An open
+ * addressing index over all records is built at open time; its size is
+ * fixed, so lookups don't need locks.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "backgammon.h"
+#include "evalstore.h"
+#include "matchequity.h"
+#include "multithread.h"
+#include "positionid.h"
+#include "md5.h"
+
+#if !GLIB_CHECK_VERSION (2,26,0)
+#ifdef WIN32
+#define GStatBuf struct _g_stat_struct
+#else
+typedef struct stat GStatBuf;
+#endif
+#endif
+
+#define STORE_MAGIC "gnubgES"
+#define STORE_VERSION 1
+
+/* New records per session. The index is sized for this many. */
+#define STORE_MAX_ADDED (1u << 21)
+/* Records in the file, which keeps it under 2GB for fseek() */
+#define STORE_MAX_RECORDS ((1u << 25) - STORE_MAX_ADDED)
+#define STORE_CHUNK 4096
+
+typedef struct {
+    char szMagic[8];
+    uint32_t nVersion;
+    uint32_t cbRecord;
+    unsigned char auchWeights[16];      /* MD5 of the nets and databases */
+} storeheader;
+
+typedef struct {
+    positionkey key;
+    int nEvalContext;
+    uint32_t nSettings;         /* match equity table stamp, 0 for money play */
+    float ar[6];                /* as in the evaluation cache */
+    uint32_t nReserved;
+} storerecord;
+
+typedef struct {
+    storerecord ar[STORE_CHUNK];
+} storechunk;
+
+typedef struct {
+    char *szFile;
+    FILE *pf;
+    GMappedFile *map;
+    const storerecord *arRecords;       /* the mapped records */
+    unsigned int cRecords;
+    /* index: 0 for an empty slot, else record number + 1. Records past
+     * cRecords are the new ones, in apChunk. */
+    uint32_t *anIndex;
+    uint32_t indexMask;
+    storechunk *apChunk[STORE_MAX_ADDED / STORE_CHUNK];
+    int cAdded;
+    int fFull;                  /* file at STORE_MAX_RECORDS, no additions */
+    int fWriteError;
+    uint32_t nMET;
+#if defined(USE_MULTITHREAD)
+    Mutex lock;
+    GThread *writer;
+    GAsyncQueue *queue;
+#endif
+} evalstore;
+
+/* Lookups and hits of each thread (-1 for the main one, at 0), kept
+ * apart so that the threads don't contend for them */
+typedef CACHE_ALIGN(struct {
+    unsigned int cLookup;
+    unsigned int cHit;
+}) storecounts;
+
+static evalstore *pes = NULL;
+static storecounts acCount[MAX_NUMTHREADS + 1];
+/* threads in EvalStoreLookup() or EvalStoreAdd(): the store isn't
+ * closed under them */
+static int cUsers = 0;
+int fEvalStore = FALSE;
+
+static inline int
+StoreEnter(void)
+{
+    MT_SafeInc(&cUsers);
+    if (MT_SafeGet(&fEvalStore))
+        return TRUE;
+
+    MT_SafeDec(&cUsers);
+    return FALSE;
+}
+
+static inline void
+StoreLeave(void)
+{
+    MT_SafeDec(&cUsers);
+}
+
+static void
+DigestNet(struct md5_ctx *pctx, const neuralnet * pnn)
+{
+    md5_process_bytes(&pnn->cInput, sizeof(pnn->cInput), pctx);
+    md5_process_bytes(&pnn->cHidden, sizeof(pnn->cHidden), pctx);
+    md5_process_bytes(&pnn->cOutput, sizeof(pnn->cOutput), pctx);
+    md5_process_bytes(&pnn->rBetaHidden, sizeof(pnn->rBetaHidden), pctx);
+    md5_process_bytes(&pnn->rBetaOutput, sizeof(pnn->rBetaOutput), pctx);
+    md5_process_bytes(pnn->arHiddenWeight, pnn->cInput * pnn->cHidden * sizeof(float), pctx);
+    md5_process_bytes(pnn->arOutputWeight, pnn->cHidden * pnn->cOutput * sizeof(float), pctx);
+    md5_process_bytes(pnn->arHiddenThreshold, pnn->cHidden * sizeof(float), pctx);
+    md5_process_bytes(pnn->arOutputThreshold, pnn->cOutput * sizeof(float), pctx);
+}
+
+/* A database is identified by its type, parameters and file size. A
+ * missing one counts too: positions are then evaluated otherwise. */
+
+static void
+DigestBearoff(struct md5_ctx *pctx, const bearoffcontext * pbc)
+{
+    unsigned int an[9];
+    GStatBuf st;
+
+    memset(an, 0, sizeof(an));
+    if (pbc) {
+        an[0] = 1;
+        an[1] = (unsigned int) pbc->bt;
+        an[2] = pbc->nPoints;
+        an[3] = pbc->nChequers;
+        an[4] = (unsigned int) pbc->fCompressed;
+        an[5] = (unsigned int) pbc->fGammon;
+        an[6] = (unsigned int) pbc->fND;
+        an[7] = (unsigned int) pbc->fHeuristic;
+        an[8] = (unsigned int) pbc->fCubeful;
+    }
+    md5_process_bytes(an, sizeof(an), pctx);
+
+    if (pbc && pbc->szFilename && g_stat(pbc->szFilename, &st) == 0) {
+        uint64_t const cb = (uint64_t) st.st_size;
+
+        md5_process_bytes(&cb, sizeof(cb), pctx);
+    }
+}
+
+static void
+StoreHeader(storeheader * psh)
+{
+    struct md5_ctx ctx;
+
+    memset(psh, 0, sizeof(*psh));
+    strcpy(psh->szMagic, STORE_MAGIC);
+    psh->nVersion = STORE_VERSION;
+    psh->cbRecord = sizeof(storerecord);
+
+    md5_init_ctx(&ctx);
+    DigestNet(&ctx, &nnContact);
+    DigestNet(&ctx, &nnRace);
+    DigestNet(&ctx, &nnCrashed);
+    DigestNet(&ctx, &nnpContact);
+    DigestNet(&ctx, &nnpRace);
+    DigestNet(&ctx, &nnpCrashed);
+    DigestBearoff(&ctx, pbc1);
+    DigestBearoff(&ctx, pbc2);
+    DigestBearoff(&ctx, pbcOS);
+    DigestBearoff(&ctx, pbcTS);
+    DigestBearoff(&ctx, apbcHyper[0]);
+    DigestBearoff(&ctx, apbcHyper[1]);
+    DigestBearoff(&ctx, apbcHyper[2]);
+    md5_finish_ctx(&ctx, psh->auchWeights);
+}
+
+/* Match play evaluations depend on the match equity table */
+
+static uint32_t
+METStamp(void)
+{
+    struct md5_ctx ctx;
+    uint32_t auch[4];
+
+    md5_init_ctx(&ctx);
+    md5_process_bytes(aafMET, sizeof(aafMET), &ctx);
+    md5_process_bytes(aafMETPostCrawford, sizeof(aafMETPostCrawford), &ctx);
+    md5_finish_ctx(&ctx, auch);
+
+    return auch[0] | 1;         /* never 0 */
+}
+
+static inline const storerecord *
+StoreRecord(const evalstore * p, uint32_t n)
+{
+    if (n < p->cRecords)
+        return p->arRecords + n;
+
+    n -= p->cRecords;
+    return &p->apChunk[n / STORE_CHUNK]->ar[n % STORE_CHUNK];
+}
+
+/* Index slot of the record for pec, or of the empty slot where it
+ * would go */
+
+static uint32_t
+StoreFind(const evalstore * p, const evalcache * pec, uint32_t nSettings, const storerecord ** ppr)
+{
+    uint32_t i = GetHashKey(p->indexMask, pec);
+    uint32_t n;
+
+    while ((n = (uint32_t) g_atomic_int_get((gint *) & p->anIndex[i])) != 0) {
+        const storerecord *pr = StoreRecord(p, n - 1);
+
+        if (EqualKeys(pr->key, pec->key) && pr->nEvalContext == pec->nEvalContext && pr->nSettings == nSettings) {
+            *ppr = pr;
+            return i;
+        }
+        i = (i + 1) & p->indexMask;
+    }
+
+    *ppr = NULL;
+    return i;
+}
+
+static void
+StoreWrite(evalstore * p, const storerecord * ar, size_t c)
+{
+    if (fwrite(ar, sizeof(storerecord), c, p->pf) != c || fflush(p->pf))
+        p->fWriteError = TRUE;
+}
+
+#if defined(USE_MULTITHREAD)
+static storechunk chunkStop;
+
+static gpointer
+StoreWriter(gpointer data)
+{
+    evalstore *p = (evalstore *) data;
+    storechunk *pc;
+
+    while ((pc = (storechunk *) g_async_queue_pop(p->queue)) != &chunkStop)
+        StoreWrite(p, pc->ar, STORE_CHUNK);
+
+    return NULL;
+}
+#endif
+
+extern void
+EvalStoreClose(void)
+{
+    unsigned int i;
+
+    if (!pes)
+        return;
+
+    /* new lookups now stay out; wait for those in progress */
+    MT_SafeSet(&fEvalStore, FALSE);
+    while (MT_SafeGet(&cUsers))
+        g_thread_yield();
+
+#if defined(USE_MULTITHREAD)
+    g_async_queue_push(pes->queue, &chunkStop);
+    g_thread_join(pes->writer);
+    g_async_queue_unref(pes->queue);
+    FreeMutex(&pes->lock);
+#endif
+
+    /* the last chunk, if not full */
+    if (pes->cAdded % STORE_CHUNK)
+        StoreWrite(pes, pes->apChunk[pes->cAdded / STORE_CHUNK]->ar, pes->cAdded % STORE_CHUNK);
+
+    if (fclose(pes->pf) || pes->fWriteError)
+        outputerrf(_("Error writing the evaluation store %s"), pes->szFile);
+
+    for (i = 0; i < G_N_ELEMENTS(pes->apChunk); i++)
+        g_free(pes->apChunk[i]);
+    g_free(pes->anIndex);
+    if (pes->map)
+        g_mapped_file_unref(pes->map);
+    g_free(pes->szFile);
+    g_free(pes);
+    pes = NULL;
+}
+
+extern int
+EvalStoreOpen(const char *szFile)
+{
+    storeheader sh;
+    evalstore *p;
+    unsigned int i, cIndex;
+
+    EvalStoreClose();
+
+    StoreHeader(&sh);
+
+    p = g_new0(evalstore, 1);
+    p->szFile = g_strdup(szFile);
+
+    if (g_file_test(szFile, G_FILE_TEST_EXISTS)) {
+        GError *error = NULL;
+        const char *pch;
+        gsize cb;
+
+        if (!(p->map = g_mapped_file_new(szFile, FALSE, &error))) {
+            outputerrf("%s: %s", szFile, error->message);
+            g_error_free(error);
+            g_free(p->szFile);
+            g_free(p);
+            return -1;
+        }
+
+        cb = g_mapped_file_get_length(p->map);
+        pch = g_mapped_file_get_contents(p->map);
+
+        if (cb < sizeof(sh) || memcmp(pch, &sh, sizeof(sh))) {
+            if (cb)
+                outputerrf(_("The evaluation store %s was written with other neural nets or bearoff databases. Starting a new one."),
+                           szFile);
+            g_mapped_file_unref(p->map);
+            p->map = NULL;
+        } else {
+            /* a partial record at the end (interrupted write) is
+             * ignored and will be overwritten */
+            gsize const cRecords = (cb - sizeof(sh)) / sizeof(storerecord);
+
+            p->fFull = cRecords >= STORE_MAX_RECORDS;
+            p->cRecords = p->fFull ? STORE_MAX_RECORDS : (unsigned int) cRecords;
+            p->arRecords = (const storerecord *) (pch + sizeof(sh));
+        }
+    }
+
+    if (p->map) {
+        if ((p->pf = g_fopen(szFile, "r+b"))
+            && fseek(p->pf, (long) (sizeof(sh) + p->cRecords * sizeof(storerecord)), SEEK_SET)) {
+            fclose(p->pf);
+            p->pf = NULL;
+        }
+    } else if ((p->pf = g_fopen(szFile, "wb")) && fwrite(&sh, sizeof(sh), 1, p->pf) != 1) {
+        fclose(p->pf);
+        p->pf = NULL;
+    }
+
+    if (!p->pf) {
+        outputerrf("%s: %s", szFile, strerror(errno));
+        if (p->map)
+            g_mapped_file_unref(p->map);
+        g_free(p->szFile);
+        g_free(p);
+        return -1;
+    }
+
+    /* index, at most 2/3 full */
+    for (cIndex = 1; cIndex < (p->cRecords + STORE_MAX_ADDED) / 2 * 3; cIndex <<= 1);
+    p->indexMask = cIndex - 1;
+    p->anIndex = g_try_new0(uint32_t, cIndex);
+
+    if (!p->anIndex) {
+        outputerrf(_("Not enough memory for the evaluation store index"));
+        fclose(p->pf);
+        if (p->map)
+            g_mapped_file_unref(p->map);
+        g_free(p->szFile);
+        g_free(p);
+        return -1;
+    }
+
+    for (i = 0; i < p->cRecords; i++) {
+        uint32_t j = GetHashKey(p->indexMask, (const evalcache *) &p->arRecords[i]);
+
+        while (p->anIndex[j])
+            j = (j + 1) & p->indexMask;
+        p->anIndex[j] = i + 1;
+    }
+
+    p->nMET = METStamp();
+
+#if defined(USE_MULTITHREAD)
+    InitMutex(&p->lock);
+    p->queue = g_async_queue_new();
+#if GLIB_CHECK_VERSION (2,32,0)
+    p->writer = g_thread_new("evalstore", StoreWriter, p);
+#else
+    p->writer = g_thread_create(StoreWriter, p, TRUE, NULL);
+#endif
+#endif
+
+    memset(acCount, 0, sizeof(acCount));
+    pes = p;
+    MT_SafeSet(&fEvalStore, TRUE);
+
+    return 0;
+}
+
+extern const char *
+EvalStoreFile(void)
+{
+    return pes ? pes->szFile : NULL;
+}
+
+extern int
+EvalStoreLookup(const evalcache * pec, const cubeinfo * pci, float arOut[], float *arCubeful)
+{
+    storecounts *psc = &acCount[MT_GetThreadID() + 1];
+    const storerecord *pr;
+
+    if (!StoreEnter())
+        return FALSE;
+
+    ++psc->cLookup;
+
+    StoreFind(pes, pec, pci->nMatchTo ? pes->nMET : 0, &pr);
+    if (pr) {
+        memcpy(arOut, pr->ar, NUM_OUTPUTS * sizeof(float));
+        if (arCubeful)
+            *arCubeful = pr->ar[5];
+
+        ++psc->cHit;
+    }
+
+    StoreLeave();
+
+    return pr != NULL;
+}
+
+extern void
+EvalStoreAdd(const evalcache * pec, const cubeinfo * pci)
+{
+    uint32_t nSettings;
+    const storerecord *pr;
+    uint32_t i;
+
+    if (!StoreEnter())
+        return;
+
+    if (pes->fFull || MT_SafeGet(&pes->cAdded) >= (int) STORE_MAX_ADDED) {
+        StoreLeave();
+        return;
+    }
+
+    nSettings = pci->nMatchTo ? pes->nMET : 0;
+
+#if defined(USE_MULTITHREAD)
+    Mutex_Lock(&pes->lock);
+#endif
+
+    i = StoreFind(pes, pec, nSettings, &pr);
+
+    if (!pr && pes->cAdded < (int) STORE_MAX_ADDED) {
+        unsigned int const iChunk = (unsigned int) pes->cAdded / STORE_CHUNK;
+        storerecord *prNew;
+
+        if (!pes->apChunk[iChunk])
+            pes->apChunk[iChunk] = g_new(storechunk, 1);
+
+        prNew = &pes->apChunk[iChunk]->ar[pes->cAdded % STORE_CHUNK];
+        memset(prNew, 0, sizeof(*prNew));
+        CopyKey(pec->key, prNew->key);
+        prNew->nEvalContext = pec->nEvalContext;
+        prNew->nSettings = nSettings;
+        memcpy(prNew->ar, pec->ar, sizeof(prNew->ar));
+
+        /* publish the record */
+        g_atomic_int_set((gint *) & pes->anIndex[i], (gint) (pes->cRecords + (unsigned int) pes->cAdded + 1));
+        MT_SafeInc(&pes->cAdded);
+
+        if (pes->cAdded % STORE_CHUNK == 0) {
+#if defined(USE_MULTITHREAD)
+            g_async_queue_push(pes->queue, pes->apChunk[iChunk]);
+#else
+            StoreWrite(pes, pes->apChunk[iChunk]->ar, STORE_CHUNK);
+#endif
+        }
+    }
+
+#if defined(USE_MULTITHREAD)
+    Mutex_Release(&pes->lock);
+#endif
+
+    StoreLeave();
+}
+
+extern void
+EvalStoreSettingsChanged(void)
+{
+    if (pes)
+        pes->nMET = METStamp();
+}
+
+extern void
+EvalStoreStats(unsigned int *pcRecords, unsigned int *pcAdded, unsigned int *pcLookup, unsigned int *pcHit)
+{
+    unsigned int i;
+
+    if (!pes) {
+        *pcRecords = *pcAdded = *pcLookup = *pcHit = 0;
+        return;
+    }
+
+    *pcRecords = pes->cRecords;
+    *pcAdded = (unsigned int) MT_SafeGet(&pes->cAdded);
+
+    /* read without synchronisation, they may be slightly behind */
+    *pcLookup = *pcHit = 0;
+    for (i = 0; i < G_N_ELEMENTS(acCount); i++) {
+        *pcLookup += acCount[i].cLookup;
+        *pcHit += acCount[i].cHit;
+    }
+}
@@ -0,0 +1,45 @@
+/*
+ * Copyright (C) 2024 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * $Id$
+ */
+
+#ifndef EVALSTORE_H
+#define EVALSTORE_H
+
+#include "eval.h"
+
+/* set when a persistent evaluation store is open */
+extern int fEvalStore;
+
+extern int EvalStoreOpen(const char *szFile);
+extern void EvalStoreClose(void);
+extern const char *EvalStoreFile(void);
+
+/* Same conventions as the evaluation cache: pec->key and
+ * pec->nEvalContext identify the evaluation, pec->ar[5] is the cubeful
+ * equity. Returns TRUE on a hit. */
+extern int EvalStoreLookup(const evalcache * pec, const cubeinfo * pci, float arOut[], float *arCubeful);
+extern void EvalStoreAdd(const evalcache * pec, const cubeinfo * pci);
+
+/* to be called when cached evaluations become invalid (new match
+ * equity table, ...) */
+extern void EvalStoreSettingsChanged(void);
+
+extern void EvalStoreStats(unsigned int *pcRecords, unsigned int *pcAdded, unsigned int *pcLookup,
+                           unsigned int *pcHit);
+
+#endif
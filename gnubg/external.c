@@ -120,6 +120,7 @@
 #include "rollout.h"
 #include "eval.h"
 #include "matchid.h"
+#include "multithread.h"
 #include "lib/gnubg-types.h"
 
 #if HAVE_SOCKETS
@@ -357,6 +358,18 @@ ExtParse(scancontext * scanctx, const char *szCommand)
     return scanctx->fError ? NULL : scanctx;
 }
 
+/* The equity reported for an evaluation: cubeless or cubeful, in match
+ * winning chance for match play */
+
+static float
+ExtEquity(const float arOutput[NUM_ROLLOUT_OUTPUTS], const cubeinfo * pci, int fCubeful)
+{
+    if (pci->nMatchTo)
+        return fCubeful ? arOutput[OUTPUT_CUBEFUL_EQUITY] : eq2mwc(arOutput[OUTPUT_EQUITY], pci);
+    else
+        return fCubeful ? arOutput[OUTPUT_CUBEFUL_EQUITY] : arOutput[OUTPUT_EQUITY];
+}
+
 static char *
 ExtEvaluation(scancontext * pec)
 {
@@ -395,13 +408,7 @@ ExtEvaluation(scancontext * pec)
     if (GeneralEvaluationE(arOutput, (ConstTanBoard) processedBoard.anBoard, &ci, &ec))
         return NULL;
 
-    if (processedBoard.nMatchTo) {
-        if (ec.fCubeful)
-            r = arOutput[OUTPUT_CUBEFUL_EQUITY];
-        else
-            r = eq2mwc(arOutput[OUTPUT_EQUITY], &ci);
-    } else
-        r = ec.fCubeful ? arOutput[6] : arOutput[5];
+    r = ExtEquity(arOutput, &ci, ec.fCubeful);
 
     szResponse = g_strdup_printf("%f %f %f %f %f %f\n",
                                  arOutput[0], arOutput[1], arOutput[2], arOutput[3], arOutput[4], r);
@@ -565,6 +572,805 @@ ExtFIBSBoard(scancontext * pec)
 
     return szResponse;
 }
+
+/* The request and the board, to send to the controller ahead of the
+ * reply, for "set debug on" */
+
+static char *
+ExtDebugBoard(scancontext * pScanCtx)
+{
+    ProcessedFIBSBoard processedBoard;
+    GValue *optionsmapgv;
+    GValue *boarddatagv;
+    GString *dbgStr;
+    int anScore[2];
+    int fcrawford, fjacoby;
+    char *asz[7] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+    char szBoard[10000];
+    char **aszLines, **aszLinesOrig;
+    char *szMatchID;
+
+    optionsmapgv = (GValue *) g_list_nth_data(g_value_get_boxed(pScanCtx->pCmdData), 1);
+    boarddatagv = (GValue *) g_list_nth_data(g_value_get_boxed(pScanCtx->pCmdData), 0);
+    dbgStr = g_string_new(DEBUG_PREFIX);
+    g_value_tostring(dbgStr, optionsmapgv, 0);
+    g_string_append(dbgStr, "\n" DEBUG_PREFIX);
+    g_value_tostring(dbgStr, boarddatagv, 0);
+    g_string_append(dbgStr, "\n" DEBUG_PREFIX "\n");
+    ProcessFIBSBoardInfo(&pScanCtx->bi, &processedBoard);
+
+    anScore[0] = processedBoard.nScoreOpp;
+    anScore[1] = processedBoard.nScore;
+    /* If the session isn't using Crawford rule, set Crawford flag to false */
+    fcrawford = pScanCtx->fCrawfordRule ? processedBoard.fCrawford : FALSE;
+    /* Set the Jacoby flag appropriately from the external interface settings */
+    fjacoby = pScanCtx->fJacobyRule;
+
+    szMatchID = MatchID((unsigned int *) processedBoard.anDice, 1, processedBoard.nResignation,
+                        processedBoard.fDoubled, 1, processedBoard.fCubeOwner, fcrawford,
+                        processedBoard.nMatchTo, anScore, processedBoard.nCube, fjacoby,
+                        GAME_PLAYING);
+
+    DrawBoard(szBoard, (ConstTanBoard) & processedBoard.anBoard, 1, asz, szMatchID, 15);
+
+    aszLines = g_strsplit(&szBoard[0], "\n", 32);
+    aszLinesOrig = aszLines;
+    while (*aszLines) {
+        g_string_append_printf(dbgStr, DEBUG_PREFIX "%s\n", *aszLines);
+        aszLines++;
+    }
+
+    g_string_append_printf(dbgStr, DEBUG_PREFIX "X is %s, O is %s\n", processedBoard.szPlayer,
+                           processedBoard.szOpp);
+    if (processedBoard.nMatchTo) {
+        g_string_append_printf(dbgStr, DEBUG_PREFIX "Match Play %s Crawford Rule\n",
+                               pScanCtx->fCrawfordRule ? "with" : "without");
+        g_string_append_printf(dbgStr, DEBUG_PREFIX "Score: %d-%d/%d%s, ", processedBoard.nScore,
+                               processedBoard.nScoreOpp, processedBoard.nMatchTo,
+                               fcrawford ? "*" : "");
+    } else {
+        g_string_append_printf(dbgStr, DEBUG_PREFIX "Money Session %s Jacoby Rule, %s Beavers\n",
+                               pScanCtx->fJacobyRule ? "with" : "without",
+                               pScanCtx->fBeavers ? "with" : "without");
+        g_string_append_printf(dbgStr, DEBUG_PREFIX "Score: %d-%d, ", processedBoard.nScore,
+                               processedBoard.nScoreOpp);
+    }
+    g_string_append_printf(dbgStr, "Roll: %d%d\n",
+                           processedBoard.anDice[0], processedBoard.anDice[1]);
+    g_string_append_printf(dbgStr,
+                           DEBUG_PREFIX
+                           "CubeOwner: %d, Cube: %d, Turn: %c, Doubled: %d, Resignation: %d\n",
+                           processedBoard.fCubeOwner, processedBoard.nCube, 'X',
+                           processedBoard.fDoubled, processedBoard.nResignation);
+    g_string_append(dbgStr, DEBUG_PREFIX "\n");
+
+    g_strfreev(aszLinesOrig);
+
+    return g_string_free(dbgStr, FALSE);
+}
+
+/* The commands that don't need an evaluation */
+
+static char *
+ExtCommand(scancontext * pScanCtx)
+{
+    gchar *szOptStr;
+    char *szResponse;
+
+    switch (pScanCtx->ct) {
+    case COMMAND_HELP:
+        szResponse = g_strdup("\tNo help information available\n");
+        break;
+
+    case COMMAND_SET:
+        szOptStr = g_value_get_gstring_gchar(g_list_nth_data(pScanCtx->pCmdData, 0));
+        if (g_ascii_strcasecmp(szOptStr, KEY_STR_DEBUG) == 0) {
+            pScanCtx->fDebug = g_value_get_int(g_list_nth_data(pScanCtx->pCmdData, 1));
+            szResponse = g_strdup_printf("Debug output %s\n", pScanCtx->fDebug ? "ON" : "OFF");
+        } else if (g_ascii_strcasecmp(szOptStr, KEY_STR_NEWINTERFACE) == 0) {
+            pScanCtx->fNewInterface = g_value_get_int(g_list_nth_data(pScanCtx->pCmdData, 1));
+            szResponse = g_strdup_printf("New interface %s\n", pScanCtx->fNewInterface ? "ON" : "OFF");
+        } else {
+            szResponse = g_strdup_printf("Error: set option '%s' not supported\n", szOptStr);
+        }
+        g_list_gv_boxed_free(pScanCtx->pCmdData);
+
+        break;
+
+    case COMMAND_VERSION:
+        szResponse = g_strdup("Interface: " EXTERNAL_INTERFACE_VERSION "\n"
+                              "RFBF: " RFBF_VERSION_SUPPORTED "\n"
+                              "Engine: " WEIGHTS_VERSION "\n" "Software: " VERSION "\n");
+
+        break;
+
+    case COMMAND_NONE:
+        szResponse = g_strdup("Error: no command given\n");
+        break;
+
+    default:
+        szResponse = g_strdup("Unsupported Command\n");
+    }
+
+    return szResponse;
+}
+
+/*
+ * Concurrent server ("external <socket> concurrent").
+ *
+ * Any number of controllers can be connected at once and each may send
+ * many requests without waiting for the replies. Evaluation and board
+ * requests are parsed in the main thread and evaluated as tasks by the
+ * worker threads; the main thread writes the replies back.
+ *
+ * A request line may start with a tag, "#<id> ", which is repeated at
+ * the start of its reply. Tagged requests are answered as soon as they
+ * are evaluated; untagged ones are answered in the order they came in,
+ * as in the one controller mode.
+ *
+ * Controllers can also send binary requests for many positions at
+ * once, see ExtHandleBinary().
+ */
+
+#define EXT_MAX_LINE 4096
+/* Replies waiting for a controller beyond which its requests are no
+ * longer read */
+#define EXT_MAX_OUTPUT (1024 * 1024)
+
+typedef struct {
+    int h;                      /* -1 once closed */
+    scancontext scanctx;
+    GString *gsIn;              /* incomplete input line or binary request */
+    GString *gsOut;             /* replies not sent yet */
+    GQueue *pqOrdered;          /* untagged requests not answered yet */
+    int cPending;               /* requests not answered yet */
+    int fExit;
+} extclient;
+
+typedef struct extbatch extbatch;
+
+typedef struct {
+    extclient *pxc;
+    char *szTag;                /* "#<id> ", or NULL */
+    char *szDebug;              /* sent ahead of the reply, or NULL */
+    scancontext sc;             /* copy of the parsed request */
+    int fBinary;                /* answered when ready, like tagged requests */
+    extbatch *pxb;              /* binary request, or NULL */
+    char *szResponse;
+    size_t cbResponse;          /* for binary responses */
+    int fDone;
+} extrequest;
+
+/* requests evaluated by the workers, protected by MT_Exclusive() */
+static GSList *plExtDone;
+static TaskGroup tgExt;
+/* requests handed to the workers and not collected yet */
+static int cExtRunning;
+
+static void
+ExtRequestTask(void *p)
+{
+    extrequest *pxr = (extrequest *) p;
+    char *sz = pxr->sc.ct == COMMAND_EVALUATION ? ExtEvaluation(&pxr->sc) : ExtFIBSBoard(&pxr->sc);
+
+    pxr->szResponse = sz ? sz : g_strdup("Error: evaluation failed\n");
+
+    MT_Exclusive();
+    plExtDone = g_slist_prepend(plExtDone, pxr);
+    MT_Release();
+}
+
+static void
+ExtCloseClient(extclient * pxc)
+{
+    if (pxc->h >= 0) {
+        closesocket(pxc->h);
+        pxc->h = -1;
+    }
+    g_string_truncate(pxc->gsOut, 0);
+}
+
+static void
+ExtFreeClient(extclient * pxc)
+{
+    ExtCloseClient(pxc);
+    unset_scan_context(&pxc->scanctx, TRUE);
+    g_string_free(pxc->gsIn, TRUE);
+    g_string_free(pxc->gsOut, TRUE);
+    g_queue_free(pxc->pqOrdered);
+    g_free(pxc);
+}
+
+/* Send what can be sent of the replies to a controller without
+ * blocking. The rest is sent when its socket is writable again, so a
+ * controller that doesn't read its replies doesn't hold up the others. */
+
+static void
+ExtFlushClient(extclient * pxc)
+{
+#ifndef WIN32
+    psighandler sh;
+#endif
+    int n;
+
+    if (pxc->h < 0 || !pxc->gsOut->len)
+        return;
+
+#ifndef WIN32
+    PortableSignal(SIGPIPE, SIG_IGN, &sh, FALSE);
+    n = (int) send(pxc->h, pxc->gsOut->str, pxc->gsOut->len, MSG_DONTWAIT);
+    PortableSignalRestore(SIGPIPE, &sh);
+
+    if (n < 0 && (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK))
+        return;
+#else
+    n = send((SOCKET) pxc->h, pxc->gsOut->str, (int) pxc->gsOut->len, 0);
+
+    if (n < 0 && WSAGetLastError() == WSAEWOULDBLOCK)
+        return;
+#endif
+
+    if (n < 0) {
+        SockErr(_("writing to external connection"));
+        ExtCloseClient(pxc);
+        return;
+    }
+
+    g_string_erase(pxc->gsOut, 0, n);
+}
+
+static void
+ExtWriteResponse(extclient * pxc, extrequest * pxr)
+{
+    if (pxc->h >= 0 && pxr->szResponse) {
+        if (pxr->szDebug)
+            g_string_append(pxc->gsOut, pxr->szDebug);
+        if (pxr->szTag)
+            g_string_append(pxc->gsOut, pxr->szTag);
+        g_string_append_len(pxc->gsOut, pxr->szResponse,
+                            (gssize) (pxr->cbResponse ? pxr->cbResponse : strlen(pxr->szResponse)));
+    }
+
+    pxc->cPending--;
+
+    unset_scan_context(&pxr->sc, FALSE);
+    g_free(pxr->pxb);
+    g_free(pxr->szTag);
+    g_free(pxr->szDebug);
+    g_free(pxr->szResponse);
+    g_free(pxr);
+}
+
+/* Write the replies that are ready, keeping untagged ones in order */
+
+static void
+ExtRequestDone(extrequest * pxr)
+{
+    extclient *pxc = pxr->pxc;
+
+    pxr->fDone = TRUE;
+
+    if (pxr->szTag || pxr->fBinary) {
+        ExtWriteResponse(pxc, pxr);
+        return;
+    }
+
+    while (!g_queue_is_empty(pxc->pqOrdered) && ((extrequest *) g_queue_peek_head(pxc->pqOrdered))->fDone)
+        ExtWriteResponse(pxc, (extrequest *) g_queue_pop_head(pxc->pqOrdered));
+}
+
+static void
+ExtCollectDone(void)
+{
+    GSList *pl, *plDone;
+
+    MT_Exclusive();
+    plDone = plExtDone;
+    plExtDone = NULL;
+    MT_Release();
+
+    for (pl = plDone; pl; pl = g_slist_next(pl)) {
+        ExtRequestDone((extrequest *) pl->data);
+        cExtRunning--;
+    }
+
+    g_slist_free(plDone);
+}
+
+static void
+ExtWaitForRunning(void)
+{
+    while (cExtRunning) {
+        g_usleep(1000);
+        ExtCollectDone();
+    }
+}
+
+static void
+ExtHandleLine(extclient * pxc, char *szLine)
+{
+    extrequest *pxr = g_new0(extrequest, 1);
+    char szCommand[EXT_MAX_LINE + 2];
+    char *pch;
+
+    pxr->pxc = pxc;
+    pxc->cPending++;
+
+    if (*szLine == '#' && (pch = strchr(szLine, ' '))) {
+        pxr->szTag = g_strndup(szLine, (gsize) (pch - szLine + 1));
+        szLine = pch + 1;
+    } else
+        g_queue_push_tail(pxc->pqOrdered, pxr);
+
+    /* To keep lexer happy terminate each line with \n */
+    g_strlcpy(szCommand, szLine, sizeof(szCommand) - 1);
+    strcat(szCommand, "\n");
+
+    if (!ExtParse(&pxc->scanctx, szCommand)) {
+        /* parse error */
+        pxr->szResponse = pxc->scanctx.szError;
+        pxc->scanctx.szError = NULL;
+    } else {
+        switch (pxc->scanctx.ct) {
+        case COMMAND_FIBSBOARD:
+        case COMMAND_EVALUATION:
+            if (pxc->scanctx.fDebug)
+                pxr->szDebug = ExtDebugBoard(&pxc->scanctx);
+            g_value_unsetfree(pxc->scanctx.pCmdData);
+
+            /* the request now owns the player names */
+            memcpy(&pxr->sc, &pxc->scanctx, sizeof(scancontext));
+            pxr->sc.scanner = NULL;
+            pxc->scanctx.bi.gsName = pxc->scanctx.bi.gsOpp = NULL;
+
+            if (pxr->sc.ct == COMMAND_FIBSBOARD && GetEvalCube()->et == EVAL_ROLLOUT) {
+                /* Rollouts use the worker threads themselves; run them
+                 * here, once the queued requests are done. */
+                ExtWaitForRunning();
+                cExtRunning++;
+                ExtRequestTask(pxr);
+            } else {
+                cExtRunning++;
+                MT_AddGroupTask(&tgExt, ExtRequestTask, pxr);
+            }
+            unset_scan_context(&pxc->scanctx, FALSE);
+            return;
+
+        case COMMAND_EXIT:
+            pxc->fExit = TRUE;
+            break;
+
+        default:
+            pxr->szResponse = ExtCommand(&pxc->scanctx);
+        }
+        unset_scan_context(&pxc->scanctx, FALSE);
+    }
+
+    ExtRequestDone(pxr);
+}
+
+/*
+ * Binary requests.
+ *
+ * All numbers are 32 bit little endian integers or IEEE floats. A
+ * request is
+ *
+ *   "GNBQ", the number of bytes that follow, an id returned with the
+ *   response, the number of plies, flags (1: cubeful, 2: prune,
+ *   4: deterministic), the noise (float), the cube value, the cube
+ *   owner (-1 for centred, 0 for the player on roll, 1 for the
+ *   opponent), the player on roll (0 or 1), the match length (0 for
+ *   money), the scores of players 0 and 1,
+ *   the Crawford flag, the Jacoby flag, the number of positions and
+ *   then the positions, as the 10 byte keys that position IDs encode.
+ *
+ * and its response is
+ *
+ *   "GNBR", the number of bytes that follow, the id of the request,
+ *   a status (0: ok, 1: bad request, 2: evaluation failed), the number
+ *   of positions and EXT_BINARY_OUTPUTS floats per position: the five
+ *   probabilities and the equity, as for the text evaluation command.
+ *
+ * The positions of a request are evaluated in chunks of
+ * EXT_BINARY_CHUNK, as separate tasks.
+ */
+
+#define EXT_BINARY_REQUEST "GNBQ"
+#define EXT_BINARY_RESPONSE "GNBR"
+#define EXT_BINARY_HEADER 52
+#define EXT_BINARY_KEY 10
+#define EXT_BINARY_OUTPUTS 6
+#define EXT_BINARY_CHUNK 64
+#define EXT_MAX_BINARY (1024 * 1024)
+
+enum { EXT_BINARY_OK, EXT_BINARY_BAD_REQUEST, EXT_BINARY_FAILED };
+
+struct extbatch {
+    evalcontext ec;
+    cubeinfo ci;
+    unsigned int cPositions;
+    int cChunksLeft;
+    int fFailed;                /* set by any of the tasks, atomically */
+    TanBoard *aanBoard;
+    unsigned char *puchResponse;        /* the response being filled in */
+};
+
+typedef struct {
+    extrequest *pxr;
+    unsigned int iFirst;
+    unsigned int c;
+} extchunk;
+
+static guint32
+ExtGet32(const unsigned char *puch)
+{
+    return (guint32) puch[0] | ((guint32) puch[1] << 8) | ((guint32) puch[2] << 16) | ((guint32) puch[3] << 24);
+}
+
+static void
+ExtPut32(unsigned char *puch, guint32 n)
+{
+    puch[0] = (unsigned char) n;
+    puch[1] = (unsigned char) (n >> 8);
+    puch[2] = (unsigned char) (n >> 16);
+    puch[3] = (unsigned char) (n >> 24);
+}
+
+static float
+ExtGetFloat(const unsigned char *puch)
+{
+    guint32 n = ExtGet32(puch);
+    float r;
+
+    memcpy(&r, &n, sizeof(r));
+    return r;
+}
+
+static void
+ExtPutFloat(unsigned char *puch, float r)
+{
+    guint32 n;
+
+    memcpy(&n, &r, sizeof(n));
+    ExtPut32(puch, n);
+}
+
+/* Start a response for cPositions positions (the outputs are filled in
+ * later) */
+
+static void
+ExtBinaryResponse(extrequest * pxr, guint32 id, guint32 nStatus, unsigned int cPositions)
+{
+    size_t const cb = 20 + (size_t) cPositions * EXT_BINARY_OUTPUTS * 4;
+    unsigned char *puch = g_malloc(cb);
+
+    memcpy(puch, EXT_BINARY_RESPONSE, 4);
+    ExtPut32(puch + 4, (guint32) (cb - 8));
+    ExtPut32(puch + 8, id);
+    ExtPut32(puch + 12, nStatus);
+    ExtPut32(puch + 16, cPositions);
+
+    pxr->szResponse = (char *) puch;
+    pxr->cbResponse = cb;
+}
+
+static void
+ExtBinaryTask(void *p)
+{
+    extchunk *pxch = (extchunk *) p;
+    extrequest *pxr = pxch->pxr;
+    extbatch *pxb = pxr->pxb;
+    unsigned int i, j;
+
+    for (i = pxch->iFirst; i < pxch->iFirst + pxch->c && !MT_SafeGet(&pxb->fFailed); i++) {
+        float arOutput[NUM_ROLLOUT_OUTPUTS];
+        unsigned char *puch = pxb->puchResponse + 20 + (size_t) i * EXT_BINARY_OUTPUTS * 4;
+
+        if (GeneralEvaluationE(arOutput, (ConstTanBoard) pxb->aanBoard[i], &pxb->ci, &pxb->ec)) {
+            MT_SafeSet(&pxb->fFailed, TRUE);
+            break;
+        }
+
+        for (j = 0; j < 5; j++)
+            ExtPutFloat(puch + j * 4, arOutput[j]);
+        ExtPutFloat(puch + 20, ExtEquity(arOutput, &pxb->ci, pxb->ec.fCubeful));
+    }
+
+    g_free(pxch);
+
+    if (!MT_SafeDecCheck(&pxb->cChunksLeft))
+        return;
+
+    /* the last chunk */
+    if (MT_SafeGet(&pxb->fFailed)) {
+        guint32 const id = ExtGet32(pxb->puchResponse + 8);
+
+        g_free(pxb->puchResponse);
+        ExtBinaryResponse(pxr, id, EXT_BINARY_FAILED, 0);
+    }
+    g_free(pxb->aanBoard);
+    pxb->aanBoard = NULL;
+
+    MT_Exclusive();
+    plExtDone = g_slist_prepend(plExtDone, pxr);
+    MT_Release();
+}
+
+static void
+ExtHandleBinary(extclient * pxc, const unsigned char *puch, size_t cb)
+{
+    extrequest *pxr = g_new0(extrequest, 1);
+    extbatch *pxb;
+    guint32 const id = cb >= 4 ? ExtGet32(puch) : 0;
+    unsigned int nPlies, nFlags, cPositions, i;
+    int anScore[2];
+    int fMove, fCubeOwner;
+
+    pxr->pxc = pxc;
+    pxr->fBinary = TRUE;
+    pxc->cPending++;
+
+    if (cb < EXT_BINARY_HEADER
+        || (nPlies = ExtGet32(puch + 4)) > 7
+        || (cPositions = ExtGet32(puch + 48)) != (cb - EXT_BINARY_HEADER) / EXT_BINARY_KEY
+        || cb != EXT_BINARY_HEADER + (size_t) cPositions * EXT_BINARY_KEY) {
+        ExtBinaryResponse(pxr, id, EXT_BINARY_BAD_REQUEST, 0);
+        ExtRequestDone(pxr);
+        return;
+    }
+
+    pxr->pxb = pxb = g_new0(extbatch, 1);
+
+    nFlags = ExtGet32(puch + 8);
+    pxb->ec.nPlies = nPlies;
+    pxb->ec.fCubeful = (nFlags & 1) != 0;
+    pxb->ec.fUsePrune = (nFlags & 2) != 0;
+    pxb->ec.fDeterministic = (nFlags & 4) != 0;
+    pxb->ec.rNoise = ExtGetFloat(puch + 12);
+    pxb->ec.fAutoRollout = FALSE;
+
+    anScore[0] = (int) ExtGet32(puch + 32);
+    anScore[1] = (int) ExtGet32(puch + 36);
+
+    /* the request gives the owner relative to the player on roll */
+    fMove = ExtGet32(puch + 24) != 0;
+    switch ((int) ExtGet32(puch + 20)) {
+    case -1:
+        fCubeOwner = -1;
+        break;
+    case 0:
+        fCubeOwner = fMove;
+        break;
+    case 1:
+        fCubeOwner = !fMove;
+        break;
+    default:
+        fCubeOwner = -2;        /* rejected below */
+    }
+
+    if (fCubeOwner < -1
+        || SetCubeInfo(&pxb->ci, (int) ExtGet32(puch + 16), fCubeOwner, fMove, (int) ExtGet32(puch + 28), anScore,
+                       (int) ExtGet32(puch + 40) != 0, (int) ExtGet32(puch + 44) != 0, nBeavers, bgvDefault)) {
+        ExtBinaryResponse(pxr, id, EXT_BINARY_BAD_REQUEST, 0);
+        ExtRequestDone(pxr);
+        return;
+    }
+
+    pxb->cPositions = cPositions;
+    pxb->aanBoard = g_new(TanBoard, MAX(cPositions, 1));
+
+    for (i = 0; i < cPositions; i++) {
+        oldpositionkey key;
+
+        memcpy(key.auch, puch + EXT_BINARY_HEADER + i * EXT_BINARY_KEY, EXT_BINARY_KEY);
+        oldPositionFromKey(pxb->aanBoard[i], &key);
+
+        if (!CheckPosition((ConstTanBoard) pxb->aanBoard[i])) {
+            g_free(pxb->aanBoard);
+            ExtBinaryResponse(pxr, id, EXT_BINARY_BAD_REQUEST, 0);
+            ExtRequestDone(pxr);
+            return;
+        }
+    }
+
+    ExtBinaryResponse(pxr, id, EXT_BINARY_OK, cPositions);
+
+    if (!cPositions) {
+        g_free(pxb->aanBoard);
+        ExtRequestDone(pxr);
+        return;
+    }
+
+    pxb->puchResponse = (unsigned char *) pxr->szResponse;
+    pxb->cChunksLeft = (int) ((cPositions + EXT_BINARY_CHUNK - 1) / EXT_BINARY_CHUNK);
+
+    cExtRunning++;
+
+    for (i = 0; i < cPositions; i += EXT_BINARY_CHUNK) {
+        extchunk *pxch = g_new(extchunk, 1);
+
+        pxch->pxr = pxr;
+        pxch->iFirst = i;
+        pxch->c = MIN(EXT_BINARY_CHUNK, cPositions - i);
+        MT_AddGroupTask(&tgExt, ExtBinaryTask, pxch);
+    }
+}
+
+/* Read what the controller sent and handle the complete lines and
+ * binary requests */
+
+static void
+ExtReadClient(extclient * pxc)
+{
+    char ach[65536];
+    char *pch, *pchEnd;
+    size_t cbLeft;
+    int n;
+
+    if ((n = (int) recv(pxc->h, ach, sizeof(ach), 0)) <= 0) {
+#ifdef WIN32
+        if (n < 0 && WSAGetLastError() == WSAEWOULDBLOCK)
+            return;
+#endif
+        if (n < 0 && errno == EINTR)
+            return;
+        if (n < 0)
+            SockErr(_("reading from external connection"));
+        ExtCloseClient(pxc);
+        return;
+    }
+
+    g_string_append_len(pxc->gsIn, ach, n);
+
+    for (pch = pxc->gsIn->str; !pxc->fExit && pxc->h >= 0; pch = pchEnd + 1) {
+        cbLeft = pxc->gsIn->len - (size_t) (pch - pxc->gsIn->str);
+
+        if (cbLeft >= 4 && !memcmp(pch, EXT_BINARY_REQUEST, 4)) {
+            guint32 cb;
+
+            if (cbLeft < 8)
+                break;
+
+            if ((cb = ExtGet32((unsigned char *) pch + 4)) > EXT_MAX_BINARY) {
+                outputl(_("External connection closed: request too long."));
+                ExtCloseClient(pxc);
+                return;
+            }
+
+            if (cbLeft < 8 + (size_t) cb)
+                break;
+
+            ExtHandleBinary(pxc, (unsigned char *) pch + 8, cb);
+            pchEnd = pch + 8 + cb - 1;
+        } else if ((pchEnd = memchr(pch, '\n', cbLeft))) {
+            *pchEnd = 0;
+            if (pchEnd > pch && pchEnd[-1] == '\r')
+                pchEnd[-1] = 0;
+            ExtHandleLine(pxc, pch);
+        } else
+            break;
+    }
+
+    g_string_erase(pxc->gsIn, 0, (gssize) (pch - pxc->gsIn->str));
+
+    if (pxc->gsIn->len > EXT_MAX_LINE && memcmp(pxc->gsIn->str, EXT_BINARY_REQUEST, 4)) {
+        outputl(_("External connection closed: line too long."));
+        ExtCloseClient(pxc);
+    }
+}
+
+static void
+ExtServer(int h)
+{
+    GSList *plClients = NULL, *pl;
+
+    while (!fInterrupt) {
+        fd_set fds, fdsWrite;
+        struct timeval tv;
+        int hMax = h;
+
+        FD_ZERO(&fds);
+        FD_ZERO(&fdsWrite);
+        FD_SET(h, &fds);
+        for (pl = plClients; pl; pl = g_slist_next(pl)) {
+            extclient *pxc = pl->data;
+
+            if (pxc->h < 0)
+                continue;
+
+            if (!pxc->fExit && pxc->gsOut->len < EXT_MAX_OUTPUT)
+                FD_SET(pxc->h, &fds);
+            if (pxc->gsOut->len)
+                FD_SET(pxc->h, &fdsWrite);
+            hMax = MAX(hMax, pxc->h);
+        }
+
+        /* replies are written by this thread, so don't sleep long while
+         * requests are being evaluated */
+        tv.tv_sec = 0;
+        tv.tv_usec = cExtRunning ? 1000 : 100000;
+
+        if (select(hMax + 1, &fds, &fdsWrite, NULL, &tv) < 0) {
+            if (errno != EINTR) {
+                SockErr("select");
+                break;
+            }
+            FD_ZERO(&fds);
+            FD_ZERO(&fdsWrite);
+        }
+
+        if (FD_ISSET(h, &fds)) {
+            struct sockaddr_in saRemote;
+            socklen_t saLen = sizeof(struct sockaddr);
+            int hPeer = accept(h, (struct sockaddr *) &saRemote, &saLen);
+
+#if !defined(WIN32)
+            if (hPeer >= FD_SETSIZE) {
+                outputl(_("Too many external connections."));
+                closesocket(hPeer);
+                hPeer = -1;
+            }
+#endif
+            if (hPeer >= 0) {
+                extclient *pxc = g_new0(extclient, 1);
+#ifdef WIN32
+                u_long fNonBlocking = 1;
+
+                /* see ExtFlushClient() */
+                ioctlsocket((SOCKET) hPeer, FIONBIO, &fNonBlocking);
+#endif
+
+                pxc->h = hPeer;
+                pxc->gsIn = g_string_new(NULL);
+                pxc->gsOut = g_string_new(NULL);
+                pxc->pqOrdered = g_queue_new();
+                ExtInitParse(&pxc->scanctx.scanner);
+                plClients = g_slist_append(plClients, pxc);
+
+                outputf(_("Accepted connection from %s.\n"), inet_ntoa(saRemote.sin_addr));
+                outputx();
+            }
+        }
+
+        for (pl = plClients; pl; pl = g_slist_next(pl)) {
+            extclient *pxc = pl->data;
+
+            if (pxc->h >= 0 && FD_ISSET(pxc->h, &fds))
+                ExtReadClient(pxc);
+        }
+
+        ExtCollectDone();
+
+        /* what doesn't go out now waits for select() to find the
+         * socket writable */
+        for (pl = plClients; pl; pl = g_slist_next(pl))
+            ExtFlushClient((extclient *) pl->data);
+
+        /* forget the controllers that are gone and have no requests left */
+        for (pl = plClients; pl;) {
+            extclient *pxc = pl->data;
+
+            pl = g_slist_next(pl);
+
+            if (pxc->fExit && !pxc->cPending && !pxc->gsOut->len)
+                ExtCloseClient(pxc);
+
+            if (pxc->h < 0 && !pxc->cPending) {
+                plClients = g_slist_remove(plClients, pxc);
+                ExtFreeClient(pxc);
+            }
+        }
+
+        ProcessEvents();
+    }
+
+    /* let the workers finish before freeing the clients */
+    ExtWaitForRunning();
+
+    for (pl = plClients; pl; pl = g_slist_next(pl))
+        ExtFreeClient((extclient *) pl->data);
+    g_slist_free(plClients);
+}
 #endif
 
 extern void
@@ -587,8 +1393,13 @@ CommandExternal(char *sz)
     int fExit;
     int fRestart = TRUE;
     int retval = 0;
+    char *szMode;
+    int fConcurrent;
 
-    sz = NextToken(&sz);
+    szMode = sz;
+    sz = NextToken(&szMode);
+    szMode = NextToken(&szMode);
+    fConcurrent = szMode && !g_ascii_strncasecmp(szMode, "concurrent", strlen(szMode));
 
     if (!sz || !*sz) {
         outputl(_("You must specify the name of the socket to the external controller."));
@@ -620,12 +1431,22 @@ CommandExternal(char *sz)
 
         g_free(psa);
 
-        if (listen(h, 1) < 0) {
+        if (listen(h, fConcurrent ? SOMAXCONN : 1) < 0) {
             SockErr("listen");
             closesocket(h);
             ExtDestroyParse(scanctx.scanner);
             return;
         }
+
+        if (fConcurrent) {
+            outputf(_("Waiting for connections from %s...\n"), sz);
+            outputx();
+            ExtServer(h);
+            closesocket(h);
+            ExtDestroyParse(scanctx.scanner);
+            return;
+        }
+
         outputf(_("Waiting for a connection from %s...\n"), sz);
         outputx();
         ProcessEvents();
@@ -668,114 +1489,14 @@ CommandExternal(char *sz)
                 /* parse error */
                 szResponse = scanctx.szError;
             } else {
-                ProcessedFIBSBoard processedBoard;
-                gchar *szOptStr;
-
                 switch (scanctx.ct) {
-                case COMMAND_HELP:
-                    szResponse = g_strdup("\tNo help information available\n");
-                    break;
-
-                case COMMAND_SET:
-                    szOptStr = g_value_get_gstring_gchar(g_list_nth_data(scanctx.pCmdData, 0));
-                    if (g_ascii_strcasecmp(szOptStr, KEY_STR_DEBUG) == 0) {
-                        scanctx.fDebug = g_value_get_int(g_list_nth_data(scanctx.pCmdData, 1));
-                        szResponse = g_strdup_printf("Debug output %s\n", scanctx.fDebug ? "ON" : "OFF");
-                    } else if (g_ascii_strcasecmp(szOptStr, KEY_STR_NEWINTERFACE) == 0) {
-                        scanctx.fNewInterface = g_value_get_int(g_list_nth_data(scanctx.pCmdData, 1));
-                        szResponse = g_strdup_printf("New interface %s\n", scanctx.fNewInterface ? "ON" : "OFF");
-                    } else {
-                        szResponse = g_strdup_printf("Error: set option '%s' not supported\n", szOptStr);
-                    }
-                    g_list_gv_boxed_free(scanctx.pCmdData);
-
-                    break;
-
-                case COMMAND_VERSION:
-                    szResponse = g_strdup("Interface: " EXTERNAL_INTERFACE_VERSION "\n"
-                                          "RFBF: " RFBF_VERSION_SUPPORTED "\n"
-                                          "Engine: " WEIGHTS_VERSION "\n" "Software: " VERSION "\n");
-
-                    break;
-
-                case COMMAND_NONE:
-                    szResponse = g_strdup("Error: no command given\n");
-                    break;
-
                 case COMMAND_FIBSBOARD:
                 case COMMAND_EVALUATION:
                     if (scanctx.fDebug) {
-                        GValue *optionsmapgv;
-                        GValue *boarddatagv;
-                        GString *dbgStr;
-                        int anScore[2];
-                        int fcrawford, fjacoby;
-                        char *asz[7] = { NULL, NULL, NULL, NULL, NULL, NULL, NULL };
-                        char szBoard[10000];
-                        char **aszLines, **aszLinesOrig;
-                        char *szMatchID;
-
-                        optionsmapgv = (GValue *) g_list_nth_data(g_value_get_boxed(scanctx.pCmdData), 1);
-                        boarddatagv = (GValue *) g_list_nth_data(g_value_get_boxed(scanctx.pCmdData), 0);
-                        dbgStr = g_string_new(DEBUG_PREFIX);
-                        g_value_tostring(dbgStr, optionsmapgv, 0);
-                        g_string_append(dbgStr, "\n" DEBUG_PREFIX);
-                        g_value_tostring(dbgStr, boarddatagv, 0);
-                        g_string_append(dbgStr, "\n" DEBUG_PREFIX "\n");
-                        ExternalWrite(hPeer, dbgStr->str, strlen(dbgStr->str));
-                        ProcessFIBSBoardInfo(&scanctx.bi, &processedBoard);
-
-                        anScore[0] = processedBoard.nScoreOpp;
-                        anScore[1] = processedBoard.nScore;
-                        /* If the session isn't using Crawford rule, set Crawford flag to false */
-                        fcrawford = scanctx.fCrawfordRule ? processedBoard.fCrawford : FALSE;
-                        /* Set the Jacoby flag appropriately from the external interface settings */
-                        fjacoby = scanctx.fJacobyRule;
-
-                        szMatchID = MatchID((unsigned int *) processedBoard.anDice, 1, processedBoard.nResignation,
-                                            processedBoard.fDoubled, 1, processedBoard.fCubeOwner, fcrawford,
-                                            processedBoard.nMatchTo, anScore, processedBoard.nCube, fjacoby,
-                                            GAME_PLAYING);
-
-                        DrawBoard(szBoard, (ConstTanBoard) & processedBoard.anBoard, 1, asz, szMatchID, 15);
-
-                        aszLines = g_strsplit(&szBoard[0], "\n", 32);
-                        aszLinesOrig = aszLines;
-                        while (*aszLines) {
-                            ExternalWrite(hPeer, DEBUG_PREFIX, strlen(DEBUG_PREFIX));
-                            ExternalWrite(hPeer, *aszLines, strlen(*aszLines));
-                            ExternalWrite(hPeer, "\n", 1);
-                            aszLines++;
-                        }
-
-                        dbgStr = g_string_assign(dbgStr, "");
-                        g_string_append_printf(dbgStr, DEBUG_PREFIX "X is %s, O is %s\n", processedBoard.szPlayer,
-                                               processedBoard.szOpp);
-                        if (processedBoard.nMatchTo) {
-                            g_string_append_printf(dbgStr, DEBUG_PREFIX "Match Play %s Crawford Rule\n",
-                                                   scanctx.fCrawfordRule ? "with" : "without");
-                            g_string_append_printf(dbgStr, DEBUG_PREFIX "Score: %d-%d/%d%s, ", processedBoard.nScore,
-                                                   processedBoard.nScoreOpp, processedBoard.nMatchTo,
-                                                   fcrawford ? "*" : "");
-                        } else {
-                            g_string_append_printf(dbgStr, DEBUG_PREFIX "Money Session %s Jacoby Rule, %s Beavers\n",
-                                                   scanctx.fJacobyRule ? "with" : "without",
-                                                   scanctx.fBeavers ? "with" : "without");
-                            g_string_append_printf(dbgStr, DEBUG_PREFIX "Score: %d-%d, ", processedBoard.nScore,
-                                                   processedBoard.nScoreOpp);
-                        }
-                        g_string_append_printf(dbgStr, "Roll: %d%d\n",
-                                               processedBoard.anDice[0], processedBoard.anDice[1]);
-                        g_string_append_printf(dbgStr,
-                                               DEBUG_PREFIX
-                                               "CubeOwner: %d, Cube: %d, Turn: %c, Doubled: %d, Resignation: %d\n",
-                                               processedBoard.fCubeOwner, processedBoard.nCube, 'X',
-                                               processedBoard.fDoubled, processedBoard.nResignation);
-                        g_string_append(dbgStr, DEBUG_PREFIX "\n");
-                        ExternalWrite(hPeer, dbgStr->str, strlen(dbgStr->str));
-
-                        g_string_free(dbgStr, TRUE);
-                        g_strfreev(aszLinesOrig);
+                        char *szDebug = ExtDebugBoard(&scanctx);
+
+                        ExternalWrite(hPeer, szDebug, strlen(szDebug));
+                        g_free(szDebug);
                     }
                     g_value_unsetfree(scanctx.pCmdData);
 
@@ -792,7 +1513,7 @@ CommandExternal(char *sz)
                     break;
 
                 default:
-                    szResponse = g_strdup("Unsupported Command\n");
+                    szResponse = ExtCommand(&scanctx);
                 }
                 unset_scan_context(&scanctx, FALSE);
             }
@@ -76,6 +76,7 @@ static char szCommandSeparators[] = " \t\n\r\v\f";
 #include "dice.h"
 #include "drawboard.h"
 #include "eval.h"
+#include "evalstore.h"
 #include "sgf.h"
 #include "export.h"
 #include "matchequity.h"
@@ -3488,14 +3489,19 @@ static void
 SaveEvaluationSettings(FILE * pf)
 {
     fprintf(pf, "set eval sameasanalysis %s\n", fEvalSameAsAnalysis ? "on" : "off");
+    fprintf(pf, "set evaluation quantized %s\n", fQuantizedEval ? "on" : "off");
+    if (EvalStoreFile())
+        fprintf(pf, "set evaluation store \"%s\"\n", EvalStoreFile());
     SaveEvalSetupSettings(pf, "set evaluation chequerplay", &esEvalChequer);
     SaveEvalSetupSettings(pf, "set evaluation cubedecision", &esEvalCube);
     SaveMoveFilterSettings(pf, "set evaluation movefilter", aamfEval);
     fprintf(pf, "set cache %u\n", GetEvalCacheEntries());
+    fprintf(pf, "set transpositions %u\n", cTranspositions);
     fprintf(pf, "set matchequitytable \"%s\"\n", miCurrent.szFileName);
     fprintf(pf, "set invert matchequitytable %s\n", fInvertMET ? "on" : "off");
 #if defined(USE_MULTITHREAD)
     fprintf(pf, "set threads %u\n", MT_GetNumThreads());
+    fprintf(pf, "set evaluation split %u\n", nSplitPlies);
 #endif
 }
 
@@ -3645,6 +3651,9 @@ CommandSaveSettings(char *szParam)
     SavePlayerSettings(pf);
     SaveRNGSettings(pf, "set", rngCurrent, rngctxCurrent);
     SaveRolloutSettings(pf, "set rollout", &rcRollout);
+    fprintf(pf, "set rollout lockstep %u\n", cRolloutLockstep);
+    fprintf(pf, "set rollout processes %u\n", cRolloutProcesses);
+    fprintf(pf, "set rollout checkinterval %u\n", cRolloutCheckInterval);
     SaveImportExportSettings(pf);
     SaveSoundSettings(pf);
     RelationalSaveSettings(pf);
@@ -5999,7 +6008,7 @@ RunAsyncProcess(AsyncFun fun, void *data, const char *msg)
     pt->pLinkedTask = NULL;
     pt->fun = fun;
     pt->data = data;
-    MT_AddTask(pt, TRUE);
+    MT_AddTask(pt);
 #endif
 
     ProgressStart(msg);
@@ -0,0 +1,459 @@
+/*
+ * Copyright (C) 2024 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * $Id$
+ */
+
+/*
+ * Throughput and latency benchmarks of the evaluation code.
+ *
+ * The positions are generated from a fixed seed: contact, crashed and
+ * race positions come from 0-ply self play games, bearoff positions are
+ * drawn at random. For given weights and bearoff databases the same
+ * positions are therefore used by every run, and the results of two
+ * builds can be compared ("make bench" writes them to bench.json).
+ *
+ * Each benchmark is timed in samples of a few operations; the
+ * percentiles are those of the time per operation of the samples.
+ */
+
+#include "config.h"
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <locale.h>
+
+#include "backgammon.h"
+#include "eval.h"
+#include "positionid.h"
+#include "bearoff.h"
+#include "multithread.h"
+#include "glib-ext.h"
+#include "output.h"
+#include "util.h"
+#include "lib/isaac.h"
+#include "lib/simd.h"
+
+#define MAX_BENCH 16
+#define CORPUS_SIZE 512
+
+typedef struct {
+    TanBoard anBoard;
+    int n0, n1;
+} benchposition;
+
+typedef struct {
+    benchposition *abp;
+    unsigned int c;
+} corpus;
+
+typedef struct {
+    const char *szName;
+    unsigned int cOps;
+    double rSeconds;
+    double arLatency[4];        /* p50, p90, p99, max in microseconds */
+} benchresult;
+
+typedef void (*benchfun) (const benchposition * pbp);
+
+static corpus acorpus[N_CLASSES];
+static benchresult abr[MAX_BENCH];
+static unsigned int cBench;
+static randctx rc;
+
+static evalcontext ecBench = { TRUE, 0, TRUE, TRUE, 0.0, FALSE };
+
+extern void
+MT_CloseThreads(void)
+{
+    return;
+}
+
+static void
+StartingPosition(TanBoard anBoard)
+{
+    int i;
+
+    memset(anBoard, 0, sizeof(TanBoard));
+
+    for (i = 0; i < 2; i++) {
+        anBoard[i][5] = anBoard[i][12] = 5;
+        anBoard[i][7] = 3;
+        anBoard[i][23] = 2;
+    }
+}
+
+static int
+Dice(void)
+{
+    return (int) (irand(&rc) % 6) + 1;
+}
+
+static void
+CorpusAdd(positionclass pc, const TanBoard anBoard, int n0, int n1)
+{
+    corpus *pco = acorpus + pc;
+    benchposition *pbp;
+
+    if (pco->c == CORPUS_SIZE)
+        return;
+
+    if (!pco->abp)
+        pco->abp = g_new(benchposition, CORPUS_SIZE);
+
+    pbp = pco->abp + pco->c++;
+    memcpy(pbp->anBoard, anBoard, sizeof(TanBoard));
+    pbp->n0 = n0;
+    pbp->n1 = n1;
+}
+
+/* Fill the contact, crashed and race corpora from cubeless 0-ply games
+ * (one position in four is kept) */
+
+static void
+PlayCorpusGames(void)
+{
+    unsigned int iGame;
+
+    for (iGame = 0; iGame < 1000; iGame++) {
+        TanBoard anBoard;
+        int anMove[8];
+        positionclass pc;
+
+        if (acorpus[CLASS_CONTACT].c == CORPUS_SIZE && acorpus[CLASS_RACE].c == CORPUS_SIZE
+            && acorpus[CLASS_CRASHED].c >= CORPUS_SIZE / 4)
+            break;
+
+        StartingPosition(anBoard);
+
+        while ((pc = ClassifyPosition((ConstTanBoard) anBoard, VARIATION_STANDARD)) != CLASS_OVER) {
+            int n0 = Dice(), n1 = Dice();
+
+            if (pc >= CLASS_RACE && !(irand(&rc) & 3))
+                CorpusAdd(pc, (ConstTanBoard) anBoard, n0, n1);
+
+            FindBestMove(anMove, n0, n1, anBoard, &ciCubeless, &ecBench, defaultFilters);
+            SwapSides(anBoard);
+        }
+    }
+}
+
+/* Random positions with up to cChequers chequers on the cPoints
+ * lowest points of each side */
+
+static void
+BearoffCorpus(positionclass pc, unsigned int cPoints, unsigned int cChequers)
+{
+    unsigned int i, j, k;
+
+    for (i = 0; i < CORPUS_SIZE; i++) {
+        TanBoard anBoard;
+
+        memset(anBoard, 0, sizeof(anBoard));
+
+        for (j = 0; j < 2; j++) {
+            unsigned int c = 1 + irand(&rc) % cChequers;
+
+            for (k = 0; k < c; k++)
+                anBoard[j][irand(&rc) % cPoints]++;
+        }
+
+        CorpusAdd(pc, (ConstTanBoard) anBoard, Dice(), Dice());
+    }
+}
+
+static void
+BenchGenerateMoves(const benchposition * pbp)
+{
+    movelist ml;
+
+    GenerateMoves(&ml, pbp->anBoard, pbp->n0, pbp->n1, FALSE);
+}
+
+static void
+BenchInputs(const benchposition * pbp)
+{
+    /* the inputs of the pruning nets */
+    SSE_ALIGN(float arInput[25 * 4 * 2]);
+
+    baseInputs(pbp->anBoard, arInput);
+}
+
+static void
+BenchNet(const benchposition * pbp)
+{
+    SSE_ALIGN(float arOutput[NUM_OUTPUTS]);
+    float *par = arOutput;
+    unsigned int i = 0;
+
+    EvalNetBatch(ClassifyPosition(pbp->anBoard, VARIATION_STANDARD), &pbp->anBoard, &i, 1, &par,
+                 VARIATION_STANDARD);
+}
+
+static void
+BenchEvaluate(const benchposition * pbp)
+{
+    SSE_ALIGN(float arOutput[NUM_OUTPUTS]);
+
+    EvaluatePosition(NULL, pbp->anBoard, arOutput, &ciCubeless, NULL);
+}
+
+static void
+BenchBearoffOS(const benchposition * pbp)
+{
+    float arOutput[NUM_OUTPUTS];
+
+    BearoffEval(pbc1, pbp->anBoard, arOutput);
+}
+
+static void
+BenchBearoffTS(const benchposition * pbp)
+{
+    float arOutput[NUM_OUTPUTS];
+
+    BearoffEval(pbc2, pbp->anBoard, arOutput);
+}
+
+static int nPliesBench;
+
+static void
+BenchFindBestMove(const benchposition * pbp)
+{
+    evalcontext ec = ecBench;
+    TanBoard anBoard;
+    int anMove[8];
+
+    ec.nPlies = nPliesBench;
+    memcpy(anBoard, pbp->anBoard, sizeof(TanBoard));
+    FindBestMove(anMove, pbp->n0, pbp->n1, anBoard, &ciCubeless, &ec, defaultFilters);
+}
+
+static void
+BenchCubeDecision(const benchposition * pbp)
+{
+    float aarOutput[2][NUM_ROLLOUT_OUTPUTS];
+    evalsetup es;
+    cubeinfo ci;
+
+    es.et = EVAL_EVAL;
+    es.ec = ecBench;
+    es.ec.nPlies = 2;
+    SetCubeInfoMoney(&ci, 1, -1, 0, FALSE, FALSE, VARIATION_STANDARD);
+    GeneralCubeDecisionE(aarOutput, pbp->anBoard, &ci, &es.ec, &es);
+}
+
+/* A cubeless 0-ply game from the starting position; the dice come from
+ * the corpus entries that follow */
+
+static void
+BenchPlayout(const benchposition * pbp)
+{
+    TanBoard anBoard;
+    int anMove[8];
+
+    StartingPosition(anBoard);
+
+    while (ClassifyPosition((ConstTanBoard) anBoard, VARIATION_STANDARD) != CLASS_OVER) {
+        FindBestMove(anMove, pbp->n0, pbp->n1, anBoard, &ciCubeless, &ecBench, defaultFilters);
+        SwapSides(anBoard);
+
+        if (++pbp == acorpus[CLASS_CONTACT].abp + acorpus[CLASS_CONTACT].c)
+            pbp = acorpus[CLASS_CONTACT].abp;
+    }
+}
+
+static int
+CompareDouble(const void *p0, const void *p1)
+{
+    double const r0 = *(const double *) p0, r1 = *(const double *) p1;
+
+    return r0 < r1 ? -1 : r0 > r1;
+}
+
+/* Time cSamples samples of cBatch operations on the positions of pco,
+ * after an optional untimed pass over the corpus */
+
+static void
+RunBench(const char *szName, benchfun pf, const corpus * pco, unsigned int cSamples, unsigned int cBatch,
+         int fWarmUp)
+{
+    benchresult *pbr;
+    double *ar;
+    gint64 tTotal = 0;
+    unsigned int i, j, k = 0;
+
+    if (!pco->c || cBench == MAX_BENCH)
+        return;
+
+    EvalCacheFlush();
+
+    if (fWarmUp)
+        for (i = 0; i < pco->c; i++)
+            pf(pco->abp + i);
+
+    ar = g_new(double, cSamples);
+
+    for (i = 0; i < cSamples; i++) {
+        gint64 t = g_get_monotonic_time();
+
+        for (j = 0; j < cBatch; j++, k = (k + 1) % pco->c)
+            pf(pco->abp + k);
+
+        t = g_get_monotonic_time() - t;
+        tTotal += t;
+        ar[i] = (double) t / cBatch;
+    }
+
+    qsort(ar, cSamples, sizeof(double), CompareDouble);
+
+    pbr = abr + cBench++;
+    pbr->szName = szName;
+    pbr->cOps = cSamples * cBatch;
+    pbr->rSeconds = (double) tTotal / G_USEC_PER_SEC;
+    pbr->arLatency[0] = ar[cSamples / 2];
+    pbr->arLatency[1] = ar[(cSamples * 9) / 10];
+    pbr->arLatency[2] = ar[(cSamples * 99) / 100];
+    pbr->arLatency[3] = ar[cSamples - 1];
+
+    g_free(ar);
+
+    g_printerr("%-24s %10.0f ops/s\n", szName, pbr->rSeconds > 0.0 ? pbr->cOps / pbr->rSeconds : 0.0);
+}
+
+static void
+WriteResults(FILE * pf, unsigned int nSeed, unsigned int nScale)
+{
+    unsigned int i;
+
+    fprintf(pf, "{\n  \"version\": \"%s\",\n  \"seed\": %u,\n  \"scale\": %u,\n", VERSION, nSeed, nScale);
+    fprintf(pf, "  \"corpus\": { \"contact\": %u, \"crashed\": %u, \"race\": %u },\n",
+            acorpus[CLASS_CONTACT].c, acorpus[CLASS_CRASHED].c, acorpus[CLASS_RACE].c);
+    fprintf(pf, "  \"results\": [\n");
+
+    for (i = 0; i < cBench; i++) {
+        const benchresult *pbr = abr + i;
+
+        fprintf(pf, "    { \"name\": \"%s\", \"ops\": %u, \"seconds\": %.6f, \"ops_per_second\": %.1f, "
+                "\"latency_us\": { \"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f } }%s\n",
+                pbr->szName, pbr->cOps, pbr->rSeconds, pbr->rSeconds > 0.0 ? pbr->cOps / pbr->rSeconds : 0.0,
+                pbr->arLatency[0], pbr->arLatency[1], pbr->arLatency[2], pbr->arLatency[3],
+                i + 1 < cBench ? "," : "");
+    }
+
+    fprintf(pf, "  ]\n}\n");
+}
+
+extern int
+main(int argc, char **argv)
+{
+    unsigned int nSeed = 1;
+    unsigned int nScale = 1;
+    unsigned int i;
+    char *szDataDir = NULL;
+    char *szJSON = NULL;
+    char *szWeights, *szWeightsBinary;
+    FILE *pf = stdout;
+    GOptionEntry ao[] = {
+        {"datadir", 'd', 0, G_OPTION_ARG_FILENAME, &szDataDir,
+         N_("Directory of the weights and bearoff databases"), "dir"},
+        {"json", 'j', 0, G_OPTION_ARG_FILENAME, &szJSON,
+         N_("Write the results to this file (default: standard output)"), "file"},
+        {"seed", 's', 0, G_OPTION_ARG_INT, &nSeed,
+         N_("Seed of the position corpora. Default is 1"), "N"},
+        {"scale", 'n', 0, G_OPTION_ARG_INT, &nScale,
+         N_("Multiply the number of samples by N. Default is 1"), "N"},
+        {NULL, 0, 0, (GOptionArg) 0, NULL, NULL, NULL}
+    };
+    GError *error = NULL;
+    GOptionContext *context;
+
+    glib_ext_init();
+    MT_InitThreads();
+    setlocale(LC_ALL, "");
+    bindtextdomain(PACKAGE, LOCALEDIR);
+    textdomain(PACKAGE);
+
+    g_set_print_handler(print_utf8_to_locale);
+    g_set_printerr_handler(print_utf8_to_locale);
+
+    context = g_option_context_new(NULL);
+    g_option_context_add_main_entries(context, ao, PACKAGE);
+    g_option_context_parse(context, &argc, &argv, &error);
+    g_option_context_free(context);
+
+    if (error) {
+        g_printerr("%s\n", error->message);
+        exit(EXIT_FAILURE);
+    }
+
+    if (nScale < 1)
+        nScale = 1;
+
+    if (szDataDir)
+        pkg_datadir = szDataDir;
+
+    szWeights = BuildFilename("gnubg.weights");
+    szWeightsBinary = BuildFilename("gnubg.wd");
+    EvalInitialise(szWeights, szWeightsBinary, FALSE, NULL);
+    g_free(szWeights);
+    g_free(szWeightsBinary);
+
+    /* the results would vary with the settings of a user's gnubgrc */
+    fQuantizedEval = FALSE;
+
+    for (i = 0; i < RANDSIZ; i++)
+        rc.randrsl[i] = nSeed;
+    irandinit(&rc, TRUE);
+
+    PlayCorpusGames();
+    if (pbc1)
+        BearoffCorpus(CLASS_BEAROFF1, pbc1->nPoints, MIN(pbc1->nChequers, 15));
+    if (pbc2)
+        BearoffCorpus(CLASS_BEAROFF2, pbc2->nPoints, pbc2->nChequers);
+
+    RunBench("generate_moves", BenchGenerateMoves, acorpus + CLASS_CONTACT, 200 * nScale, 64, FALSE);
+    RunBench("inputs_base", BenchInputs, acorpus + CLASS_CONTACT, 200 * nScale, 64, FALSE);
+    RunBench("net_contact", BenchNet, acorpus + CLASS_CONTACT, 200 * nScale, 32, FALSE);
+    RunBench("net_crashed", BenchNet, acorpus + CLASS_CRASHED, 200 * nScale, 32, FALSE);
+    RunBench("net_race", BenchNet, acorpus + CLASS_RACE, 200 * nScale, 32, FALSE);
+    RunBench("cache_hit", BenchEvaluate, acorpus + CLASS_CONTACT, 200 * nScale, 64, TRUE);
+    RunBench("bearoff_one_sided", BenchBearoffOS, acorpus + CLASS_BEAROFF1, 200 * nScale, 64, FALSE);
+    RunBench("bearoff_two_sided", BenchBearoffTS, acorpus + CLASS_BEAROFF2, 200 * nScale, 64, FALSE);
+
+    nPliesBench = 1;
+    RunBench("find_best_move_1ply", BenchFindBestMove, acorpus + CLASS_CONTACT, 64 * nScale, 1, FALSE);
+    nPliesBench = 2;
+    RunBench("find_best_move_2ply", BenchFindBestMove, acorpus + CLASS_CONTACT, 32 * nScale, 1, FALSE);
+    nPliesBench = 3;
+    RunBench("find_best_move_3ply", BenchFindBestMove, acorpus + CLASS_CONTACT, 8 * nScale, 1, FALSE);
+    RunBench("cube_decision_2ply", BenchCubeDecision, acorpus + CLASS_CONTACT, 32 * nScale, 1, FALSE);
+    RunBench("playout_0ply", BenchPlayout, acorpus + CLASS_CONTACT, 32 * nScale, 1, FALSE);
+
+    if (szJSON && !(pf = g_fopen(szJSON, "w"))) {
+        perror(szJSON);
+        exit(EXIT_FAILURE);
+    }
+
+    WriteResults(pf, nSeed, nScale);
+
+    if (pf != stdout)
+        fclose(pf);
+
+    return 0;
+}
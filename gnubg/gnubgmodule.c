@@ -34,6 +34,7 @@
 #include "matchequity.h"
 #include "positionid.h"
 #include "matchid.h"
+#include "perf.h"
 #include "util.h"
 #include "lib/gnubg-types.h"
 #include "lib/simd.h"
@@ -1521,6 +1522,59 @@ PythonDiceRolls(PyObject * UNUSED(self), PyObject * args)
     return pyDiceRolls;
 }
 
+static PyObject *
+PythonPerformance(PyObject * UNUSED(self), PyObject * args)
+{
+    static const char *aszTimer[N_PERF_TIMERS] = { "evaluations", "movegeneration", "queuewait" };
+    perfcounters pc;
+    PyObject *pyPerf, *pyEval, *pyLookup, *pyHit, *pyTimers;
+    uint64_t cBearoff = 0;
+    double rTicksPerSecond;
+    int fReset = 0;
+    int i;
+
+    if (!PyArg_ParseTuple(args, "|i:performance", &fReset))
+        return NULL;
+
+    PerfTotals(&pc);
+    if (fReset)
+        PerfReset();
+
+    for (i = CLASS_OVER + 1; i < CLASS_RACE; i++)
+        cBearoff += pc.acEval[i];
+
+    pyEval = PyDict_New();
+    DictSetItemSteal(pyEval, "contact", PyLong_FromUnsignedLongLong(pc.acEval[CLASS_CONTACT]));
+    DictSetItemSteal(pyEval, "crashed", PyLong_FromUnsignedLongLong(pc.acEval[CLASS_CRASHED]));
+    DictSetItemSteal(pyEval, "race", PyLong_FromUnsignedLongLong(pc.acEval[CLASS_RACE]));
+    DictSetItemSteal(pyEval, "bearoff", PyLong_FromUnsignedLongLong(cBearoff));
+    DictSetItemSteal(pyEval, "over", PyLong_FromUnsignedLongLong(pc.acEval[CLASS_OVER]));
+
+    pyLookup = PyTuple_New(PERF_PLIES);
+    pyHit = PyTuple_New(PERF_PLIES);
+    for (i = 0; i < PERF_PLIES; i++) {
+        PyTuple_SET_ITEM(pyLookup, i, PyLong_FromUnsignedLongLong(pc.acLookup[i]));
+        PyTuple_SET_ITEM(pyHit, i, PyLong_FromUnsignedLongLong(pc.acHit[i]));
+    }
+
+    pyTimers = PyDict_New();
+    rTicksPerSecond = PerfTicksPerSecond();
+    for (i = 0; i < N_PERF_TIMERS; i++)
+        DictSetItemSteal(pyTimers, aszTimer[i],
+                         PyFloat_FromDouble(rTicksPerSecond > 0.0 ? (double) pc.acTicks[i] / rTicksPerSecond : 0.0));
+
+    pyPerf = PyDict_New();
+    DictSetItemSteal(pyPerf, "evaluations", pyEval);
+    DictSetItemSteal(pyPerf, "movegenerations", PyLong_FromUnsignedLongLong(pc.cGenerateMoves));
+    DictSetItemSteal(pyPerf, "cachelookups", pyLookup);
+    DictSetItemSteal(pyPerf, "cachehits", pyHit);
+    DictSetItemSteal(pyPerf, "rollouttrials", PyLong_FromUnsignedLongLong(pc.cRolloutTrials));
+    DictSetItemSteal(pyPerf, "tasks", PyLong_FromUnsignedLongLong(pc.cTasks));
+    DictSetItemSteal(pyPerf, "timers", pyTimers);
+
+    return pyPerf;
+}
+
 static PyObject *
 PythonMET(PyObject * UNUSED(self), PyObject * args)
 {
@@ -3277,6 +3331,14 @@ static PyMethodDef gnubgMethods[] = {
      "    returns: list of list n of list n (rows of pre-crawford table\n"
      "        list 2 of list n of post-crawford for player 0/player 1"}
     ,
+    {"performance", PythonPerformance, METH_VARARGS,
+     "return the counters of 'show performance'\n"
+     "    arguments: [reset = 0/1]\n"
+     "    returns: dictionary: 'evaluations'=>dictionary of counts by class,\n"
+     "        'movegenerations', 'rollouttrials', 'tasks'=>int,\n"
+     "        'cachelookups', 'cachehits'=>tuple of counts by ply,\n"
+     "        'timers'=>dictionary of seconds ('set performance on')"}
+    ,
     {"positionid", PythonPositionID, METH_VARARGS,
      "return position ID from board\n"
      "    arguments: [board] ( see 'cfevaluate' )\n" "    returns: position ID as string"}
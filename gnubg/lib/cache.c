@@ -29,54 +29,108 @@
 #if defined(USE_MULTITHREAD)
 #include "multithread.h"
 
-#if defined(__GNUC__) && ( \
-    (( __GNUC__ * 100 + __GNUC_MINOR__ >= 401 ) \
-      && (defined (__i486) || defined (__x86_64))) \
-  || (( __GNUC__ * 100 + __GNUC_MINOR__ >= 404 ) \
-      && defined (__i386))			 \
-  )
+/* Lock-free bucket access with a sequence count (seqlock).
+ *
+ * A writer moves seq from even to odd with a compare-and-swap, updates
+ * the bucket and releases it by storing the next even value. A writer
+ * that finds the bucket busy doesn't wait: the cache is only a cache,
+ * so the update is simply dropped.
+ *
+ * Readers copy the bucket and check that seq was even and unchanged
+ * across the copy, otherwise the lookup is counted as a miss. A hit in
+ * the secondary entry is also a write: the entry is promoted to primary,
+ * taking the bucket as a writer does (and not promoted if it is busy). */
 
-static inline void
-cache_lock(evalCache * pc, uint32_t k)
+#if defined(__GNUC__) && (defined(__clang__) || ( __GNUC__ * 100 + __GNUC_MINOR__ >= 407 ))
+
+static inline int
+seq_read_begin(const cacheNode * pn)
 {
-    while (__sync_lock_test_and_set(&(pc->entries[k].lock), 1))
-        while (__sync_fetch_and_add(&pc->entries[k].lock, 0))
-            __asm__ __volatile__ ("pause":::"memory");
+    return __atomic_load_n(&pn->seq, __ATOMIC_ACQUIRE);
 }
 
-static inline void
-cache_unlock(evalCache * pc, uint32_t k)
+static inline int
+seq_read_retry(const cacheNode * pn, int seq)
 {
-    __sync_lock_release(&(pc->entries[k].lock));
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&pn->seq, __ATOMIC_RELAXED) != seq;
 }
 
-#else	/* not x86 or older gcc: no suitable intrinsics */
+static inline int
+seq_write_begin(cacheNode * pn, int seq)
+{
+    if (!__atomic_compare_exchange_n(&pn->seq, &seq, seq + 1, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+        return 0;
+
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    return 1;
+}
 
 static inline void
-WaitForLock(volatile int *lock)
+seq_write_end(cacheNode * pn, int seq)
 {
-    do {
-        MT_SafeDec(lock);
-    } while (MT_SafeIncCheck(lock));
+    __atomic_store_n(&pn->seq, seq + 2, __ATOMIC_RELEASE);
 }
 
-static inline void
-cache_lock(evalCache * pc, uint32_t k)
+#else	/* no C11-style atomic builtins: GLib atomics are full barriers */
+
+static inline int
+seq_read_begin(const cacheNode * pn)
 {
-    if (MT_SafeIncCheck(&(pc->entries[k].lock)))
-        WaitForLock(&(pc->entries[k].lock));
+    return MT_SafeGet((int *) &pn->seq);
+}
+
+static inline int
+seq_read_retry(const cacheNode * pn, int seq)
+{
+    return MT_SafeGet((int *) &pn->seq) != seq;
+}
+
+static inline int
+seq_write_begin(cacheNode * pn, int seq)
+{
+    return g_atomic_int_compare_and_exchange(&pn->seq, seq, seq + 1);
 }
 
 static inline void
-cache_unlock(evalCache * pc, uint32_t k)
+seq_write_end(cacheNode * pn, int seq)
 {
-    MT_SafeDec(&(pc->entries[k].lock));
+    MT_SafeSet(&pn->seq, seq + 2);
 }
 
 #endif
 
 #endif                          /* USE_MULTITHREAD */
 
+/* buckets are allocated on cache line boundaries */
+
+static cacheNode *
+cache_alloc(size_t size)
+{
+#if defined(HAVE_POSIX_MEMALIGN)
+    void *ptr = NULL;
+
+    if (posix_memalign(&ptr, CACHE_LINE_SIZE, size) != 0)
+        return NULL;
+
+    return (cacheNode *) ptr;
+#elif defined(HAVE__ALIGNED_MALLOC)
+    return (cacheNode *) _aligned_malloc(size, CACHE_LINE_SIZE);
+#else
+    return (cacheNode *) malloc(size);
+#endif
+}
+
+static void
+cache_free(cacheNode * ptr)
+{
+#if !defined(HAVE_POSIX_MEMALIGN) && defined(HAVE__ALIGNED_MALLOC)
+    _aligned_free(ptr);
+#else
+    free(ptr);
+#endif
+}
+
 
 int
 CacheCreate(evalCache * pc, unsigned int s)
@@ -98,10 +152,14 @@ CacheCreate(evalCache * pc, unsigned int s)
     pc->size = (s < pc->size) ? 2 * s : s;
     pc->hashMask = (pc->size >> 1) - 1;
 
-    pc->entries = (cacheNode *) malloc((pc->size / 2) * sizeof(*pc->entries));
+    pc->entries = cache_alloc((pc->size / 2) * sizeof(*pc->entries));
     if (pc->entries == NULL)
         return -1;
 
+    /* before the flush below touches the pages */
+    if (pc->fnPlace && pc->nNumaNode >= 0)
+        pc->fnPlace(pc->entries, (pc->size / 2) * sizeof(*pc->entries), pc->nNumaNode);
+
     CacheFlush(pc);
     return 0;
 }
@@ -149,51 +207,54 @@ GetHashKey(uint32_t hashMask, const cacheNodeDetail * restrict e)
 uint32_t
 CacheLookupWithLocking(evalCache * restrict pc, const cacheNodeDetail * restrict e, float * restrict arOut, float * restrict arCubeful)
 {
+#if defined(USE_MULTITHREAD)
     uint32_t const l = GetHashKey(pc->hashMask, e);
+    cacheNode *pn = &pc->entries[l];
+    cacheNodeDetail nd_primary, nd_secondary;
+    const cacheNodeDetail *pnd;
+    int seq;
 
 #if CACHE_STATS
-#if defined(USE_MULTITHREAD)
     MT_SafeInc(&pc->cLookup);
-#else
-    ++pc->cLookup;
-#endif
 #endif
 
-#if defined(USE_MULTITHREAD)
-    cache_lock(pc, l);
-#endif
+    seq = seq_read_begin(pn);
+    if (seq & 1)                /* being updated */
+        return l;
 
-    if (!EqualKeys(pc->entries[l].nd_primary.key, e->key) || pc->entries[l].nd_primary.nEvalContext != e->nEvalContext) {       /* Not in primary slot */
-        if (!EqualKeys(pc->entries[l].nd_secondary.key, e->key) || pc->entries[l].nd_secondary.nEvalContext != e->nEvalContext) {       /* Cache miss */
-#if defined(USE_MULTITHREAD)
-            cache_unlock(pc, l);
-#endif
-            return l;
-        } else {                /* Found in second slot, promote "hot" entry */
-            cacheNodeDetail tmp = pc->entries[l].nd_primary;
+    nd_primary = pn->nd_primary;
+    nd_secondary = pn->nd_secondary;
 
-            pc->entries[l].nd_primary = pc->entries[l].nd_secondary;
-            pc->entries[l].nd_secondary = tmp;
+    if (seq_read_retry(pn, seq))        /* changed while we read it */
+        return l;
+
+    if (EqualKeys(nd_primary.key, e->key) && nd_primary.nEvalContext == e->nEvalContext)
+        pnd = &nd_primary;
+    else if (EqualKeys(nd_secondary.key, e->key) && nd_secondary.nEvalContext == e->nEvalContext) {
+        pnd = &nd_secondary;
+
+        /* Promote "hot" entry, unless someone else is busy with the bucket */
+        if (seq_write_begin(pn, seq)) {
+            pn->nd_primary = nd_secondary;
+            pn->nd_secondary = nd_primary;
+            seq_write_end(pn, seq);
         }
-    }
+    } else                      /* Cache miss */
+        return l;
+
     /* Cache hit */
-    memcpy(arOut, pc->entries[l].nd_primary.ar, sizeof(float) * 5 /*NUM_OUTPUTS */ );
+    memcpy(arOut, pnd->ar, sizeof(float) * 5 /*NUM_OUTPUTS */ );
     if (arCubeful)
-        *arCubeful = pc->entries[l].nd_primary.ar[5];   /* Cubeful equity stored in slot 5 */
-
-#if defined(USE_MULTITHREAD)
-    cache_unlock(pc, l);
-#endif
+        *arCubeful = pnd->ar[5];        /* Cubeful equity stored in slot 5 */
 
 #if CACHE_STATS
-#if defined(USE_MULTITHREAD)
     MT_SafeInc(&pc->cHit);
-#else
-    ++pc->cHit;
-#endif
 #endif
 
     return CACHEHIT;
+#else
+    return CacheLookupNoLocking(pc, e, arOut, arCubeful);
+#endif
 }
 
 uint32_t
@@ -231,22 +292,23 @@ void
 CacheAddWithLocking(evalCache * restrict pc, const cacheNodeDetail * restrict e, uint32_t l)
 {
 #if defined(USE_MULTITHREAD)
-    cache_lock(pc, l);
-#endif
+    cacheNode *pn = &pc->entries[l];
+    int seq = seq_read_begin(pn);
 
-    pc->entries[l].nd_secondary = pc->entries[l].nd_primary;
-    pc->entries[l].nd_primary = *e;
+    /* Drop the entry if another thread is updating the bucket */
+    if ((seq & 1) || !seq_write_begin(pn, seq))
+        return;
 
-#if defined(USE_MULTITHREAD)
-    cache_unlock(pc, l);
-#endif
+    pn->nd_secondary = pn->nd_primary;
+    pn->nd_primary = *e;
+
+    seq_write_end(pn, seq);
 
 #if CACHE_STATS
-#if defined(USE_MULTITHREAD)
     MT_SafeInc(&pc->nAdds);
-#else
-    ++pc->nAdds;
 #endif
+#else
+    CacheAddNoLocking(pc, e, l);
 #endif
 }
 
@@ -255,7 +317,7 @@ CacheAddWithLocking(evalCache * restrict pc, const cacheNodeDetail * restrict e,
 void
 CacheDestroy(const evalCache * pc)
 {
-    free(pc->entries);
+    cache_free(pc->entries);
 }
 
 void
@@ -266,11 +328,20 @@ CacheFlush(const evalCache * pc)
         pc->entries[k].nd_primary.key.data[0] = (unsigned int) -1;
         pc->entries[k].nd_secondary.key.data[0] = (unsigned int) -1;
 #if defined(USE_MULTITHREAD)
-        pc->entries[k].lock = 0;
+        pc->entries[k].seq = 0;
 #endif
     }
 }
 
+void
+CacheL1Flush(evalCacheL1 * pl1)
+{
+    unsigned int k;
+
+    for (k = 0; k < CACHE_L1_SIZE; ++k)
+        pl1->entries[k].key.data[0] = (unsigned int) -1;
+}
+
 int
 CacheResize(evalCache * pc, unsigned int cNew)
 {
@@ -27,9 +27,13 @@
 #include <stdint.h>
 #else
 typedef unsigned int uint32_t;
+typedef unsigned long long uint64_t;
 #endif
 
+#include <string.h>
+
 #include "gnubg-types.h"
+#include "positionid.h"
 
 /* Set to calculate simple cache stats */
 #define CACHE_STATS 0
@@ -40,22 +44,43 @@ typedef struct {
     float ar[6];
 } cacheNodeDetail;
 
-typedef struct {
+/* Buckets are aligned on cache lines so that threads working on
+ * neighbouring buckets don't share lines. A bucket holds two 56 byte
+ * entries and the sequence count, so it is padded to 128 bytes: two
+ * lines, not one. */
+#define CACHE_LINE_SIZE 64
+
+#if defined(_MSC_VER)
+#define CACHE_ALIGN(D) __declspec(align(CACHE_LINE_SIZE)) D
+#elif defined(__GNUC__)
+#define CACHE_ALIGN(D) D __attribute__ ((aligned(CACHE_LINE_SIZE)))
+#else
+#define CACHE_ALIGN(D) D
+#endif
+
+typedef CACHE_ALIGN(struct {
     cacheNodeDetail nd_primary;
     cacheNodeDetail nd_secondary;
 #if defined(USE_MULTITHREAD)
-    int lock;
+    /* Sequence count for lock-free access. Odd while a writer updates
+     * the bucket; readers retry or give up if it changed under them. */
+    int seq;
 #endif
-} cacheNode;
+}) cacheNode;
 
 /* name used in eval.c */
 typedef cacheNodeDetail evalcache;
 
+/* Places the cb bytes at p on a memory node before they are touched */
+typedef void (*cacheplacefunc) (void *p, size_t cb, int node);
+
 typedef struct {
     cacheNode *entries;
 
     unsigned int size;
     uint32_t hashMask;
+    int nNumaNode;              /* node for the entries, -1 for any */
+    cacheplacefunc fnPlace;     /* how to put them there, or NULL */
 
 #if CACHE_STATS
     unsigned int nAdds;
@@ -89,6 +114,110 @@ CacheAddNoLocking(evalCache * pc, const cacheNodeDetail * e, const uint32_t l)
 void CacheFlush(const evalCache * pc);
 void CacheDestroy(const evalCache * pc);
 
+/* Small direct mapped cache private to one thread, consulted before the
+ * shared cache. No locking is needed and hits don't touch shared cache
+ * lines. */
+
+#define CACHE_L1_BITS 10
+#define CACHE_L1_SIZE (1u << CACHE_L1_BITS)
+
+typedef struct {
+    cacheNodeDetail entries[CACHE_L1_SIZE];
+    int nGeneration;            /* see EvalCacheFlush() */
+    uint64_t cLookup;
+    uint64_t cHit;              /* hits in this cache */
+    uint64_t cSharedHit;        /* misses here that hit the shared cache */
+} evalCacheL1;
+
+static inline uint32_t
+CacheMix(const cacheNodeDetail * e)
+{
+    uint32_t h = (uint32_t) e->nEvalContext;
+    int i;
+
+    for (i = 0; i < 7; i++)
+        h = (h ^ e->key.data[i]) * 0x9e3779b1u;
+
+    return h;
+}
+
+static inline uint32_t
+CacheL1Index(const cacheNodeDetail * e)
+{
+    return CacheMix(e) >> (32 - CACHE_L1_BITS);
+}
+
+static inline int
+CacheL1Lookup(const evalCacheL1 * pl1, const cacheNodeDetail * e, float *arOut, float *arCubeful)
+{
+    const cacheNodeDetail *pnd = &pl1->entries[CacheL1Index(e)];
+
+    if (!EqualKeys(pnd->key, e->key) || pnd->nEvalContext != e->nEvalContext)
+        return 0;
+
+    memcpy(arOut, pnd->ar, sizeof(float) * 5 /*NUM_OUTPUTS */ );
+    if (arCubeful)
+        *arCubeful = pnd->ar[5];
+
+    return 1;
+}
+
+static inline void
+CacheL1Add(evalCacheL1 * pl1, const cacheNodeDetail * e)
+{
+    pl1->entries[CacheL1Index(e)] = *e;
+}
+
+void CacheL1Flush(evalCacheL1 * pl1);
+
+/* Transposition table of the multi-ply searches of one thread. It
+ * keeps the interior nodes of the current search only, so positions
+ * reached through different moves or rolls are searched once however
+ * busy the shared cache is. Entries are stamped with their search and
+ * starting a new one doesn't need a flush. */
+
+typedef struct {
+    cacheNodeDetail nd;
+    unsigned int nSearch;
+} transpositionEntry;
+
+typedef struct {
+    transpositionEntry *entries;
+    unsigned int cBits;         /* log2 of the number of entries */
+    unsigned int nSearch;       /* current search */
+    unsigned int nWrap;         /* times the search numbers wrapped around */
+    unsigned int cDepth;        /* searches in progress, nested */
+    uint64_t cLookup;
+    uint64_t cHit;
+} transpositionTable;
+
+static inline int
+TranspositionLookup(transpositionTable * ptt, const cacheNodeDetail * e, float *arOut, float *arCubeful)
+{
+    const transpositionEntry *pte = &ptt->entries[CacheMix(e) >> (32 - ptt->cBits)];
+
+    ++ptt->cLookup;
+
+    if (pte->nSearch != ptt->nSearch || !EqualKeys(pte->nd.key, e->key) || pte->nd.nEvalContext != e->nEvalContext)
+        return 0;
+
+    memcpy(arOut, pte->nd.ar, sizeof(float) * 5 /*NUM_OUTPUTS */ );
+    if (arCubeful)
+        *arCubeful = pte->nd.ar[5];
+
+    ++ptt->cHit;
+    return 1;
+}
+
+static inline void
+TranspositionAdd(transpositionTable * ptt, const cacheNodeDetail * e)
+{
+    transpositionEntry *pte = &ptt->entries[CacheMix(e) >> (32 - ptt->cBits)];
+
+    pte->nd = *e;
+    pte->nSearch = ptt->nSearch;
+}
+
 #if CACHE_STATS
 void CacheStats(const evalCache * pc, unsigned int *pcLookup, unsigned int *pcHit, unsigned int *pcUsed);
 #endif
@@ -19,6 +19,7 @@
  */
 
 #include "config.h"
+#include <string.h>
 #include "gnubg-types.h"
 #include "simd.h"
 #include "eval.h"
@@ -236,3 +237,78 @@ baseInputs(const TanBoard anBoard, float arInput[])
     }
 }
 #endif
+
+/* The same inputs as baseInputs(), as a sparse list: for each point, the
+ * entries of its row of inpvec[] (or inpvecb[] for the bar) that are not
+ * 0. Typically 30 to 40 of the 200 inputs. */
+
+static inline void
+SparseAdd(nnsparse * pns, unsigned int i, float r)
+{
+    pns->ai[pns->c] = (unsigned short) i;
+    pns->ar[pns->c++] = r;
+}
+
+extern void
+baseInputsSparse(const TanBoard anBoard, nnsparse * pns)
+{
+    unsigned int i, j;
+
+    pns->c = 0;
+
+    for (j = 0; j < 2; ++j) {
+        const unsigned int *board = anBoard[j];
+        const unsigned int iBase = j * 25 * 4;
+
+        /* Points */
+        for (i = 0; i < 24; i++) {
+            const unsigned int nc = board[i];
+            const unsigned int k = iBase + i * 4;
+
+            if (nc == 0)
+                continue;
+            else if (nc < 3)
+                SparseAdd(pns, k + nc - 1, 1.0f);
+            else {
+                SparseAdd(pns, k + 2, 1.0f);
+                if (nc > 3)
+                    SparseAdd(pns, k + 3, (float) (nc - 3) * 0.5f);
+            }
+        }
+
+        /* Bar */
+        {
+            const unsigned int nc = board[24];
+            const unsigned int k = iBase + 24 * 4;
+
+            for (i = 0; i < nc && i < 3; i++)
+                SparseAdd(pns, k + i, 1.0f);
+
+            if (nc > 3)
+                SparseAdd(pns, k + 3, (float) (nc - 3) * 0.5f);
+        }
+    }
+}
+
+/* Appends the non zero values of ar[], the inputs iFirst onwards. */
+
+extern void
+SparseInputsAppend(nnsparse * pns, unsigned int iFirst, const float ar[], unsigned int c)
+{
+    unsigned int i;
+
+    for (i = 0; i < c; i++)
+        if (ar[i] != 0.0f)
+            SparseAdd(pns, iFirst + i, ar[i]);
+}
+
+extern void
+SparseInputsToDense(const nnsparse * pns, float arInput[], unsigned int cInput)
+{
+    unsigned int k;
+
+    memset(arInput, 0, cInput * sizeof(float));
+
+    for (k = 0; k < pns->c; k++)
+        arInput[pns->ai[k]] = pns->ar[k];
+}
@@ -82,40 +82,28 @@ NeuralNetDestroy(neuralnet * pnn)
 
 #if !defined(USE_SIMD_INSTRUCTIONS)
 
-/* separate context for race, crashed, contact
- * -1: regular eval
- * 0: save base
- * 1: from base
- */
+/* Hidden node activation and output layer. On entry ar[] holds the
+ * weighted sums at the hidden nodes. */
 
-static inline NNEvalType
-NNevalAction(NNState * pnState)
+static void
+EvaluateOutput(const neuralnet * pnn, float ar[], float arOutput[])
 {
-    if (!pnState)
-        return NNEVAL_NONE;
+    const unsigned int cHidden = pnn->cHidden;
+    const float *prWeight = pnn->arOutputWeight;
+    unsigned int i, j;
 
-    switch (pnState->state) {
-    case NNSTATE_NONE:
-        {
-            /* incremental evaluation not useful */
-            return NNEVAL_NONE;
-        }
-    case NNSTATE_INCREMENTAL:
-        {
-            /* next call should return FROMBASE */
-            pnState->state = NNSTATE_DONE;
+    for (i = 0; i < cHidden; i++)
+        ar[i] = sigmoid(-pnn->rBetaHidden * ar[i]);
 
-            /* starting a new context; save base in the hope it will be useful */
-            return NNEVAL_SAVE;
-        }
-    case NNSTATE_DONE:
-        {
-            /* context hit!  use the previously computed base */
-            return NNEVAL_FROMBASE;
-        }
+    /* Calculate activity at output nodes */
+    for (i = 0; i < pnn->cOutput; i++) {
+        float r = pnn->arOutputThreshold[i];
+
+        for (j = 0; j < cHidden; j++)
+            r += ar[j] * *prWeight++;
+
+        arOutput[i] = sigmoid(-pnn->rBetaOutput * r);
     }
-    /* never reached */
-    return NNEVAL_NONE;         /* for the picky compiler */
 }
 
 static void
@@ -151,20 +139,7 @@ Evaluate(const neuralnet * pnn, const float arInput[], float ar[], float arOutpu
     if (saveAr)
         memcpy(saveAr, ar, cHidden * sizeof(*saveAr));
 
-    for (i = 0; i < cHidden; i++)
-        ar[i] = sigmoid(-pnn->rBetaHidden * ar[i]);
-
-    /* Calculate activity at output nodes */
-    prWeight = pnn->arOutputWeight;
-
-    for (i = 0; i < pnn->cOutput; i++) {
-        float r = pnn->arOutputThreshold[i];
-
-        for (j = 0; j < cHidden; j++)
-            r += ar[j] * *prWeight++;
-
-        arOutput[i] = sigmoid(-pnn->rBetaOutput * r);
-    }
+    EvaluateOutput(pnn, ar, arOutput);
 }
 
 static void
@@ -199,20 +174,7 @@ EvaluateFromBase(const neuralnet * pnn, const float arInputDif[], float ar[], fl
         }
     }
 
-    for (i = 0; i < pnn->cHidden; i++)
-        ar[i] = sigmoid(-pnn->rBetaHidden * ar[i]);
-
-    /* Calculate activity at output nodes */
-    prWeight = pnn->arOutputWeight;
-
-    for (i = 0; i < pnn->cOutput; i++) {
-        float r = pnn->arOutputThreshold[i];
-
-        for (j = 0; j < pnn->cHidden; j++)
-            r += ar[j] * *prWeight++;
-
-        arOutput[i] = sigmoid(-pnn->rBetaOutput * r);
-    }
+    EvaluateOutput(pnn, ar, arOutput);
 }
 
 extern int
@@ -259,6 +221,45 @@ NeuralNetEvaluate(const neuralnet * pnn, float arInput[], float arOutput[], NNSt
     }
     return 0;
 }
+
+extern int
+NeuralNetEvaluateBatch(const neuralnet * pnn, unsigned int cBatch, float *aarInput[], float *aarOutput[])
+{
+    float *ar = (float *) g_alloca(pnn->cHidden * sizeof(float));
+    unsigned int i;
+
+    for (i = 0; i < cBatch; i++)
+        Evaluate(pnn, aarInput[i], ar, aarOutput[i], 0);
+
+    return 0;
+}
+
+extern int
+NeuralNetEvaluateSparse(const neuralnet * pnn, const nnsparse * pns, float arOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    float *ar = (float *) g_alloca(cHidden * sizeof(float));
+    unsigned int j, k;
+
+    memcpy(ar, pnn->arHiddenThreshold, cHidden * sizeof(float));
+
+    for (k = 0; k < pns->c; k++) {
+        const float *prWeight = pnn->arHiddenWeight + pns->ai[k] * cHidden;
+        float const ark = pns->ar[k];
+
+        if (ark == 1.0f)
+            for (j = 0; j < cHidden; j++)
+                ar[j] += prWeight[j];
+        else
+            for (j = 0; j < cHidden; j++)
+                ar[j] += prWeight[j] * ark;
+    }
+
+    EvaluateOutput(pnn, ar, arOutput);
+
+    return 0;
+}
+
 #endif
 
 extern int
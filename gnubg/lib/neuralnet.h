@@ -53,17 +53,79 @@ typedef struct {
     NNStateType state;
     float *savedBase;
     float *savedIBase;
-#if !defined(USE_SIMD_INSTRUCTIONS)
     unsigned int cSavedIBase;
-#endif
 } NNState;
 
+/* separate context for race, crashed, contact
+ * -1: regular eval
+ * 0: save base
+ * 1: from base
+ */
+
+static inline NNEvalType
+NNevalAction(NNState * pnState)
+{
+    if (!pnState)
+        return NNEVAL_NONE;
+
+    switch (pnState->state) {
+    case NNSTATE_NONE:
+        {
+            /* incremental evaluation not useful */
+            return NNEVAL_NONE;
+        }
+    case NNSTATE_INCREMENTAL:
+        {
+            /* next call should return FROMBASE */
+            pnState->state = NNSTATE_DONE;
+
+            /* starting a new context; save base in the hope it will be useful */
+            return NNEVAL_SAVE;
+        }
+    case NNSTATE_DONE:
+        {
+            /* context hit!  use the previously computed base */
+            return NNEVAL_FROMBASE;
+        }
+    }
+    /* never reached */
+    return NNEVAL_NONE;         /* for the picky compiler */
+}
+
+/* Quantized copy of a net, see neuralnetq.c */
+typedef struct {
+    const neuralnet *pnn;       /* float net (thresholds and output layer) */
+    signed char *acHiddenWeight;
+    float *arHiddenScale;
+} neuralnetq;
+
+/* Maximum number of positions evaluated in one block by
+ * NeuralNetEvaluateBatch(). Larger batches are split. */
+#define NN_BATCH_MAX 16
+
+/* The non zero inputs of a position, in increasing index order, for
+ * NeuralNetEvaluateSparse(). Only the hidden weight rows of these inputs
+ * are read; most of the inputs of the contact, crashed and pruning nets
+ * are zero. */
+#define NN_SPARSE_MAX 256
+
+typedef struct {
+    unsigned int c;
+    unsigned short ai[NN_SPARSE_MAX];
+    float ar[NN_SPARSE_MAX];
+} nnsparse;
+
 extern void NeuralNetDestroy(neuralnet * pnn);
 #if !defined(USE_SIMD_INSTRUCTIONS)
 extern int NeuralNetEvaluate(const neuralnet * pnn, float arInput[], float arOutput[], NNState * pnState);
 #else
 extern int NeuralNetEvaluateSSE(const neuralnet * pnn, float arInput[], float arOutput[], NNState * pnState);
 #endif
+extern int NeuralNetEvaluateBatch(const neuralnet * pnn, unsigned int cBatch, float *aarInput[], float *aarOutput[]);
+extern int NeuralNetEvaluateSparse(const neuralnet * pnn, const nnsparse * pns, float arOutput[]);
+extern int NeuralNetQuantize(neuralnetq * pnq, const neuralnet * pnn);
+extern void NeuralNetQuantizedDestroy(neuralnetq * pnq);
+extern int NeuralNetEvaluateQuantized(const neuralnetq * pnq, const float arInput[], float arOutput[]);
 extern int NeuralNetLoad(neuralnet * pnn, FILE * pf);
 extern int NeuralNetLoadBinary(neuralnet * pnn, FILE * pf);
 extern int NeuralNetSaveBinary(const neuralnet * pnn, FILE * pf);
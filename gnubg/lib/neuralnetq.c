@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2024 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * $Id$
+ */
+
+/*
+ * Quantized neural net evaluation.
+ *
+ * The hidden layer weights, which are most of the net, are stored as
+ * 8 bit integers with one scale factor per hidden node. The inputs are
+ * scaled to 16 bit integers at each evaluation and the hidden sums are
+ * accumulated as 32 bit integers, two inputs at a time (the layout
+ * used by pmaddwd / vpdpwssd). The output layer is small and stays in
+ * floating point.
+ */
+
+#include "config.h"
+#include "common.h"
+#include <glib.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "neuralnet.h"
+#include "simd.h"
+#include "sigmoid.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+/* The weights for inputs 2p and 2p+1 are interleaved for each hidden
+ * node: acHiddenWeight[(p * cHidden + h) * 2 + (i & 1)] */
+
+extern int
+NeuralNetQuantize(neuralnetq * pnq, const neuralnet * pnn)
+{
+    unsigned int const cPairs = (pnn->cInput + 1) / 2;
+    unsigned int i, h;
+
+    pnq->pnn = pnn;
+    pnq->acHiddenWeight = (signed char *) sse_malloc(cPairs * 2 * pnn->cHidden);
+    if (!pnq->acHiddenWeight) {
+        pnq->arHiddenScale = NULL;
+        return -1;
+    }
+
+    pnq->arHiddenScale = (float *) g_malloc(pnn->cHidden * sizeof(float));
+
+    memset(pnq->acHiddenWeight, 0, cPairs * 2 * pnn->cHidden);
+
+    for (h = 0; h < pnn->cHidden; h++) {
+        float rMax = 0.0f;
+        float rScale;
+
+        for (i = 0; i < pnn->cInput; i++)
+            rMax = MAX(rMax, fabsf(pnn->arHiddenWeight[i * pnn->cHidden + h]));
+
+        rScale = rMax > 0.0f ? 127.0f / rMax : 0.0f;
+        pnq->arHiddenScale[h] = rMax / 127.0f;
+
+        for (i = 0; i < pnn->cInput; i++)
+            pnq->acHiddenWeight[((i / 2) * pnn->cHidden + h) * 2 + (i & 1)] =
+                (int8_t) lrintf(pnn->arHiddenWeight[i * pnn->cHidden + h] * rScale);
+    }
+
+    return 0;
+}
+
+extern void
+NeuralNetQuantizedDestroy(neuralnetq * pnq)
+{
+    sse_free((float *) pnq->acHiddenWeight);
+    g_free(pnq->arHiddenScale);
+    pnq->acHiddenWeight = NULL;
+    pnq->arHiddenScale = NULL;
+    pnq->pnn = NULL;
+}
+
+/* Accumulate the hidden sums for the input pairs in aiPair[] */
+
+static void
+AccumulateHidden(const neuralnetq * pnq, const int16_t axPair[][2], const unsigned int aiPair[],
+                 unsigned int cActive, int32_t anSum[])
+{
+    unsigned int const cHidden = pnq->pnn->cHidden;
+    unsigned int k, h;
+
+#if defined(__AVX2__)
+    if ((cHidden & 15) == 0) {
+        for (h = 0; h < cHidden; h += 16) {
+            __m256i sum0 = _mm256_setzero_si256();
+            __m256i sum1 = _mm256_setzero_si256();
+
+            for (k = 0; k < cActive; k++) {
+                const int8_t *pc = pnq->acHiddenWeight + (aiPair[k] * cHidden + h) * 2;
+                __m256i const x = _mm256_set1_epi32((int) ((uint16_t) axPair[k][0] | ((uint32_t) (uint16_t) axPair[k][1] << 16)));
+                __m256i const w0 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *) pc));
+                __m256i const w1 = _mm256_cvtepi8_epi16(_mm_loadu_si128((const __m128i *) (pc + 16)));
+
+#if defined(__AVXVNNI__)
+                sum0 = _mm256_dpwssd_avx_epi32(sum0, w0, x);
+                sum1 = _mm256_dpwssd_avx_epi32(sum1, w1, x);
+#elif defined(__AVX512VNNI__) && defined(__AVX512VL__)
+                sum0 = _mm256_dpwssd_epi32(sum0, w0, x);
+                sum1 = _mm256_dpwssd_epi32(sum1, w1, x);
+#else
+                sum0 = _mm256_add_epi32(sum0, _mm256_madd_epi16(w0, x));
+                sum1 = _mm256_add_epi32(sum1, _mm256_madd_epi16(w1, x));
+#endif
+            }
+            _mm256_storeu_si256((__m256i *) (anSum + h), sum0);
+            _mm256_storeu_si256((__m256i *) (anSum + h + 8), sum1);
+        }
+        return;
+    }
+#endif
+
+    memset(anSum, 0, cHidden * sizeof(int32_t));
+
+    for (k = 0; k < cActive; k++) {
+        const int8_t *pc = pnq->acHiddenWeight + aiPair[k] * cHidden * 2;
+        int32_t const x0 = axPair[k][0];
+        int32_t const x1 = axPair[k][1];
+
+        for (h = 0; h < cHidden; h++, pc += 2)
+            anSum[h] += x0 * pc[0] + x1 * pc[1];
+    }
+}
+
+extern int
+NeuralNetEvaluateQuantized(const neuralnetq * pnq, const float arInput[], float arOutput[])
+{
+    const neuralnet *pnn = pnq->pnn;
+    unsigned int const cHidden = pnn->cHidden;
+    unsigned int const cPairs = (pnn->cInput + 1) / 2;
+    int16_t(*axPair)[2] = g_alloca(cPairs * sizeof(*axPair));
+    unsigned int *aiPair = g_alloca(cPairs * sizeof(unsigned int));
+    int32_t *anSum = g_alloca(cHidden * sizeof(int32_t));
+    float *ar = g_alloca(cHidden * sizeof(float));
+    unsigned int i, j, cActive = 0;
+    float rMax = 0.0f, rScale, rInvScale;
+    const float *prWeight;
+
+    /* scale the inputs to the full 16 bit range */
+    for (i = 0; i < pnn->cInput; i++)
+        rMax = MAX(rMax, fabsf(arInput[i]));
+
+    rScale = rMax > 0.0f ? 32767.0f / rMax : 0.0f;
+    rInvScale = rMax / 32767.0f;
+
+    for (i = 0; i < cPairs; i++) {
+        float const r0 = arInput[2 * i];
+        float const r1 = 2 * i + 1 < pnn->cInput ? arInput[2 * i + 1] : 0.0f;
+
+        /* most inputs are zero: only keep the active pairs */
+        if (r0 == 0.0f && r1 == 0.0f)
+            continue;
+
+        axPair[cActive][0] = (int16_t) lrintf(r0 * rScale);
+        axPair[cActive][1] = (int16_t) lrintf(r1 * rScale);
+        aiPair[cActive++] = i;
+    }
+
+    AccumulateHidden(pnq, (const int16_t(*)[2]) axPair, aiPair, cActive, anSum);
+
+    for (i = 0; i < cHidden; i++) {
+        float const r = pnn->arHiddenThreshold[i] + (float) anSum[i] * rInvScale * pnq->arHiddenScale[i];
+
+        ar[i] = sigmoid(-pnn->rBetaHidden * r);
+    }
+
+    /* Calculate activity at output nodes */
+    prWeight = pnn->arOutputWeight;
+
+    for (i = 0; i < pnn->cOutput; i++) {
+        float r = pnn->arOutputThreshold[i];
+
+        for (j = 0; j < cHidden; j++)
+            r += ar[j] * *prWeight++;
+
+        arOutput[i] = sigmoid(-pnn->rBetaOutput * r);
+    }
+
+    return 0;
+}
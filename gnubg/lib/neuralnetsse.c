@@ -325,14 +325,37 @@ for (j = (cHidden >> LOG2VEC_SIZE); j; j--, pr += VEC_SIZE, prWeight += VEC_SIZE
 }
 #endif
 
+/* Single vector operations used by the batched evaluation */
+#if defined(USE_AVX)
+#define VEC_LOAD(p) _mm256_load_ps(p)
+#define VEC_STORE(p, v) _mm256_store_ps(p, v)
+#define VEC_SET1(r) _mm256_set1_ps(r)
+#if defined(USE_FMA3)
+#define VEC_MULADD(a, b, c) _mm256_fmadd_ps(a, b, c)
+#else
+#define VEC_MULADD(a, b, c) _mm256_add_ps(c, _mm256_mul_ps(a, b))
+#endif
+#elif defined(USE_SSE2)
+#define VEC_LOAD(p) _mm_load_ps(p)
+#define VEC_STORE(p, v) _mm_store_ps(p, v)
+#define VEC_SET1(r) _mm_set1_ps(r)
+#define VEC_MULADD(a, b, c) _mm_add_ps(c, _mm_mul_ps(a, b))
+#elif defined(USE_NEON)
+#define VEC_LOAD(p) vld1q_f32(p)
+#define VEC_STORE(p, v) vst1q_f32(p, v)
+#define VEC_SET1(r) vdupq_n_f32(r)
+#define VEC_MULADD(a, b, c) vaddq_f32(c, vmulq_f32(a, b))
+#endif
+
+static void EvaluateOutputSSE(const neuralnet * restrict pnn, float ar[], float arOutput[]);
+
 static void
-EvaluateSSE(const neuralnet * restrict pnn, const float arInput[], float ar[], float arOutput[])
+EvaluateSSE(const neuralnet * restrict pnn, const float arInput[], float ar[], float arOutput[], float *saveAr)
 {
     const unsigned int cHidden = pnn->cHidden;
     unsigned int i, j;
     float *prWeight;
 #if defined(USE_SSE2) || defined(USE_AVX) || defined(USE_NEON)
-    float *par;
 #if defined(USE_FMA3)
     float_vector vec0, vec1, scalevec, sum;
 #else
@@ -458,6 +481,30 @@ EvaluateSSE(const neuralnet * restrict pnn, const float arInput[], float ar[], f
             }
         }
 
+    if (saveAr)
+        memcpy(saveAr, ar, cHidden * sizeof(*saveAr));
+
+    EvaluateOutputSSE(pnn, ar, arOutput);
+}
+
+/* Hidden node activation and output layer. On entry ar[] holds the
+ * weighted sums at the hidden nodes. */
+
+static void
+EvaluateOutputSSE(const neuralnet * restrict pnn, float ar[], float arOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    unsigned int i, j;
+    float *prWeight;
+#if defined(USE_SSE2) || defined(USE_AVX) || defined(USE_NEON)
+    float *par;
+#if defined(USE_FMA3)
+    float_vector vec0, vec1, scalevec, sum;
+#else
+    float_vector vec0, vec1, vec3, scalevec, sum;
+#endif
+#endif
+
 #if defined(USE_SSE2) || defined(USE_AVX) || defined(USE_NEON)
 #if defined(USE_AVX)
     scalevec = _mm256_set1_ps(pnn->rBetaHidden);
@@ -565,10 +612,184 @@ EvaluateSSE(const neuralnet * restrict pnn, const float arInput[], float ar[], f
 #endif
 }
 
+#if defined(USE_SSE2) || defined(USE_AVX) || defined(USE_NEON)
+
+/* Incremental evaluation: on entry ar[] holds the hidden node sums for
+ * the inputs arInputBase[]; only the inputs that differ are added. */
+
+static void
+EvaluateFromBaseSSE(const neuralnet * restrict pnn, const float arInput[], const float arInputBase[], float ar[],
+                    float arOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    const float *prWeight = pnn->arHiddenWeight;
+    unsigned int i, j;
+
+    for (i = 0; i < pnn->cInput; i++, prWeight += cHidden) {
+        float const ari = arInput[i] - arInputBase[i];
+
+        if (likely(ari == 0.0f))
+            continue;
+
+        {
+            float_vector const scalevec = VEC_SET1(ari);
+
+            for (j = 0; j < cHidden; j += VEC_SIZE)
+                VEC_STORE(ar + j, VEC_MULADD(VEC_LOAD(prWeight + j), scalevec, VEC_LOAD(ar + j)));
+        }
+    }
+
+    EvaluateOutputSSE(pnn, ar, arOutput);
+}
+
+/* Evaluate up to NN_BATCH_MAX positions together. Each vector of
+ * hidden weights is loaded once and accumulated into the hidden sums
+ * of all positions of the block that need it, so the weight matrix
+ * goes through the cache once per block instead of once per position.
+ *
+ * Every row starts from the thresholds and adds its own active inputs
+ * in increasing order, with the same operations as EvaluateSSE(), so a
+ * position gets exactly the same output as when evaluated on its own,
+ * whatever the other positions of the block. ar[] holds cBatch rows of
+ * cHidden sums. */
+
+static void
+EvaluateBatchSSE(const neuralnet * restrict pnn, unsigned int cBatch, float *aarInput[], float ar[],
+                 float *aarOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    const float *prWeight = pnn->arHiddenWeight;
+    unsigned int ai[NN_BATCH_MAX];
+    float arScale[NN_BATCH_MAX];
+    unsigned int i, j, k, n;
+
+    for (k = 0; k < cBatch; k++)
+        memcpy(ar + k * cHidden, pnn->arHiddenThreshold, cHidden * sizeof(float));
+
+    for (i = 0; i < pnn->cInput; i++, prWeight += cHidden) {
+        /* rows where this input is active */
+        n = 0;
+        for (k = 0; k < cBatch; k++)
+            if (aarInput[k][i] != 0.0f) {
+                ai[n] = k;
+                arScale[n++] = aarInput[k][i];
+            }
+
+        if (n == 0)
+            continue;
+
+        for (j = 0; j < cHidden; j += VEC_SIZE) {
+            float_vector const w = VEC_LOAD(prWeight + j);
+
+            for (k = 0; k < n; k++) {
+                float *pr = ar + ai[k] * cHidden + j;
+
+                VEC_STORE(pr, VEC_MULADD(w, VEC_SET1(arScale[k]), VEC_LOAD(pr)));
+            }
+        }
+    }
+
+    for (k = 0; k < cBatch; k++)
+        EvaluateOutputSSE(pnn, ar + k * cHidden, aarOutput[k]);
+}
+
+/* Evaluation from the active inputs only. The hidden node sums are kept
+ * in registers, SPARSE_BLOCK vectors at a time, while the weight rows of
+ * all the active inputs are added, so each sum is stored once instead of
+ * once per input. The rows are added in the same order, and with the same
+ * operations, as in EvaluateSSE(), so the results are identical. */
+
+#define SPARSE_BLOCK 4
+
+static void
+EvaluateSparseSSE(const neuralnet * restrict pnn, const nnsparse * pns, float ar[], float arOutput[])
+{
+    const unsigned int cHidden = pnn->cHidden;
+    const unsigned int cBlock = cHidden & ~(SPARSE_BLOCK * VEC_SIZE - 1);
+    const float *prThreshold = pnn->arHiddenThreshold;
+    unsigned int j, k;
+
+    for (j = 0; j < cBlock; j += SPARSE_BLOCK * VEC_SIZE) {
+        const float *prWeight = pnn->arHiddenWeight + j;
+        float_vector s0 = VEC_LOAD(prThreshold + j);
+        float_vector s1 = VEC_LOAD(prThreshold + j + VEC_SIZE);
+        float_vector s2 = VEC_LOAD(prThreshold + j + 2 * VEC_SIZE);
+        float_vector s3 = VEC_LOAD(prThreshold + j + 3 * VEC_SIZE);
+
+        for (k = 0; k < pns->c; k++) {
+            const float *pr = prWeight + pns->ai[k] * cHidden;
+            float_vector const scalevec = VEC_SET1(pns->ar[k]);
+
+            s0 = VEC_MULADD(VEC_LOAD(pr), scalevec, s0);
+            s1 = VEC_MULADD(VEC_LOAD(pr + VEC_SIZE), scalevec, s1);
+            s2 = VEC_MULADD(VEC_LOAD(pr + 2 * VEC_SIZE), scalevec, s2);
+            s3 = VEC_MULADD(VEC_LOAD(pr + 3 * VEC_SIZE), scalevec, s3);
+        }
+
+        VEC_STORE(ar + j, s0);
+        VEC_STORE(ar + j + VEC_SIZE, s1);
+        VEC_STORE(ar + j + 2 * VEC_SIZE, s2);
+        VEC_STORE(ar + j + 3 * VEC_SIZE, s3);
+    }
+
+    for (; j < cHidden; j += VEC_SIZE) {
+        float_vector sum = VEC_LOAD(prThreshold + j);
+
+        for (k = 0; k < pns->c; k++)
+            sum = VEC_MULADD(VEC_LOAD(pnn->arHiddenWeight + pns->ai[k] * cHidden + j), VEC_SET1(pns->ar[k]), sum);
+
+        VEC_STORE(ar + j, sum);
+    }
+
+    EvaluateOutputSSE(pnn, ar, arOutput);
+}
+
+#endif
+
+extern int
+NeuralNetEvaluateSparse(const neuralnet * restrict pnn, const nnsparse * pns, float arOutput[])
+{
+    SSE_ALIGN(float ar[pnn->cHidden]);
+
+#if defined(USE_SSE2) || defined(USE_AVX) || defined(USE_NEON)
+    EvaluateSparseSSE(pnn, pns, ar, arOutput);
+#else
+    SSE_ALIGN(float arInput[pnn->cInput]);
+    unsigned int k;
+
+    memset(arInput, 0, pnn->cInput * sizeof(float));
+    for (k = 0; k < pns->c; k++)
+        arInput[pns->ai[k]] = pns->ar[k];
+
+    EvaluateSSE(pnn, arInput, ar, arOutput, NULL);
+#endif
+
+    return 0;
+}
+
+extern int
+NeuralNetEvaluateBatch(const neuralnet * restrict pnn, unsigned int cBatch, float *aarInput[], float *aarOutput[])
+{
+#if defined(USE_SSE2) || defined(USE_AVX) || defined(USE_NEON)
+    SSE_ALIGN(float ar[NN_BATCH_MAX * pnn->cHidden]);
+    unsigned int i;
+
+    for (i = 0; i < cBatch; i += NN_BATCH_MAX)
+        EvaluateBatchSSE(pnn, MIN(cBatch - i, NN_BATCH_MAX), aarInput + i, ar, aarOutput + i);
+#else
+    SSE_ALIGN(float ar[pnn->cHidden]);
+    unsigned int i;
+
+    for (i = 0; i < cBatch; i++)
+        EvaluateSSE(pnn, aarInput[i], ar, aarOutput[i], NULL);
+#endif
+
+    return 0;
+}
 
 extern int
 NeuralNetEvaluateSSE(const neuralnet * restrict pnn, /*lint -e{818} */ float arInput[],
-                     float arOutput[], NNState * UNUSED(pnState))
+                     float arOutput[], NNState * pnState)
 {
     SSE_ALIGN(float ar[pnn->cHidden]);
 
@@ -578,7 +799,30 @@ NeuralNetEvaluateSSE(const neuralnet * restrict pnn, /*lint -e{818} */ float arI
     g_assert(sse_aligned(arInput));
 #endif
 
-    EvaluateSSE(pnn, arInput, ar, arOutput);
+#if defined(USE_SSE2) || defined(USE_AVX) || defined(USE_NEON)
+    switch (NNevalAction(pnState)) {
+    case NNEVAL_NONE:
+        EvaluateSSE(pnn, arInput, ar, arOutput, NULL);
+        break;
+    case NNEVAL_SAVE:
+        pnState->cSavedIBase = pnn->cInput;
+        memcpy(pnState->savedIBase, arInput, pnn->cInput * sizeof(float));
+        EvaluateSSE(pnn, arInput, ar, arOutput, pnState->savedBase);
+        break;
+    case NNEVAL_FROMBASE:
+        if (pnState->cSavedIBase != pnn->cInput) {
+            EvaluateSSE(pnn, arInput, ar, arOutput, NULL);
+            break;
+        }
+        memcpy(ar, pnState->savedBase, pnn->cHidden * sizeof(float));
+        EvaluateFromBaseSSE(pnn, arInput, pnState->savedIBase, ar, arOutput);
+        break;
+    }
+#else
+    (void) pnState;
+    EvaluateSSE(pnn, arInput, ar, arOutput, NULL);
+#endif
+
     return 0;
 }
 
@@ -30,6 +30,10 @@
 #include <stdio.h>
 #endif
 #include <string.h>
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
 
 #include "lib/simd.h"
 
@@ -61,6 +65,12 @@ MT_CreateThreadLocalData(int id)
 
     tld->aMoves = (move *) g_malloc(sizeof(move) * MAX_INCOMPLETE_MOVES);
     memset(tld->aMoves, 0, sizeof(move) * MAX_INCOMPLETE_MOVES);
+
+    tld->pCacheL1 = EvalCacheL1(id);
+    tld->pTT = EvalTranspositions(id);
+    tld->pPerf = PerfCounters(id);
+    tld->pArena = ArenaNew();
+    tld->nNumaNode = 0;         /* set by the thread itself */
     return tld;
 }
 
@@ -72,8 +82,10 @@ unsigned int mainThreadID;
 
 #if GLIB_CHECK_VERSION (2,32,0)
 static GMutex condMutex;        /* Extra mutex needed for waiting */
+static GCond groupCond;         /* signalled when a task group completes */
 #else
 static GMutex *condMutex = NULL;        /* Extra mutex needed for waiting */
+static GCond *groupCond = NULL; /* signalled when a task group completes */
 #endif
 
 #if GLIB_CHECK_VERSION (2,32,0)
@@ -204,6 +216,40 @@ SetManualEvent(ManualEvent ME)
     multi_debug("reset manual event unlocks (condMutex)");
 }
 
+/* Block until the pending count of a task group drops to zero. The
+ * count is decremented before SignalGroupDone() takes condMutex, so
+ * checking it under the mutex can't miss the wake up. */
+
+extern void
+WaitForGroupDone(const int *pPending)
+{
+#if GLIB_CHECK_VERSION (2,32,0)
+    g_mutex_lock(&condMutex);
+    while (g_atomic_int_get(pPending) > 0)
+        g_cond_wait(&groupCond, &condMutex);
+    g_mutex_unlock(&condMutex);
+#else
+    g_mutex_lock(condMutex);
+    while (g_atomic_int_get(pPending) > 0)
+        g_cond_wait(groupCond, condMutex);
+    g_mutex_unlock(condMutex);
+#endif
+}
+
+extern void
+SignalGroupDone(void)
+{
+#if GLIB_CHECK_VERSION (2,32,0)
+    g_mutex_lock(&condMutex);
+    g_cond_broadcast(&groupCond);
+    g_mutex_unlock(&condMutex);
+#else
+    g_mutex_lock(condMutex);
+    g_cond_broadcast(groupCond);
+    g_mutex_unlock(condMutex);
+#endif
+}
+
 #if GLIB_CHECK_VERSION (2,32,0)
 extern void
 InitMutex(Mutex * pMutex)
@@ -255,6 +301,8 @@ Mutex_Release(Mutex * mutex)
 extern void
 MT_InitThreads(void)
 {
+    unsigned int i;
+
 #if !GLIB_CHECK_VERSION (2,32,0)
     if (!g_thread_supported())
         g_thread_init(NULL);
@@ -267,17 +315,26 @@ MT_InitThreads(void)
     InitManualEvent(&td.activity);
     TLSCreate(&td.tlsItem);
     TLSSetValue(td.tlsItem, (size_t) MT_CreateThreadLocalData(-1));
+    MT_GetTLD()->nNumaNode = MT_GetNumaNode();
 
 #if defined(DEBUG_MULTITHREADED) && defined(WIN32)
     mainThreadID = GetCurrentThreadId();
 #endif
     InitMutex(&td.multiLock);
     InitMutex(&td.queueLock);
+    td.queues = g_new0(TaskQueue, MAX_NUMTHREADS);
+    for (i = 0; i < MAX_NUMTHREADS; i++)
+        InitMutex(&td.queues[i].lock);
+    MT_SafeSet(&td.queuedTasks, 0);
+    MT_SafeSet(&td.busyThreads, 0);
+    MT_SafeSet(&td.nextQueue, 0);
     InitManualEvent(&td.syncStart);
     InitManualEvent(&td.syncEnd);
 #if !GLIB_CHECK_VERSION (2,32,0)
     if (condMutex == NULL)
         condMutex = g_mutex_new();
+    if (groupCond == NULL)
+        groupCond = g_cond_new();
 #endif
     td.numThreads = 0;
 }
@@ -294,6 +351,7 @@ CloseThread(void *UNUSED(unused))
     pnnState = pTLD->pnnState;
 
     g_free(pTLD->aMoves);
+    ArenaFree(pTLD->pArena);
 
     for (int i = 0; i < 3; i++) {
         g_free(pnnState[i].savedBase);
@@ -309,16 +367,102 @@ CloseThread(void *UNUSED(unused))
 extern void
 MT_Close(void)
 {
+    unsigned int i;
+
     MT_CloseThreads();
 
     FreeManualEvent(td.activity);
     FreeMutex(&td.multiLock);
     FreeMutex(&td.queueLock);
+    for (i = 0; i < MAX_NUMTHREADS; i++) {
+        FreeMutex(&td.queues[i].lock);
+        g_free(td.queues[i].aTasks);
+    }
+    g_free(td.queues);
 
     FreeManualEvent(td.syncStart);
     FreeManualEvent(td.syncEnd);
 }
 
+/* Number of NUMA nodes of the machine, 1 if unknown */
+
+extern unsigned int
+MT_GetNumaNodes(void)
+{
+    static unsigned int cNodes = 0;
+
+    if (!cNodes) {
+#if defined(WIN32)
+        ULONG ulHighest;
+
+        cNodes = GetNumaHighestNodeNumber(&ulHighest) ? (unsigned int) ulHighest + 1 : 1;
+#elif defined(__linux__)
+        GDir *dir = g_dir_open("/sys/devices/system/node", 0, NULL);
+        const char *szName;
+
+        if (dir) {
+            while ((szName = g_dir_read_name(dir)))
+                if (g_str_has_prefix(szName, "node") && g_ascii_isdigit(szName[4]))
+                    cNodes++;
+            g_dir_close(dir);
+        }
+#endif
+        if (!cNodes)
+            cNodes = 1;
+    }
+
+    return cNodes;
+}
+
+/* NUMA node of the processor the calling thread is running on */
+
+extern int
+MT_GetNumaNode(void)
+{
+#if defined(WIN32)
+    UCHAR node;
+
+    if (GetNumaProcessorNode((UCHAR) GetCurrentProcessorNumber(), &node))
+        return node;
+#elif defined(__linux__) && defined(SYS_getcpu)
+    unsigned int cpu, node;
+
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) == 0)
+        return (int) node;
+#endif
+    return 0;
+}
+
+/* Have the pages of a block of memory not touched yet placed on a given
+ * node when they are. Only the whole pages inside the block are bound,
+ * and this is only a preference: when the node is out of memory other
+ * nodes are used. Elsewhere than on Linux the pages go to the node of the
+ * thread first touching them. */
+
+extern void
+MT_BindToNumaNode(void *p, size_t cb, int node)
+{
+#if defined(__linux__) && defined(SYS_mbind)
+    uintptr_t const cbPage = (uintptr_t) sysconf(_SC_PAGESIZE);
+    uintptr_t const start = ((uintptr_t) p + cbPage - 1) & ~(cbPage - 1);
+    uintptr_t const end = ((uintptr_t) p + cb) & ~(cbPage - 1);
+    unsigned long mask;
+
+    if (node < 0 || node >= (int) (8 * sizeof(mask)) || end <= start)
+        return;
+
+    mask = 1UL << node;
+    /* 1 is MPOL_PREFERRED; the kernel reads maxnode - 1 bits of mask */
+    if (syscall(SYS_mbind, start, end - start, 1, &mask, 8 * sizeof(mask) + 1, 0) != 0) {
+        multi_debug("mbind failed");
+    }
+#else
+    (void) p;
+    (void) cb;
+    (void) node;
+#endif
+}
+
 extern void
 MT_Exclusive(void)
 {
@@ -403,6 +547,7 @@ MT_Close(void)
         return;
 
     g_free(td.tld->aMoves);
+    ArenaFree(td.tld->pArena);
     pnnState = td.tld->pnnState;
     for (i = 0; i < 3; i++) {
         g_free(pnnState[i].savedBase);
@@ -47,6 +47,21 @@ MT_GetNumThreads(void)
     return td.numThreads;
 }
 
+/* Worker threads with nothing to do, now and for the tasks already
+ * queued */
+
+extern int
+MT_GetIdleThreads(void)
+{
+    int c = (int) td.numThreads - MT_SafeGet(&td.busyThreads) - MT_SafeGet(&td.queuedTasks);
+
+    /* a single worker only takes over what the caller would do itself */
+    if (td.numThreads < 2)
+        return 0;
+
+    return MAX(c, 0);
+}
+
 extern void
 MT_CloseThreads(void)
 {
@@ -63,33 +78,138 @@ MT_CloseThreads(void)
 static void
 MT_TaskDone(Task * pt)
 {
-    MT_SafeInc(&td.doneTasks);
+    TaskGroup *ptg = pt ? pt->ptg : NULL;
 
     if (pt) {
         free(pt->pLinkedTask);
         g_free(pt);
     }
+
+    if (ptg) {
+        if (MT_SafeDecCheck(&ptg->pending))
+            SignalGroupDone();
+    } else
+        MT_SafeInc(&td.doneTasks);
+}
+
+static void
+MT_QueuePush(TaskQueue * pq, Task * pt)
+{
+    Mutex_Lock(&pq->lock);
+
+    if (pq->tail - pq->head == pq->size) {
+        /* full (or not yet allocated): double the ring buffer */
+        unsigned int size = pq->size ? 2 * pq->size : 64;
+        Task **aTasks = g_malloc(size * sizeof(Task *));
+        unsigned int i;
+
+        for (i = pq->head; i != pq->tail; i++)
+            aTasks[i & (size - 1)] = pq->aTasks[i & (pq->size - 1)];
+
+        g_free(pq->aTasks);
+        pq->aTasks = aTasks;
+        pq->size = size;
+    }
+
+    pq->aTasks[pq->tail++ & (pq->size - 1)] = pt;
+
+    Mutex_Release(&pq->lock);
 }
 
 static Task *
-MT_GetTask(void)
+MT_QueuePop(TaskQueue * pq, gboolean fNewest)
 {
     Task *task = NULL;
 
-    multi_debug("get task asks lock (queueLock)");
-    Mutex_Lock(&td.queueLock);
-    multi_debug("get task gets lock (queueLock)");
+    Mutex_Lock(&pq->lock);
 
-    if (g_list_length(td.tasks) > 0) {
-        task = (Task *) g_list_first(td.tasks)->data;
-        td.tasks = g_list_delete_link(td.tasks, g_list_first(td.tasks));
-        if (g_list_length(td.tasks) == 0) {
-            ResetManualEvent(td.activity);
-        }
+    if (pq->tail != pq->head) {
+        if (fNewest)
+            task = pq->aTasks[--pq->tail & (pq->size - 1)];
+        else
+            task = pq->aTasks[pq->head++ & (pq->size - 1)];
+    }
+
+    Mutex_Release(&pq->lock);
+
+    return task;
+}
+
+/* Queue a task: a worker thread keeps the tasks it spawns itself, other
+ * threads hand them out to the workers in turn */
+
+static void
+MT_QueueTask(Task * pt)
+{
+    int id = MT_GetThreadID();
+
+    if (id < 0 || id >= (int) td.numThreads)
+        id = (int) ((unsigned int) MT_SafeIncCheck(&td.nextQueue) % td.numThreads);
+
+    MT_QueuePush(&td.queues[id], pt);
+
+    if (MT_SafeIncCheck(&td.queuedTasks) == 0) {
+        /* New tasks: wake up idle threads */
+        Mutex_Lock(&td.queueLock);
+        SetManualEvent(td.activity);
+        Mutex_Release(&td.queueLock);
     }
+}
+
+/* Take the newest task of group ptg out of a queue */
+
+static Task *
+MT_QueueTakeGroup(TaskQueue * pq, const TaskGroup * ptg)
+{
+    Task *task = NULL;
+    unsigned int i;
+
+    Mutex_Lock(&pq->lock);
+
+    for (i = pq->tail; i != pq->head; i--)
+        if (pq->aTasks[(i - 1) & (pq->size - 1)]->ptg == ptg) {
+            task = pq->aTasks[(i - 1) & (pq->size - 1)];
+            for (; i != pq->tail; i++)
+                pq->aTasks[(i - 1) & (pq->size - 1)] = pq->aTasks[i & (pq->size - 1)];
+            pq->tail--;
+            break;
+        }
+
+    Mutex_Release(&pq->lock);
+
+    return task;
+}
+
+/* Get a task from the calling thread's own queue (the oldest one, or
+ * the newest when waiting for subtasks) or else steal the oldest task
+ * of another thread */
+
+static Task *
+MT_GetTask(gboolean fNewest)
+{
+    Task *task = NULL;
+    int id = MT_GetThreadID();
+    unsigned int i;
+
+    if (id >= 0 && id < (int) td.numThreads)
+        task = MT_QueuePop(&td.queues[id], fNewest);
+
+    for (i = 1; !task && i <= td.numThreads; i++)
+        task = MT_QueuePop(&td.queues[((unsigned int) (id + (int) i)) % td.numThreads], FALSE);
+
+    if (task)
+        MT_SafeDec(&td.queuedTasks);
+    else {
+        multi_debug("get task asks lock (queueLock)");
+        Mutex_Lock(&td.queueLock);
+        multi_debug("get task gets lock (queueLock)");
 
-    Mutex_Release(&td.queueLock);
-    multi_debug("get task unlocks (queueLock)");
+        if (MT_SafeGet(&td.queuedTasks) == 0)
+            ResetManualEvent(td.activity);
+
+        Mutex_Release(&td.queueLock);
+        multi_debug("get task unlocks (queueLock)");
+    }
 
     return task;
 }
@@ -98,9 +218,13 @@ extern void
 MT_AbortTasks(void)
 {
     Task *task;
-    /* Remove tasks from list */
-    while ((task = MT_GetTask()) != NULL)
+    /* Remove tasks from list; the groups they belong to find out in
+     * MT_WaitForGroup() */
+    while ((task = MT_GetTask(FALSE)) != NULL) {
+        if (task->ptg)
+            MT_SafeSet(&task->ptg->fAborted, TRUE);
         MT_TaskDone(task);
+    }
 
     MT_SafeSet(&td.result, -1);
 }
@@ -125,16 +249,26 @@ MT_WorkerThreadFunction(void *tld)
 #endif
     {
         ThreadLocalData *pTLD = (ThreadLocalData *) tld;
+        uint64_t tWait;
+
         TLSSetValue(td.tlsItem, (size_t) pTLD);
+        pTLD->nNumaNode = MT_GetNumaNode();
 
         MT_SafeInc(&td.result);
         MT_TaskDone(NULL);      /* Thread created */
+
         do {
             Task *task;
             WaitForManualEvent(td.activity);
-            task = MT_GetTask();
+            /* from here on tasks are pending: the time before was idle */
+            tWait = PerfStart();
+            task = MT_GetTask(FALSE);
             if (task) {
+                PerfStop(pTLD->pPerf, PERF_TIMER_QUEUE_WAIT, tWait);
+                pTLD->pPerf->cTasks++;
+                MT_SafeInc(&td.busyThreads);
                 task->fun(task->data);
+                MT_SafeDec(&td.busyThreads);
                 MT_TaskDone(task);
             }
         } while (MT_SafeCompare(&td.closingThreads, FALSE));
@@ -192,6 +326,32 @@ MT_CreateThreads(void)
         g_print(_("Error creating threads!\n"));
 }
 
+static void
+SetEvaluators(unsigned int num)
+{
+    if (num == 1) {             /* No locking in evals */
+        EvaluatePosition = EvaluatePositionNoLocking;
+        GeneralCubeDecisionE = GeneralCubeDecisionENoLocking;
+        GeneralEvaluationE = GeneralEvaluationENoLocking;
+        ScoreMove = ScoreMoveNoLocking;
+        FindBestMove = FindBestMoveNoLocking;
+        FindnSaveBestMoves = FindnSaveBestMovesNoLocking;
+        FindnSaveBestMovesArena = FindnSaveBestMovesArenaNoLocking;
+        EvaluateMovesAhead = EvaluateMovesAheadNoLocking;
+        BasicCubefulRollout = BasicCubefulRolloutNoLocking;
+    } else {                    /* Locking version of evals */
+        EvaluatePosition = EvaluatePositionWithLocking;
+        GeneralCubeDecisionE = GeneralCubeDecisionEWithLocking;
+        GeneralEvaluationE = GeneralEvaluationEWithLocking;
+        ScoreMove = ScoreMoveWithLocking;
+        FindBestMove = FindBestMoveWithLocking;
+        FindnSaveBestMoves = FindnSaveBestMovesWithLocking;
+        FindnSaveBestMovesArena = FindnSaveBestMovesArenaWithLocking;
+        EvaluateMovesAhead = EvaluateMovesAheadWithLocking;
+        BasicCubefulRollout = BasicCubefulRolloutWithLocking;
+    }
+}
+
 void
 MT_SetNumThreads(unsigned int num)
 {
@@ -200,24 +360,30 @@ MT_SetNumThreads(unsigned int num)
             MT_CloseThreads();
         td.numThreads = num;
         MT_CreateThreads();
-        if (num == 1) {         /* No locking in evals */
-            EvaluatePosition = EvaluatePositionNoLocking;
-            GeneralCubeDecisionE = GeneralCubeDecisionENoLocking;
-            GeneralEvaluationE = GeneralEvaluationENoLocking;
-            ScoreMove = ScoreMoveNoLocking;
-            FindBestMove = FindBestMoveNoLocking;
-            FindnSaveBestMoves = FindnSaveBestMovesNoLocking;
-            BasicCubefulRollout = BasicCubefulRolloutNoLocking;
-        } else {                /* Locking version of evals */
-            EvaluatePosition = EvaluatePositionWithLocking;
-            GeneralCubeDecisionE = GeneralCubeDecisionEWithLocking;
-            GeneralEvaluationE = GeneralEvaluationEWithLocking;
-            ScoreMove = ScoreMoveWithLocking;
-            FindBestMove = FindBestMoveWithLocking;
-            FindnSaveBestMoves = FindnSaveBestMovesWithLocking;
-            BasicCubefulRollout = BasicCubefulRolloutWithLocking;
-        }
+        SetEvaluators(num);
+    }
+}
+
+/* In a child process created by fork() only the calling thread is left
+ * and the locks may have been held by the others: reset them. With no
+ * workers to run them, nothing may be queued either, so the child
+ * evaluates as a single thread. */
+extern void
+MT_AfterFork(void)
+{
+    unsigned int i;
+
+    InitMutex(&td.multiLock);
+    InitMutex(&td.queueLock);
+    for (i = 0; i < MAX_NUMTHREADS; i++) {
+        InitMutex(&td.queues[i].lock);
+        td.queues[i].head = td.queues[i].tail = 0;
     }
+
+    td.queuedTasks = 0;
+    td.busyThreads = 0;
+    td.numThreads = 1;
+    SetEvaluators(1);
 }
 
 extern void
@@ -235,48 +401,78 @@ MT_StartThreads(void)
 }
 
 void
-MT_AddTask(Task * pt, gboolean lock)
+MT_AddTask(Task * pt)
 {
-    if (lock) {
-        multi_debug("add task asks lock (queueLock)");
-        Mutex_Lock(&td.queueLock);
-        multi_debug("add task gets lock (queueLock)");
-    }
-    if (td.addedTasks == 0)
+    if (MT_SafeIncCheck(&td.addedTasks) == 0)
         MT_SafeSet(&td.result, 0);          /* Reset result for new tasks */
-    td.addedTasks++;
-    td.tasks = g_list_append(td.tasks, pt);
-    if (g_list_length(td.tasks) == 1) { /* New tasks */
-        SetManualEvent(td.activity);
-    }
-    if (lock) {
-        Mutex_Release(&td.queueLock);
-        multi_debug("add task unlocks");
-    }
+    pt->ptg = NULL;
+    MT_QueueTask(pt);
 }
 
 extern void
 mt_add_tasks(unsigned int num_tasks, AsyncFun pFun, void *taskData, gpointer linked)
 {
     unsigned int i;
-    {
+
 #if defined(DEBUG_MULTITHREADED)
-        multi_debug("add %u task%s asks lock (queueLock)", num_tasks, (num_tasks > 1 ? "s" : ""));
-        Mutex_Lock(&td.queueLock);
-        multi_debug("add tasks gets lock (queueLock)");
-#else
-        Mutex_Lock(&td.queueLock);
+    multi_debug("add %u task%s", num_tasks, (num_tasks > 1 ? "s" : ""));
 #endif
-    }
     for (i = 0; i < num_tasks; i++) {
         Task *pt = (Task *) g_malloc(sizeof(Task));
         pt->fun = pFun;
         pt->data = taskData;
         pt->pLinkedTask = linked;
-        MT_AddTask(pt, FALSE);
+        MT_AddTask(pt);
+    }
+}
+
+/* Nested tasks. They don't count in MT_WaitForTasks(); the spawning
+ * task waits for them with MT_WaitForGroup() instead. */
+
+extern void
+MT_AddGroupTask(TaskGroup * ptg, AsyncFun pFun, void *data)
+{
+    Task *pt = (Task *) g_malloc(sizeof(Task));
+
+    pt->fun = pFun;
+    pt->data = data;
+    pt->pLinkedTask = NULL;
+    pt->ptg = ptg;
+
+    MT_SafeInc(&ptg->pending);
+    MT_QueueTask(pt);
+}
+
+/* Wait for the tasks of a group to complete. A worker runs the tasks of
+ * the group still in its own queue (where MT_QueueTask() put them) rather
+ * than leave them to the other threads. It doesn't pick up anything else:
+ * an unrelated top level task could keep it away from the group's result
+ * for much longer than the group itself takes. Subtasks spawned by the
+ * group's tasks are waited for by those tasks, so they never need
+ * running from here. Once the rest of the group is running elsewhere,
+ * block until it is done. Returns -1 if some of the tasks were dropped
+ * by MT_AbortTasks() rather than run, 0 otherwise. */
+
+extern int
+MT_WaitForGroup(TaskGroup * ptg)
+{
+    int id = MT_GetThreadID();
+
+    while (MT_SafeGet(&ptg->pending) > 0) {
+        Task *task = NULL;
+
+        if (id >= 0 && id < (int) td.numThreads && (task = MT_QueueTakeGroup(&td.queues[id], ptg)) != NULL)
+            MT_SafeDec(&td.queuedTasks);
+
+        if (task) {
+            MT_GetPerf()->cTasks++;
+            task->fun(task->data);
+            MT_TaskDone(task);
+        } else
+            WaitForGroupDone(&ptg->pending);
     }
-    Mutex_Release(&td.queueLock);
-    multi_debug("add tasks unlocks (queueLock)");
+
+    return MT_SafeGet(&ptg->fAborted) ? -1 : 0;
 }
 
 static gboolean
@@ -510,10 +706,10 @@ MT_SyncEnd(void)
 
 int asyncRet;
 void
-MT_AddTask(Task * pt, gboolean lock)
+MT_AddTask(Task * pt)
 {
-    (void) lock;                /* silence compiler warning */
     td.result = 0;              /* Reset result for new tasks */
+    pt->ptg = NULL;
     td.tasks = g_list_append(td.tasks, pt);
 }
 
@@ -526,10 +722,24 @@ mt_add_tasks(unsigned int num_tasks, AsyncFun pFun, void *taskData, gpointer lin
         pt->fun = pFun;
         pt->data = taskData;
         pt->pLinkedTask = linked;
-        MT_AddTask(pt, FALSE);
+        MT_AddTask(pt);
     }
 }
 
+/* Without threads, nested tasks simply run at once */
+
+extern void
+MT_AddGroupTask(TaskGroup * UNUSED(ptg), AsyncFun pFun, void *data)
+{
+    pFun(data);
+}
+
+extern int
+MT_WaitForGroup(TaskGroup * UNUSED(ptg))
+{
+    return 0;
+}
+
 extern int
 MT_GetDoneTasks(void)
 {
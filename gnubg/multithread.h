@@ -36,6 +36,8 @@
 #endif
 
 #include "backgammon.h"
+#include "perf.h"
+#include "arena.h"
 
 // #define DEBUG_MULTITHREADED 1 
 
@@ -45,10 +47,18 @@ void multi_debug(const char *str, ...);
 #define multi_debug(x)
 #endif
 
+/* A group of tasks spawned from inside another task (or from the main
+ * thread) and waited for with MT_WaitForGroup() */
+typedef struct {
+    int pending;
+    int fAborted;               /* tasks dropped by MT_AbortTasks() */
+} TaskGroup;
+
 typedef struct Task {
     AsyncFun fun;
     void *data;
     struct Task *pLinkedTask;
+    TaskGroup *ptg;             /* NULL for top level tasks */
 } Task;
 
 typedef struct {
@@ -63,6 +73,11 @@ typedef struct {
     int id;
     move *aMoves;
     NNState *pnnState;
+    evalCacheL1 *pCacheL1;      /* owned by eval.c, see EvalCacheL1() */
+    transpositionTable *pTT;    /* owned by eval.c, see EvalTranspositions() */
+    perfcounters *pPerf;        /* owned by perf.c, see PerfCounters() */
+    arena *pArena;              /* scratch move lists, see arena.h */
+    int nNumaNode;
 } ThreadLocalData;
 
 typedef struct {
@@ -82,6 +97,16 @@ typedef GMutex Mutex;
 typedef GMutex *Mutex;
 #endif
 
+/* Per thread task deque. The owner takes tasks from either end, other
+ * threads steal the oldest ones. */
+typedef struct {
+    Mutex lock;
+    Task **aTasks;              /* ring buffer */
+    unsigned int size;          /* capacity, a power of 2 */
+    unsigned int head;          /* oldest task */
+    unsigned int tail;          /* one past the newest task */
+} TaskQueue;
+
 typedef struct {
     GList *tasks;
     int doneTasks;
@@ -92,6 +117,10 @@ typedef struct {
     ManualEvent activity;
     TLSItem tlsItem;
     Mutex queueLock;
+    TaskQueue *queues;          /* one per worker thread */
+    int queuedTasks;
+    int busyThreads;            /* workers running a task */
+    int nextQueue;
     Mutex multiLock;
     ManualEvent syncStart;
     ManualEvent syncEnd;
@@ -106,8 +135,10 @@ typedef struct {
 
 extern int MT_GetDoneTasks(void);
 extern void MT_AbortTasks(void);
-extern void MT_AddTask(Task * pt, gboolean lock);
+extern void MT_AddTask(Task * pt);
 extern void mt_add_tasks(unsigned int num_tasks, AsyncFun pFun, void *taskData, gpointer linked);
+extern void MT_AddGroupTask(TaskGroup * ptg, AsyncFun pFun, void *data);
+extern int MT_WaitForGroup(TaskGroup * ptg);
 extern int MT_WaitForTasks(gboolean(*pCallback) (gpointer), int callbackTime, int autosave);
 extern void MT_InitThreads(void);
 extern void MT_Close(void);
@@ -124,6 +155,8 @@ extern void Mutex_Lock(Mutex *mutex);
 extern void Mutex_Release(Mutex *mutex);
 extern void WaitForManualEvent(ManualEvent ME);
 extern void SetManualEvent(ManualEvent ME);
+extern void WaitForGroupDone(const int *pPending);
+extern void SignalGroupDone(void);
 extern void TLSSetValue(TLSItem pItem, size_t value);
 extern void InitManualEvent(ManualEvent * pME);
 extern void FreeManualEvent(ManualEvent ME);
@@ -138,6 +171,7 @@ extern void FreeMutex(Mutex * mutex);
 
 extern void MT_Release(void);
 extern void MT_Exclusive(void);
+extern void MT_AfterFork(void);
 extern void MT_StartThreads(void);
 extern void MT_SetNumThreads(unsigned int num);
 extern void MT_SyncInit(void);
@@ -146,6 +180,10 @@ extern double MT_SyncEnd(void);
 extern void MT_SetResultFailed(void);
 extern void TLSCreate(TLSItem * pItem);
 extern unsigned int MT_GetNumThreads(void);
+extern int MT_GetIdleThreads(void);
+extern unsigned int MT_GetNumaNodes(void);
+extern int MT_GetNumaNode(void);
+extern void MT_BindToNumaNode(void *p, size_t cb, int node);
 
 #define MT_GetTLD() ((ThreadLocalData *)TLSGet(td.tlsItem))
 #define MT_GetThreadID() ((ThreadLocalData *)TLSGet(td.tlsItem))->id
@@ -178,7 +216,9 @@ extern unsigned int MT_GetNumThreads(void);
 extern int asyncRet;
 #define MT_Exclusive() {}
 #define MT_Release() {}
+#define MT_AfterFork() {}
 #define MT_GetNumThreads() 1
+#define MT_GetIdleThreads() 0
 #define MT_SetResultFailed() asyncRet = -1
 #define MT_SafeInc(x) (++(*x))
 #define MT_SafeIncValue(x) (++(*x))
@@ -196,4 +236,7 @@ extern int asyncRet;
 
 #endif
 
+#define MT_GetPerf() (MT_GetTLD()->pPerf)
+#define MT_GetArena() (MT_GetTLD()->pArena)
+
 #endif
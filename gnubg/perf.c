@@ -0,0 +1,104 @@
+/*
+ * Copyright (C) 2024 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * $Id$
+ */
+
+/*
+ * Per thread counters of the evaluation hot paths ("show performance").
+ */
+
+#include "config.h"
+
+#include <string.h>
+
+#include "perf.h"
+#include "multithread.h"
+
+int fPerfTimers = FALSE;
+
+/* Indexed by thread id + 1 (the main thread is -1). The padding keeps
+ * the counters of two threads out of the same cache line. */
+static struct {
+    perfcounters pc;
+    char acPad[64];
+} aPerf[MAX_NUMTHREADS + 1];
+
+/* origin of the tick to second conversion */
+static uint64_t tickOrigin;
+static gint64 timeOrigin;
+
+extern perfcounters *
+PerfCounters(int id)
+{
+    if (!timeOrigin) {
+        tickOrigin = PerfTicks();
+        timeOrigin = g_get_monotonic_time();
+    }
+
+    return &aPerf[id + 1].pc;
+}
+
+/* The counters are read while the threads may update them, so the
+ * totals can be a little behind */
+
+extern void
+PerfTotals(perfcounters * ppc)
+{
+    unsigned int i, j;
+
+    memset(ppc, 0, sizeof(perfcounters));
+
+    for (i = 0; i < G_N_ELEMENTS(aPerf); i++) {
+        const perfcounters *p = &aPerf[i].pc;
+
+        for (j = 0; j < N_CLASSES; j++)
+            ppc->acEval[j] += p->acEval[j];
+        for (j = 0; j < PERF_PLIES; j++) {
+            ppc->acLookup[j] += p->acLookup[j];
+            ppc->acHit[j] += p->acHit[j];
+        }
+        for (j = 0; j < N_PERF_TIMERS; j++)
+            ppc->acTicks[j] += p->acTicks[j];
+        ppc->cGenerateMoves += p->cGenerateMoves;
+        ppc->cRolloutTrials += p->cRolloutTrials;
+        ppc->cTasks += p->cTasks;
+    }
+}
+
+extern void
+PerfReset(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < G_N_ELEMENTS(aPerf); i++)
+        memset(&aPerf[i].pc, 0, sizeof(perfcounters));
+}
+
+extern double
+PerfTicksPerSecond(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    gint64 t = g_get_monotonic_time() - timeOrigin;
+
+    if (!timeOrigin || t <= 0)
+        return 0.0;
+
+    return (double) (PerfTicks() - tickOrigin) * G_USEC_PER_SEC / (double) t;
+#else
+    return G_USEC_PER_SEC;
+#endif
+}
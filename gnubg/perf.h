@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2024 the AUTHORS
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <https://www.gnu.org/licenses/>.
+ *
+ * $Id$
+ */
+
+#ifndef PERF_H
+#define PERF_H
+
+#include <stdint.h>
+#include <glib.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "eval.h"
+
+/* cache lookups of deeper plies are counted with the last one */
+#define PERF_PLIES 5
+
+typedef enum {
+    PERF_TIMER_EVAL,            /* neural net and bearoff evaluations */
+    PERF_TIMER_GENERATE,        /* move generation */
+    PERF_TIMER_QUEUE_WAIT,      /* worker threads waiting while tasks are pending */
+    N_PERF_TIMERS
+} perftimer;
+
+/* Counters of one thread. Only that thread writes them, so they are
+ * plain integers; the totals are summed when they are shown. */
+typedef struct {
+    uint64_t acEval[N_CLASSES];
+    uint64_t cGenerateMoves;
+    uint64_t acLookup[PERF_PLIES];
+    uint64_t acHit[PERF_PLIES];
+    uint64_t cRolloutTrials;
+    uint64_t cTasks;
+    uint64_t acTicks[N_PERF_TIMERS];
+} perfcounters;
+
+/* the timers cost a time stamp per evaluation: off by default */
+extern int fPerfTimers;
+
+extern perfcounters *PerfCounters(int id);
+extern void PerfTotals(perfcounters * ppc);
+extern void PerfReset(void);
+extern double PerfTicksPerSecond(void);
+
+static inline uint64_t
+PerfTicks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return (uint64_t) g_get_monotonic_time();
+#endif
+}
+
+/* PerfStart() returns 0 when the timers are off, and PerfStop() then
+ * does nothing */
+
+static inline uint64_t
+PerfStart(void)
+{
+    return fPerfTimers ? PerfTicks() : 0;
+}
+
+static inline void
+PerfStop(perfcounters * ppc, perftimer t, uint64_t t0)
+{
+    if (t0)
+        ppc->acTicks[t] += PerfTicks() - t0;
+}
+
+#endif
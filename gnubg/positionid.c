@@ -452,27 +452,39 @@ PositionF(unsigned int fBits, unsigned int n, unsigned int r)
         PositionF(fBits, n - 1, r - 1) : PositionF(fBits, n - 1, r);
 }
 
+/* The bearoff position index is the rank of the (nPoints +
+ * nChequers)-bit pattern with a bit set for each point separator, in
+ * the combinatorial number system: the sum of C(b, r) over the set bits
+ * b, highest first, with r counting down from nPoints. The separators
+ * are found directly from the board, so this is a short loop of table
+ * lookups rather than PositionF() over all the bits. */
+
 extern unsigned int
 PositionBearoff(const unsigned int anBoard[], unsigned int nPoints, unsigned int nChequers)
 {
-    unsigned int i, fBits, j;
+    unsigned int i, j, nID = 0;
 
     if (nPoints == 0) {
         g_assert_not_reached();
         return 0;
     }
 
+    g_assert(nChequers + nPoints <= MAX_N && nPoints <= MAX_R);
+
+    if (!fCalculated)
+        InitCombination();
+
     for (j = nPoints - 1, i = 0; i < nPoints; i++)
         j += anBoard[i];
 
-    fBits = 1u << j;
-
-    for (i = 0; i < nPoints - 1; i++) {
+    for (i = 0; i < nPoints; i++) {
+        /* separator i is at bit j; C(j, nPoints - i) */
+        if (j)
+            nID += anCombination[j - 1][nPoints - i - 1];
         j -= anBoard[i] + 1;
-        fBits |= (1u << j);
     }
 
-    return PositionF(fBits, nChequers + nPoints, nPoints);
+    return nID;
 }
 
 static unsigned int
@@ -28,6 +28,14 @@
 #include <string.h>
 #include <glib.h>
 #include <glib/gstdio.h>
+#if defined(HAVE_FORK)
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 #include <time.h>
 
 #include "backgammon.h"
@@ -39,6 +47,7 @@
 #include "format.h"
 #include "multithread.h"
 #include "rollout.h"
+#include "evalstore.h"
 #include "lib/simd.h"
 
 #define LogCubeClamped(n) (n < (1 << STAT_MAXCUBE) ? LogCube(n) : (STAT_MAXCUBE - 1))
@@ -50,6 +59,9 @@ f_BasicCubefulRollout BasicCubefulRollout = BasicCubefulRolloutNoLocking;
 
 int log_rollouts = 0;
 char *log_file_name = 0;
+unsigned int cRolloutLockstep = 4;
+unsigned int cRolloutProcesses = 1;
+unsigned int cRolloutCheckInterval = 1;
 static unsigned int initial_game_count;
 
 /* make sgf files of rollouts if log_rollouts is true and we have a file 
@@ -292,12 +304,61 @@ static volatile unsigned int initial_game_count;
 static void initRolloutstat(rolloutstat * prs);
 #endif
 
+/* Pre-evaluate the candidate moves of all the unfinished games with
+ * the same player on roll as the first one, so that the FindBestMove()
+ * calls that follow find their 0-ply evaluations in the cache. Late in
+ * the game the move lists are short, and pooling them fills evaluation
+ * blocks that a single list would leave mostly empty.
+ *
+ * The games played in lockstep get the same results as when played one
+ * at a time only because a batched evaluation is bit for bit the same
+ * as a single one, whatever the other positions of the block (see
+ * EvaluateBatchSSE()). It still takes the pre-evaluated entries staying
+ * in the cache until FindBestMove() reads them: one evicted meanwhile
+ * (a small cache, or other threads filling it) is evaluated again
+ * incrementally, which can differ in the last bits and, rarely, change
+ * a move choice. */
+
+#define PREFETCH_MOVES 512
+
+static void
+PrefetchChequerPlay(unsigned int aanBoard[][2][25], const unsigned int aanDice[][2], unsigned int cBoards,
+                    unsigned int cci, const cubeinfo aci[], const int afUnfinished[], evalcontext * apec[2])
+{
+    positionkey akey[PREFETCH_MOVES];
+    const cubeinfo *pci = NULL;
+    movelist ml;
+    unsigned int n, i, c = 0;
+
+    for (n = 0; n < cBoards; n++) {
+        if (!afUnfinished[n])
+            continue;
+
+        if (!pci) {
+            pci = &aci[n];
+            if (apec[pci->fMove]->rNoise > 0.0f)
+                /* noisy evaluations are not cached */
+                return;
+        } else if (aci[n].fMove != pci->fMove)
+            continue;
+
+        GenerateMoves(&ml, (ConstTanBoard) aanBoard[n], (int) aanDice[n / cci][0], (int) aanDice[n / cci][1], FALSE);
+
+        for (i = 0; i < ml.cMoves && c < PREFETCH_MOVES; i++)
+            akey[c++] = ml.amMoves[i].key;
+    }
+
+    if (c > 1)
+        EvaluateMovesAhead(akey, c, pci, apec[pci->fMove]);
+}
+
 /* called with 
  * cube decision                  move rollout
  * aanBoard       2 copies of same board         1 board
  * aarOutput      2 arrays for eval              1 array
  * iTurn          player on roll                 same
- * iGame          game number                    same
+ * art            the games played in lockstep   same
+ * cTrials        number of games (art[])        same
  * cubeinfo       2 structs for double/nodouble  1 cubeinfo
  * or take/pass
  * CubeDecTop     array of 2 boolean             1 boolean
@@ -308,6 +369,10 @@ static void initRolloutstat(rolloutstat * prs);
  * two alternatives of 
  * cube rollouts 
  * 
+ * aanBoard and aarOutput hold the cci entries of each game in turn.
+ * The games have their own dice; playing them together lets their
+ * candidate moves be evaluated in common blocks.
+ *
  * returns -1 on error/interrupt, fInterrupt TRUE if stopped by user
  * aarOutput array(s) contain results
  */
@@ -315,19 +380,19 @@ static void initRolloutstat(rolloutstat * prs);
 extern int
 BasicCubefulRollout(unsigned int aanBoard[][2][25],
                     float aarOutput[][NUM_ROLLOUT_OUTPUTS],
-                    int iTurn, int iGame,
+                    int iTurn, const rollouttrial art[], unsigned int cTrials,
                     const cubeinfo aci[], int afCubeDecTop[], unsigned int cci,
-                    rolloutcontext * prc,
-                    rolloutstat aarsStatistics[][2],
-                    int nBasisCube, perArray * dicePerms, rngcontext * rngctxRollout, FILE * logfp)
+                    rolloutcontext * prc, rolloutstat aarsStatistics[][2], int nBasisCube, perArray * dicePerms)
 {
 
-    unsigned int anDice[2];
-    unsigned int cUnfinished = cci;
+    unsigned int const cBoards = cTrials * cci;
+    unsigned int *anDice;
+    unsigned int cUnfinished = cBoards;
     cubeinfo *pci;
     cubedecision cd;
     int *pf;
-    unsigned int i, j, k, ici;
+    unsigned int i, j, k, ici, n, t;
+    FILE *logfp;
     evalcontext ec;
 
     positionclass pc, pcBefore;
@@ -340,8 +405,9 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
     unsigned int aiBar[2];
 
-    int afClosedOut[2] = { FALSE, FALSE };
-    int afHit[2] = { FALSE, FALSE };
+    int (*aafClosedOut)[2] = g_alloca(cTrials * sizeof(*aafClosedOut));
+    int (*aafHit)[2] = g_alloca(cTrials * sizeof(*aafHit));
+    unsigned int (*aanDice)[2] = g_alloca(cTrials * sizeof(*aanDice));
 
     float rDP;
     float r;
@@ -354,9 +420,9 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
     /* Make local copy of cubeinfo struct, since it
      * may be modified */
-    cubeinfo *pciLocal = g_alloca(cci * sizeof(cubeinfo));
-    int *pfFinished = g_alloca(cci * sizeof(int));
-    float (*aarVarRedn)[NUM_ROLLOUT_OUTPUTS] = g_alloca(cci * NUM_ROLLOUT_OUTPUTS * sizeof(float));
+    cubeinfo *pciLocal = g_alloca(cBoards * sizeof(cubeinfo));
+    int *pfFinished = g_alloca(cBoards * sizeof(int));
+    float (*aarVarRedn)[NUM_ROLLOUT_OUTPUTS] = g_alloca(cBoards * NUM_ROLLOUT_OUTPUTS * sizeof(float));
 
     /* variables for variance reduction */
 
@@ -384,9 +450,9 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
          * Create evaluation context one ply deep
          */
 
-        for (ici = 0; ici < cci; ici++)
+        for (n = 0; n < cBoards; n++)
             for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
-                aarVarRedn[ici][i] = 0.0f;
+                aarVarRedn[n][i] = 0.0f;
 
         for (i = 0; i < 2; i++) {
             aecZero[i] = aecVarRedn[i] = prc->aecChequer[i];
@@ -399,10 +465,14 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
     }
 
-    for (ici = 0; ici < cci; ici++)
-        pfFinished[ici] = TRUE;
+    for (n = 0; n < cBoards; n++)
+        pfFinished[n] = TRUE;
 
-    memcpy(pciLocal, aci, cci * sizeof(cubeinfo));
+    for (t = 0; t < cTrials; t++)
+        memcpy(pciLocal + t * cci, aci, cci * sizeof(cubeinfo));
+
+    memset(aafClosedOut, 0, cTrials * sizeof(*aafClosedOut));
+    memset(aafHit, 0, cTrials * sizeof(*aafHit));
 
     while ((!nTruncate || iTurn < nTruncate) && cUnfinished) {
         if (iTurn < nLateEvals) {
@@ -419,22 +489,25 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
         /* Cube decision */
 
-        for (ici = 0, pci = pciLocal, pf = pfFinished; ici < cci; ici++, pci++, pf++) {
+        for (n = 0, pci = pciLocal, pf = pfFinished; n < cBoards; n++, pci++, pf++) {
+
+            ici = n % cci;
+            logfp = art[n / cci].logfp;
 
             /* check for truncation at bearoff databases */
 
-            pc = ClassifyPosition((ConstTanBoard) aanBoard[ici], pci->bgv);
+            pc = ClassifyPosition((ConstTanBoard) aanBoard[n], pci->bgv);
 
             if (prc->fTruncBearoff2 && pc <= CLASS_PERFECT &&
                 prc->fCubeful && *pf && !pci->nMatchTo && ((afCubeDecTop[ici] && !prc->fInitial) || iTurn > 0)) {
 
                 /* truncate at two sided bearoff if money game */
 
-                if (GeneralEvaluationE(aarOutput[ici], (ConstTanBoard) aanBoard[ici], pci, &ecCubeful0ply) < 0)
+                if (GeneralEvaluationE(aarOutput[n], (ConstTanBoard) aanBoard[n], pci, &ecCubeful0ply) < 0)
                     return -1;
 
                 if (iTurn & 1)
-                    InvertEvaluationR(aarOutput[ici], pci);
+                    InvertEvaluationR(aarOutput[n], pci);
 
                 *pf = FALSE;
                 cUnfinished--;
@@ -444,14 +517,14 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
                 /* cubeless rollout, requested to truncate at bearoff db */
 
-                if (GeneralEvaluationE(aarOutput[ici], (ConstTanBoard) aanBoard[ici], pci, &ecCubeless0ply) < 0)
+                if (GeneralEvaluationE(aarOutput[n], (ConstTanBoard) aanBoard[n], pci, &ecCubeless0ply) < 0)
                     return -1;
 
                 /* rollout result is for player on play (even iTurn).
                  * This point is pre play, so if opponent is on roll, invert */
 
                 if (iTurn & 1)
-                    InvertEvaluationR(aarOutput[ici], pci);
+                    InvertEvaluationR(aarOutput[n], pci);
 
                 *pf = FALSE;
                 cUnfinished--;
@@ -462,7 +535,7 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
                 if (prc->fCubeful && GetDPEq(NULL, &rDP, pci) && (iTurn > 0 || (afCubeDecTop[ici] && !prc->fInitial))) {
 
-                    if (GeneralCubeDecisionE(aar, (ConstTanBoard) aanBoard[ici], pci, pecCube[pci->fMove], 0) < 0)
+                    if (GeneralCubeDecisionE(aar, (ConstTanBoard) aanBoard[n], pci, pecCube[pci->fMove], 0) < 0)
                         return -1;
 
                     cd = FindCubeDecision(arDouble, aar, pci);
@@ -499,7 +572,7 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
                         /* assign outputs */
 
                         for (i = 0; i <= OUTPUT_EQUITY; i++)
-                            aarOutput[ici][i] = aar[0][i];
+                            aarOutput[n][i] = aar[0][i];
 
                         /* 
                          * assign equity for double, pass:
@@ -507,12 +580,12 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
                          * - normalized equity for money play (i.e, rDP=1)
                          */
 
-                        aarOutput[ici][OUTPUT_CUBEFUL_EQUITY] = rDP;
+                        aarOutput[n][OUTPUT_CUBEFUL_EQUITY] = rDP;
 
                         /* invert evaluations if required */
 
                         if (iTurn & 1)
-                            InvertEvaluationR(aarOutput[ici], pci);
+                            InvertEvaluationR(aarOutput[n], pci);
 
                         /* update statistics */
 
@@ -551,28 +624,39 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
         /* Chequer play */
 
-        if (RolloutDice(iTurn, iGame, prc->fInitial, anDice,
-                        &prc->rngRollout, rngctxRollout, prc->fRotate, dicePerms) < 0)
-            return -1;
+        for (t = 0; t < cTrials; t++) {
+            anDice = aanDice[t];
+
+            if (RolloutDice(iTurn, art[t].iGame, prc->fInitial, anDice,
+                            &prc->rngRollout, art[t].rngctx, prc->fRotate, dicePerms) < 0)
+                return -1;
 
-        if (anDice[0] < anDice[1])
-            swap_us(anDice, anDice + 1);
+            if (anDice[0] < anDice[1])
+                swap_us(anDice, anDice + 1);
+        }
 
+        if (cBoards > 1 && !useVarRedn)
+            PrefetchChequerPlay(aanBoard, (const unsigned int (*)[2]) aanDice, cBoards, cci, pciLocal, pfFinished,
+                                pecChequer);
 
-        for (ici = 0, pci = pciLocal, pf = pfFinished; ici < cci; ici++, pci++, pf++) {
+        for (n = 0, pci = pciLocal, pf = pfFinished; n < cBoards; n++, pci++, pf++) {
 
             if (*pf) {
 
+                ici = n % cci;
+                anDice = aanDice[n / cci];
+                logfp = art[n / cci].logfp;
+
                 /* Save number of chequers on bar */
 
                 for (i = 0; i < 2; i++)
-                    aiBar[i] = aanBoard[ici][i][24];
+                    aiBar[i] = aanBoard[n][i][24];
 
                 /* Save number of pips (for bearoff only) */
 
-                pcBefore = ClassifyPosition((ConstTanBoard) aanBoard[ici], pci->bgv);
+                pcBefore = ClassifyPosition((ConstTanBoard) aanBoard[n], pci->bgv);
                 if (aarsStatistics && pcBefore <= CLASS_BEAROFF1) {
-                    PipCount((ConstTanBoard) aanBoard[ici], anPips);
+                    PipCount((ConstTanBoard) aanBoard[n], anPips);
                     nPipsBefore = anPips[1];
                 }
 
@@ -593,7 +677,7 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
                                  * out as initial position */
                                 continue;
 
-                            memcpy(&aaanBoard[i][j][0][0], &aanBoard[ici][0][0], 2 * 25 * sizeof(int));
+                            memcpy(&aaanBoard[i][j][0][0], &aanBoard[n][0][0], 2 * 25 * sizeof(int));
 
                             /* Find the best move for each roll on ply 0 only */
 
@@ -639,7 +723,7 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
                         FindBestMove(aanMoves[anDice[0] - 1][anDice[1] - 1],
                                      anDice[0], anDice[1],
-                                     aanBoard[ici], pci,
+                                     aanBoard[n], pci,
                                      pecChequer[pci->fMove],
                                      (iTurn < nLateEvals) ? prc->aaamfChequer[pci->fMove] : prc->aaamfLate[pci->fMove]);
 
@@ -647,10 +731,10 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
                         /* 0-ply play: best move is already recorded */
 
-                        memcpy(&aanBoard[ici][0][0],
+                        memcpy(&aanBoard[n][0][0],
                                &aaanBoard[anDice[0] - 1][anDice[1] - 1][0][0], 2 * 25 * sizeof(int));
 
-                        SwapSides(aanBoard[ici]);
+                        SwapSides(aanBoard[n]);
 
                     }
 
@@ -659,14 +743,14 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
                     if (pci->nMatchTo)
                         for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
-                            aarVarRedn[ici][i] += arMean[i] - aaar[anDice[0] - 1][anDice[1] - 1][i];
+                            aarVarRedn[n][i] += arMean[i] - aaar[anDice[0] - 1][anDice[1] - 1][i];
                     else {
                         for (i = 0; i <= OUTPUT_EQUITY; i++)
-                            aarVarRedn[ici][i] += arMean[i] - aaar[anDice[0] - 1][anDice[1] - 1][i];
+                            aarVarRedn[n][i] += arMean[i] - aaar[anDice[0] - 1][anDice[1] - 1][i];
 
                         r = arMean[OUTPUT_CUBEFUL_EQUITY] - aaar[anDice[0] - 1][anDice[1] - 1]
                             [OUTPUT_CUBEFUL_EQUITY];
-                        aarVarRedn[ici][OUTPUT_CUBEFUL_EQUITY] += r * (float) (pci->nCube / aci[ici].nCube);
+                        aarVarRedn[n][OUTPUT_CUBEFUL_EQUITY] += r * (float) (pci->nCube / aci[ici].nCube);
                     }
 
                 } else {
@@ -675,7 +759,7 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
                     FindBestMove(aanMoves[anDice[0] - 1][anDice[1] - 1],
                                  anDice[0], anDice[1],
-                                 aanBoard[ici], pci,
+                                 aanBoard[n], pci,
                                  pecChequer[pci->fMove],
                                  (iTurn < nLateEvals) ? prc->aaamfChequer[pci->fMove] : prc->aaamfLate[pci->fMove]);
 
@@ -689,10 +773,10 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
                 /* FIXME: record double hit, triple hits etc. ? */
 
-                if (aarsStatistics && !afHit[pci->fMove] && (aiBar[0] < aanBoard[ici][0][24])) {
+                if (aarsStatistics && !aafHit[n / cci][pci->fMove] && (aiBar[0] < aanBoard[n][0][24])) {
                     MT_SafeInc(&aarsStatistics[ici][pci->fMove].nOpponentHit);
                     MT_SafeAdd(&aarsStatistics[ici][pci->fMove].rOpponentHitMove, iTurn);
-                    afHit[pci->fMove] = TRUE;
+                    aafHit[n / cci][pci->fMove] = TRUE;
 
                 }
 
@@ -701,11 +785,11 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
                 /* Calculate number of wasted pips */
 
-                pc = ClassifyPosition((ConstTanBoard) aanBoard[ici], pci->bgv);
+                pc = ClassifyPosition((ConstTanBoard) aanBoard[n], pci->bgv);
 
                 if (aarsStatistics && pc <= CLASS_BEAROFF1 && pcBefore <= CLASS_BEAROFF1) {
 
-                    PipCount((ConstTanBoard) aanBoard[ici], anPips);
+                    PipCount((ConstTanBoard) aanBoard[n], anPips);
                     nPipsAfter = anPips[1];
                     nPipsDice = anDice[0] + anDice[1];
                     if (anDice[0] == anDice[1])
@@ -719,17 +803,17 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
                 /* Opponent closed out */
 
-                if (aarsStatistics && !afClosedOut[pci->fMove]
-                    && aanBoard[ici][0][24]) {
+                if (aarsStatistics && !aafClosedOut[n / cci][pci->fMove]
+                    && aanBoard[n][0][24]) {
 
                     /* opponent is on bar */
 
-                    ClosedBoard(afClosedBoard, (ConstTanBoard) aanBoard[ici]);
+                    ClosedBoard(afClosedBoard, (ConstTanBoard) aanBoard[n]);
 
                     if (afClosedBoard[pci->fMove]) {
                         MT_SafeInc(&aarsStatistics[ici][pci->fMove].nOpponentClosedOut);
                         MT_SafeAdd(&aarsStatistics[ici][pci->fMove].rOpponentClosedOutMove, iTurn);
-                        afClosedOut[pci->fMove] = TRUE;
+                        aafClosedOut[n / cci][pci->fMove] = TRUE;
                     }
 
                 }
@@ -738,17 +822,17 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
                 /* check if game is over */
 
                 if (pc == CLASS_OVER) {
-                    if (GeneralEvaluationE(aarOutput[ici], (ConstTanBoard) aanBoard[ici], pci, pecCube[pci->fMove]) < 0)
+                    if (GeneralEvaluationE(aarOutput[n], (ConstTanBoard) aanBoard[n], pci, pecCube[pci->fMove]) < 0)
                         return -1;
 
                     /* Since the game is over: cubeless equity = cubeful equity
                      * (convert to mwc for match play) */
 
-                    aarOutput[ici][OUTPUT_CUBEFUL_EQUITY] =
-                        (pci->nMatchTo) ? eq2mwc(aarOutput[ici][OUTPUT_EQUITY], pci) : aarOutput[ici][OUTPUT_EQUITY];
+                    aarOutput[n][OUTPUT_CUBEFUL_EQUITY] =
+                        (pci->nMatchTo) ? eq2mwc(aarOutput[n][OUTPUT_EQUITY], pci) : aarOutput[n][OUTPUT_EQUITY];
 
                     if (iTurn & 1)
-                        InvertEvaluationR(aarOutput[ici], pci);
+                        InvertEvaluationR(aarOutput[n], pci);
 
                     *pf = FALSE;
                     cUnfinished--;
@@ -756,7 +840,7 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
                     /* update statistics */
 
                     if (aarsStatistics)
-                        switch (GameStatus((ConstTanBoard) aanBoard[ici], pci->bgv)) {
+                        switch (GameStatus((ConstTanBoard) aanBoard[n], pci->bgv)) {
                         case 1:
                             MT_SafeInc(&aarsStatistics[ici][pci->fMove].acWin[LogCubeClamped(pci->nCube)]);
                             break;
@@ -772,7 +856,7 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
                 /* Invert board and more */
 
-                SwapSides(aanBoard[ici]);
+                SwapSides(aanBoard[n]);
 
                 SetCubeInfo(pci, pci->nCube, pci->fCubeOwner,
                             !pci->fMove, pci->nMatchTo,
@@ -787,7 +871,9 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
     /* evaluation at truncation */
 
-    for (ici = 0, pci = pciLocal, pf = pfFinished; ici < cci; ici++, pci++, pf++) {
+    for (n = 0, pci = pciLocal, pf = pfFinished; n < cBoards; n++, pci++, pf++) {
+
+        ici = n % cci;
 
         if (*pf) {
 
@@ -798,11 +884,11 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
 
             /* evaluation at truncation */
 
-            if (GeneralEvaluationE(aarOutput[ici], (ConstTanBoard) aanBoard[ici], pci, &ec) < 0)
+            if (GeneralEvaluationE(aarOutput[n], (ConstTanBoard) aanBoard[n], pci, &ec) < 0)
                 return -1;
 
             if (iTurn & 1)
-                InvertEvaluationR(aarOutput[ici], pci);
+                InvertEvaluationR(aarOutput[n], pci);
 
         }
 
@@ -810,24 +896,24 @@ BasicCubefulRollout(unsigned int aanBoard[][2][25],
          * all variance reduction terms */
 
         if (!pci->nMatchTo)
-            aarOutput[ici][OUTPUT_CUBEFUL_EQUITY] *= (float) (pci->nCube / aci[ici].nCube);
+            aarOutput[n][OUTPUT_CUBEFUL_EQUITY] *= (float) (pci->nCube / aci[ici].nCube);
 
         if (useVarRedn)
             for (i = 0; i < NUM_ROLLOUT_OUTPUTS; i++)
-                aarOutput[ici][i] += aarVarRedn[ici][i];
+                aarOutput[n][i] += aarVarRedn[n][i];
 
         /* multiply money equities */
 
         if (!pci->nMatchTo)
-            aarOutput[ici][OUTPUT_CUBEFUL_EQUITY] *= (float) (aci[ici].nCube / nBasisCube);
+            aarOutput[n][OUTPUT_CUBEFUL_EQUITY] *= (float) (aci[ici].nCube / nBasisCube);
 
 
 
         /*        if ( pci->nMatchTo ) */
-        /*          aarOutput[ ici ][ OUTPUT_CUBEFUL_EQUITY ] = */
-        /*            eq2mwc ( aarOutput[ ici ][ OUTPUT_CUBEFUL_EQUITY ], pci ); */
+        /*          aarOutput[ n ][ OUTPUT_CUBEFUL_EQUITY ] = */
+        /*            eq2mwc ( aarOutput[ n ][ OUTPUT_CUBEFUL_EQUITY ], pci ); */
         /*        else */
-        /*          aarOutput[ ici ][ OUTPUT_CUBEFUL_EQUITY ] *= */
+        /*          aarOutput[ n ][ OUTPUT_CUBEFUL_EQUITY ] *= */
         /*            pci->nCube / aci [ ici ].nCube; */
 
     }
@@ -1116,109 +1202,217 @@ check_sds(int *active)
 
 }
 
-extern void
-RolloutLoopMT(void *UNUSED(unused))
+/* Play the games art[].iGame of alternative alt in lockstep, each
+ * with its dice generator argctx[]. The statistics go to pars (may be
+ * NULL). */
+
+static void
+PlayRolloutGames(int alt, rollouttrial art[], rngcontext * argctx[], unsigned int cTrials,
+                 float aar[][NUM_ROLLOUT_OUTPUTS], rolloutstat(*pars)[2], perArray * pdicePerms)
+{
+    TanBoard aanBoardEval[MAX_ROLLOUT_LOCKSTEP];
+    rolloutcontext *prc = &ro_apes[alt]->rc;
+    unsigned int t;
+
+    /* get the dice generator set up... */
+    if (prc->fRotate)
+        QuasiRandomSeed(pdicePerms, (int) prc->nSeed);
+
+    MT_SafeSet(&nSkip, 0);      /* not multi-thread safe do quasi random dice for initial positions */
+
+    for (t = 0; t < cTrials; t++) {
+        int const trial = art[t].iGame;
+
+        /* ... and the RNG */
+        art[t].rngctx = argctx[t];
+        if (prc->rngRollout != RNG_MANUAL)
+            InitRNGSeed((unsigned int) (prc->nSeed + (trial << 8)), prc->rngRollout, art[t].rngctx);
+
+        memcpy(&aanBoardEval[t], ro_apBoard[alt], sizeof(aanBoardEval[t]));
+
+        /* roll something out */
+        art[t].logfp = NULL;
+        if (log_rollouts && log_file_name) {
+            char *log_name = g_strdup_printf("%s-%7.7d-%c.sgf", log_file_name, trial, alt + 'a');
+            art[t].logfp = log_game_start(log_name, ro_apci[alt], prc->fCubeful, aanBoardEval[t]);
+            g_free(log_name);
+        }
+    }
+
+    BasicCubefulRollout(aanBoardEval, aar, 0, art, cTrials, ro_apci[alt],
+                        ro_apCubeDecTop[alt], 1, prc, pars, aciLocal[ro_fCubeRollout ? 0 : alt].nCube, pdicePerms);
+
+    MT_GetPerf()->cRolloutTrials += (uint64_t) cTrials;
+
+    for (t = 0; t < cTrials; t++)
+        if (art[t].logfp) {
+            log_game_over(art[t].logfp);
+        }
+}
+
+/* Running count, mean and sum of squared deviations (Welford) of the
+ * results of one alternative. Each rollout thread keeps its own and
+ * adds them to the totals now and then. */
+
+typedef struct {
+    unsigned int n;
+    double arMean[NUM_ROLLOUT_OUTPUTS];
+    double arM2[NUM_ROLLOUT_OUTPUTS];
+} rolloutaccum;
+
+static void
+AccumulateRolloutResult(rolloutaccum * pra, int alt, float ar[NUM_ROLLOUT_OUTPUTS])
 {
-    TanBoard anBoardEval;
-    float aar[NUM_ROLLOUT_OUTPUTS];
-    int active_alternatives;
     unsigned int j;
-    int alt;
-    FILE *logfp = NULL;
-    rolloutcontext *prc = NULL;
-    /* Each thread gets a copy of the rngctxRollout */
-    rngcontext *rngctxMTRollout = CopyRNGContext(rngctxRollout);
-    perArray dicePerms;
-    dicePerms.nPermutationSeed = -1;
 
-    /* ============ begin rollout loop ============= */
+    if (ro_fInvert)
+        InvertEvaluationR(ar, ro_apci[alt]);
 
-    while (MT_SafeIncValue(&ro_NextTrial) <= cGames) {
-        active_alternatives = ro_alternatives;
+    pra->n++;
 
-        for (alt = 0; alt < ro_alternatives; ++alt) {
-            int trial = MT_SafeIncValue(&altTrialCount[alt]) - 1;
-            /* skip this one if it's already finished */
-            if (fNoMore[alt] || (trial > cGames)) {
-                MT_SafeDec(&altTrialCount[alt]);
-                continue;
-            }
+    for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
+        double const rDelta = ar[j] - pra->arMean[j];
 
+        pra->arMean[j] += rDelta / pra->n;
+        pra->arM2[j] += rDelta * (ar[j] - pra->arMean[j]);
+    }
+}
 
-            prc = &ro_apes[alt]->rc;
+/* Add the games in *pra to the totals of alternative alt and clear it.
+ * The caller holds the lock. */
 
-            /* get the dice generator set up... */
-            if (prc->fRotate)
-                QuasiRandomSeed(&dicePerms, (int) prc->nSeed);
+static void
+MergeRolloutAccum(int alt, rolloutaccum * pra)
+{
+    rolloutcontext *prc = &ro_apes[alt]->rc;
+    unsigned int const nOld = (unsigned int) altGameCount[alt];
+    unsigned int const n = nOld + pra->n;
+    unsigned int j;
 
-            MT_SafeSet(&nSkip, 0);      /* not multi-thread safe do quasi random dice for initial positions */
+    if (!pra->n)
+        return;
 
-            /* ... and the RNG */
-            if (prc->rngRollout != RNG_MANUAL)
-                InitRNGSeed((unsigned int) (prc->nSeed + (trial << 8)), prc->rngRollout, rngctxMTRollout);
+    altGameCount[alt] = (int) n;
 
-            memcpy(&anBoardEval, ro_apBoard[alt], sizeof(anBoardEval));
+    for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
+        double const rMuOld = nOld ? aarResult[alt][j] / nOld : 0.0;
+        double const rDelta = pra->arMean[j] - rMuOld;
+        /* aarVariance is the sample variance of the nOld games so far */
+        double const rM2 = (nOld > 1 ? aarVariance[alt][j] * (nOld - 1) : 0.0) + pra->arM2[j] +
+            rDelta * rDelta * nOld * pra->n / n;
 
-            /* roll something out */
-            if (log_rollouts && log_file_name) {
-                char *log_name = g_strdup_printf("%s-%7.7d-%c.sgf", log_file_name, trial, alt + 'a');
-                logfp = log_game_start(log_name, ro_apci[alt], prc->fCubeful, anBoardEval);
-                g_free(log_name);
-            }
-            BasicCubefulRollout(&anBoardEval, &aar, 0, trial, ro_apci[alt],
-                                ro_apCubeDecTop[alt], 1, prc,
-                                ro_aarsStatistics ? ro_aarsStatistics + alt : NULL,
-                                aciLocal[ro_fCubeRollout ? 0 : alt].nCube, &dicePerms, rngctxMTRollout, logfp);
+        aarResult[alt][j] += (float) (pra->arMean[j] * pra->n);
+        aarMu[alt][j] = aarResult[alt][j] / (float) n;
 
-            if (logfp) {
-                log_game_over(logfp);
-            }
+        if (n > 1)              /* for n == 1 aarVariance is not defined */
+            aarVariance[alt][j] = (float) (rM2 / (n - 1));
 
-            if (fInterrupt)
-                break;
+        if (j < OUTPUT_EQUITY) {
+            if (aarMu[alt][j] < 0.0f)
+                aarMu[alt][j] = 0.0f;
+            else if (aarMu[alt][j] > 1.0f)
+                aarMu[alt][j] = 1.0f;
+        }
 
-            multi_debug("exclusive lock: update result for alternative");
-            MT_Exclusive();
-            altGameCount[alt]++;
+        aarSigma[alt][j] = sqrtf(aarVariance[alt][j] / (float) n);
+    }                           /* for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++ ) */
 
-            if (ro_fInvert)
-                InvertEvaluationR(aar, ro_apci[alt]);
+    /* For normal alternatives nGamesDone and altGameCount will be equal. For cube decisions,
+     * however, the two may differ by the number of threads minus 1. So we cheat a little bit, but
+     * it would be better if the double and nodouble alternatives weren't linked */
+    if (prc->nGamesDone < altGameCount[alt])
+        prc->nGamesDone = altGameCount[alt];
 
-            /* apply the results */
-            for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++) {
-                float rMuNew;
+    memset(pra, 0, sizeof(rolloutaccum));
+}
 
-                aarResult[alt][j] += aar[j];
-                rMuNew = aarResult[alt][j] / (float) altGameCount[alt];
+/* Add the result of one game of alternative alt to the running
+ * averages. The caller holds the lock. */
 
-                if (altGameCount[alt] > 1) {    /* for i == 0 aarVariance is not defined */
-                    float rDelta = rMuNew - aarMu[alt][j];
+static void
+AddRolloutResult(int alt, float ar[NUM_ROLLOUT_OUTPUTS])
+{
+    rolloutaccum ra;
 
-                    aarVariance[alt][j] =
-                        aarVariance[alt][j] * (1.0f - 1.0f / (float) (altGameCount[alt] - 1)) +
-                        (float) (altGameCount[alt]) * rDelta * rDelta;
-                }
+    memset(&ra, 0, sizeof(ra));
+    AccumulateRolloutResult(&ra, alt, ar);
+    MergeRolloutAccum(alt, &ra);
+}
+
+/* Check the stopping conditions after a pass over the alternatives.
+ * Returns TRUE when the rollout is done. The caller holds the lock. */
+
+static int
+RolloutStopped(void)
+{
+    int active_alternatives = ro_alternatives;
+
+    /* Stop rolling out moves whose Equity is more than a user selected multiple of the joint standard
+     * deviation of the equity difference with the best move in the list. */
+
+    if (show_jsds) {
+        check_jsds(&active_alternatives);
+    }
+    if (rcRollout.fStopOnSTD) {
+        check_sds(&active_alternatives);
+    }
 
-                aarMu[alt][j] = rMuNew;
+    return (active_alternatives < 2 && rcRollout.fStopOnJsd) || active_alternatives < 1;
+}
+
+extern void
+RolloutLoopMT(void *UNUSED(unused))
+{
+    float aar[MAX_ROLLOUT_LOCKSTEP][NUM_ROLLOUT_OUTPUTS];
+    rollouttrial art[MAX_ROLLOUT_LOCKSTEP];
+    unsigned int t, cTrials;
+    unsigned int const cLockstep = MAX(1, MIN(cRolloutLockstep, MAX_ROLLOUT_LOCKSTEP));
+    int alt;
+    /* Each thread gets copies of the rngctxRollout, one per game played
+     * in lockstep */
+    rngcontext *argctxMTRollout[MAX_ROLLOUT_LOCKSTEP];
+    /* the games played since the last update of the totals */
+    rolloutaccum *aacc = g_new0(rolloutaccum, ro_alternatives);
+    unsigned int cPasses = 0;
+    int fDone;
+    perArray dicePerms;
+    dicePerms.nPermutationSeed = -1;
 
-                if (j < OUTPUT_EQUITY) {
-                    if (aarMu[alt][j] < 0.0f)
-                        aarMu[alt][j] = 0.0f;
-                    else if (aarMu[alt][j] > 1.0f)
-                        aarMu[alt][j] = 1.0f;
+    for (t = 0; t < cLockstep; t++)
+        argctxMTRollout[t] = CopyRNGContext(rngctxRollout);
+
+    /* ============ begin rollout loop ============= */
+
+    while (MT_SafeIncValue(&ro_NextTrial) <= cGames) {
+
+        /* this pass plays up to cLockstep games of each alternative */
+        MT_SafeAdd(&ro_NextTrial, (int) cLockstep - 1);
+
+        for (alt = 0; alt < ro_alternatives; ++alt) {
+            /* manual dice are entered one game at a time */
+            unsigned int const cMax = ro_apes[alt]->rc.rngRollout == RNG_MANUAL ? 1 : cLockstep;
+
+            for (cTrials = 0; cTrials < cMax; cTrials++) {
+                int trial = MT_SafeIncValue(&altTrialCount[alt]) - 1;
+                /* stop if this alternative is already finished */
+                if (fNoMore[alt] || (trial >= cGames)) {
+                    MT_SafeDec(&altTrialCount[alt]);
+                    break;
                 }
+                art[cTrials].iGame = trial;
+            }
+
+            if (!cTrials)
+                continue;
 
-                aarSigma[alt][j] = sqrtf(aarVariance[alt][j] / (float) altGameCount[alt]);
-            }                   /* for (j = 0; j < NUM_ROLLOUT_OUTPUTS; j++ ) */
+            PlayRolloutGames(alt, art, argctxMTRollout, cTrials, aar,
+                             ro_aarsStatistics ? ro_aarsStatistics + alt : NULL, &dicePerms);
 
-            /* For normal alternatives nGamesDone and altGameCount will be equal. For cube decisions,
-             * however, the two may differ by the number of threads minus 1. So we cheat a little bit, but
-             * it would be better if the double and nodouble alternatives weren't linked */
-            if (prc->nGamesDone < altGameCount[alt])
-                prc->nGamesDone = altGameCount[alt];
+            if (fInterrupt)
+                break;
 
-            MT_Release();
-            multi_debug("exclusive release: update result for alternative");
+            for (t = 0; t < cTrials; t++)
+                AccumulateRolloutResult(aacc + alt, alt, aar[t]);
 
         }                       /* for (alt = 0; alt < ro_alternatives; ++alt) */
 
@@ -1226,30 +1420,41 @@ RolloutLoopMT(void *UNUSED(unused))
             break;
 
         /* we've rolled everything out for this trial, check stopping conditions */
-        /* Stop rolling out moves whose Equity is more than a user selected multiple of the joint standard
-         * deviation of the equity difference with the best move in the list. */
 
 #if !defined(USE_MULTITHREAD)
         ProcessEvents();
 #endif
 
+        /* the totals and the stopping conditions are only updated every
+         * cRolloutCheckInterval passes, to keep the threads out of each
+         * other's way when games are quick */
+        if (++cPasses < cRolloutCheckInterval)
+            continue;
+
+        cPasses = 0;
+
         multi_debug("exclusive lock: rollout cycle update");
         MT_Exclusive();
-        if (show_jsds) {
-            check_jsds(&active_alternatives);
-        }
-        if (rcRollout.fStopOnSTD) {
-            check_sds(&active_alternatives);
-        }
-        if ((active_alternatives < 2 && rcRollout.fStopOnJsd) || active_alternatives < 1) {
-            multi_debug("exclusive release: rollout done early");
-            MT_Release();
-            break;
-        }
-        multi_debug("exclusive release: rollout cycle update");
+        for (alt = 0; alt < ro_alternatives; ++alt)
+            MergeRolloutAccum(alt, aacc + alt);
+        fDone = RolloutStopped();
         MT_Release();
+        multi_debug("exclusive release: rollout cycle update");
+
+        if (fDone)
+            break;
     }
-    g_free(rngctxMTRollout);
+
+    multi_debug("exclusive lock: rollout thread done");
+    MT_Exclusive();
+    for (alt = 0; alt < ro_alternatives; ++alt)
+        MergeRolloutAccum(alt, aacc + alt);
+    MT_Release();
+    multi_debug("exclusive release: rollout thread done");
+
+    g_free(aacc);
+    for (t = 0; t < cLockstep; t++)
+        g_free(argctxMTRollout[t]);
 }
 
 static rolloutprogressfunc *ro_pfProgress;
@@ -1279,6 +1484,396 @@ UpdateProgress(gpointer UNUSED(unused))
     return TRUE;
 }
 
+#if defined(HAVE_FORK)
+
+/*
+ * Rollouts in worker processes.
+ *
+ * The coordinator forks cWorkers copies of itself once the rollout is
+ * set up. The games are numbered as in RolloutLoopMT() and each game's
+ * dice depend only on its number, so the games can be played anywhere:
+ * worker w plays the chunks w, w + cWorkers, ... of cChunk consecutive
+ * game numbers, for all the alternatives, and sends each result back
+ * on a pipe. The coordinator adds the results in the order a single
+ * thread would play them, running the same stopping checks after each
+ * pass, so the final averages and statistics are those of a one
+ * process rollout. The workers learn which alternatives are stopped
+ * through a second pipe; a game that a worker skipped or never got to
+ * but that turns out to be needed is played by the coordinator itself.
+ *
+ * "Those of a one process rollout" means one with a single thread and
+ * "set rollout lockstep 1": the workers play cChunk games in lockstep,
+ * which a lockstep of 1 would not (see PrefetchChequerPlay()), and with
+ * several threads the games are already added in a varying order. With
+ * stopping rules, a worker may also have skipped a game by the time the
+ * coordinator needs it: it is then played here, with the same dice but
+ * from a cache in another state.
+ */
+
+typedef struct {
+    int alt;
+    int iGame;
+    int fPlayed;                /* FALSE if the worker skipped this game */
+    float ar[NUM_ROLLOUT_OUTPUTS];
+    rolloutstat ars[2];
+} rolloutresult;
+
+typedef struct {
+    pid_t pid;
+    int fdResult;               /* results, from the worker */
+    int fdControl;              /* fNoMore[], to the worker */
+} rolloutworker;
+
+static int
+WriteAll(int fd, const void *p, size_t cb)
+{
+    const char *pch = p;
+
+    while (cb) {
+        ssize_t n = write(fd, pch, cb);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+
+        pch += n;
+        cb -= (size_t) n;
+    }
+
+    return 0;
+}
+
+static int
+ReadAll(int fd, void *p, size_t cb)
+{
+    char *pch = p;
+
+    while (cb) {
+        ssize_t n = read(fd, pch, cb);
+
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return -1;
+
+        pch += n;
+        cb -= (size_t) n;
+    }
+
+    return 0;
+}
+
+static void
+RolloutWorker(int iWorker, int cWorkers, int nBase, int cChunk, int fdResult, int fdControl)
+{
+    float aar[MAX_ROLLOUT_LOCKSTEP][NUM_ROLLOUT_OUTPUTS];
+    rollouttrial art[MAX_ROLLOUT_LOCKSTEP];
+    rngcontext *argctx[MAX_ROLLOUT_LOCKSTEP];
+    rolloutresult rr;
+    perArray dicePerms;
+    int *afNoMore = g_alloca(ro_alternatives * sizeof(int));
+    int *aiFirst = g_alloca(ro_alternatives * sizeof(int));
+    int alt, k, t, cTrials;
+
+    /* the other threads of the coordinator are gone */
+    MT_AfterFork();
+    MT_SafeSet(&fEvalStore, FALSE);
+
+    dicePerms.nPermutationSeed = -1;
+    for (t = 0; t < cChunk; t++)
+        argctx[t] = CopyRNGContext(rngctxRollout);
+
+    for (alt = 0; alt < ro_alternatives; alt++)
+        aiFirst[alt] = altTrialCount[alt];
+
+    for (k = iWorker; nBase + k * cChunk < cGames; k += cWorkers) {
+        int const iFirst = nBase + k * cChunk;
+
+        /* take the latest fNoMore[] from the coordinator */
+        while (read(fdControl, afNoMore, ro_alternatives * sizeof(int)) == (ssize_t) (ro_alternatives * sizeof(int)))
+            memcpy(fNoMore, afNoMore, ro_alternatives * sizeof(int));
+
+        for (alt = 0; alt < ro_alternatives; alt++) {
+            for (cTrials = 0, t = MAX(iFirst, aiFirst[alt]); t < iFirst + cChunk && t < cGames; t++)
+                art[cTrials++].iGame = t;
+
+            memset(&rr, 0, sizeof(rr));
+            rr.alt = alt;
+
+            if (ro_aarsStatistics) {
+                /* one game at a time, for its statistics */
+                for (t = 0; t < cTrials && !fNoMore[alt]; t++) {
+                    memset(rr.ars, 0, sizeof(rr.ars));
+                    PlayRolloutGames(alt, art + t, argctx, 1, aar + t, &rr.ars, &dicePerms);
+                    if (fInterrupt)
+                        _exit(1);
+                    rr.iGame = art[t].iGame;
+                    rr.fPlayed = TRUE;
+                    memcpy(rr.ar, aar[t], sizeof(rr.ar));
+                    if (WriteAll(fdResult, &rr, sizeof(rr)))
+                        _exit(1);
+                }
+            } else if (cTrials && !fNoMore[alt]) {
+                PlayRolloutGames(alt, art, argctx, (unsigned int) cTrials, aar, NULL, &dicePerms);
+                if (fInterrupt)
+                    _exit(1);
+                for (t = 0; t < cTrials; t++) {
+                    rr.iGame = art[t].iGame;
+                    rr.fPlayed = TRUE;
+                    memcpy(rr.ar, aar[t], sizeof(rr.ar));
+                    if (WriteAll(fdResult, &rr, sizeof(rr)))
+                        _exit(1);
+                }
+            } else
+                t = 0;
+
+            /* the games left out */
+            for (rr.fPlayed = FALSE; t < cTrials; t++) {
+                rr.iGame = art[t].iGame;
+                if (WriteAll(fdResult, &rr, sizeof(rr)))
+                    _exit(1);
+            }
+        }
+    }
+
+    _exit(0);
+}
+
+/* Tell a worker which alternatives are stopped. A full pipe is fine,
+ * the worker will get the next update; any other error means it is
+ * gone, and the coordinator plays its games. */
+
+static void
+SendNoMore(rolloutworker * prw)
+{
+    psighandler sh;
+    ssize_t n;
+
+    PortableSignal(SIGPIPE, SIG_IGN, &sh, FALSE);
+    do
+        n = write(prw->fdControl, fNoMore, ro_alternatives * sizeof(int));
+    while (n < 0 && errno == EINTR);
+    PortableSignalRestore(SIGPIPE, &sh);
+
+    if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        close(prw->fdResult);
+        prw->fdResult = -1;
+    }
+}
+
+/* Wait until the result of game iGame of alternative alt arrives, or
+ * until it is clear it won't. Returns NULL in the latter case. */
+
+static rolloutresult *
+WaitForRolloutResult(GHashTable * ph, rolloutworker arw[], int cWorkers, int nBase, int cChunk, int alt,
+                     int iGame)
+{
+    gpointer key = GINT_TO_POINTER(iGame * ro_alternatives + alt);
+    rolloutworker *prwOwner = &arw[((iGame - nBase) / cChunk) % cWorkers];
+    struct pollfd *apfd = g_alloca(cWorkers * sizeof(struct pollfd));
+    static gint64 tProgress;
+    rolloutresult *prr;
+    int i, c;
+
+    while (!(prr = g_hash_table_lookup(ph, key))) {
+
+        if (prwOwner->fdResult < 0 || fInterrupt)
+            return NULL;
+
+        for (c = i = 0; i < cWorkers; i++)
+            if (arw[i].fdResult >= 0) {
+                apfd[c].fd = arw[i].fdResult;
+                apfd[c].events = POLLIN;
+                apfd[c++].revents = 0;
+            }
+
+        poll(apfd, (nfds_t) c, 200);
+
+        for (i = 0; i < c; i++) {
+            int j;
+
+            if (!apfd[i].revents)
+                continue;
+
+            for (j = 0; arw[j].fdResult != apfd[i].fd; j++);
+
+            prr = g_new(rolloutresult, 1);
+            if (ReadAll(arw[j].fdResult, prr, sizeof(rolloutresult))) {
+                /* the worker has finished */
+                g_free(prr);
+                close(arw[j].fdResult);
+                arw[j].fdResult = -1;
+                continue;
+            }
+            g_hash_table_replace(ph, GINT_TO_POINTER(prr->iGame * ro_alternatives + prr->alt), prr);
+        }
+
+        if (g_get_monotonic_time() - tProgress > 2 * G_USEC_PER_SEC) {
+            tProgress = g_get_monotonic_time();
+            UpdateProgress(NULL);
+        }
+        ProcessEvents();
+    }
+
+    g_hash_table_steal(ph, key);
+
+    if (!prr->fPlayed) {
+        g_free(prr);
+        return NULL;
+    }
+
+    return prr;
+}
+
+/* Run the rollout set up by RolloutGeneral() in cWorkers processes.
+ * Returns -1, without having done anything, if they can't be
+ * started. */
+
+static int
+RolloutWithWorkers(int cWorkers)
+{
+    rolloutworker *arw = g_alloca(cWorkers * sizeof(rolloutworker));
+    int *afSent = g_alloca(ro_alternatives * sizeof(int));
+    int const nBase = ro_NextTrial;
+    int const cChunk = (int) MAX(1, MIN(cRolloutLockstep, MAX_ROLLOUT_LOCKSTEP));
+    rngcontext *rngctx = CopyRNGContext(rngctxRollout);
+    perArray dicePerms;
+    GHashTable *ph;
+    int alt, i, j;
+
+    for (alt = 0; alt < ro_alternatives; alt++)
+        if (ro_apes[alt]->rc.rngRollout == RNG_MANUAL)
+            return -1;
+
+    /* don't let the workers inherit unwritten output */
+    fflush(stdout);
+    fflush(stderr);
+
+    for (i = 0; i < cWorkers; i++) {
+        int afdResult[2], afdControl[2];
+
+        if (pipe(afdResult) < 0)
+            break;
+        if (pipe(afdControl) < 0) {
+            close(afdResult[0]);
+            close(afdResult[1]);
+            break;
+        }
+
+        if ((arw[i].pid = fork()) < 0) {
+            close(afdResult[0]);
+            close(afdResult[1]);
+            close(afdControl[0]);
+            close(afdControl[1]);
+            break;
+        }
+
+        if (!arw[i].pid) {
+            /* the worker */
+            for (j = 0; j < i; j++) {
+                close(arw[j].fdResult);
+                close(arw[j].fdControl);
+            }
+            close(afdResult[0]);
+            close(afdControl[1]);
+            fcntl(afdControl[0], F_SETFL, O_NONBLOCK);
+            RolloutWorker(i, cWorkers, nBase, cChunk, afdResult[1], afdControl[0]);
+        }
+
+        close(afdResult[1]);
+        close(afdControl[0]);
+        fcntl(afdControl[1], F_SETFL, O_NONBLOCK);
+        arw[i].fdResult = afdResult[0];
+        arw[i].fdControl = afdControl[1];
+    }
+
+    if (i < cWorkers) {
+        outputerr(_("rollout workers"));
+        for (j = 0; j < i; j++) {
+            kill(arw[j].pid, SIGKILL);
+            waitpid(arw[j].pid, NULL, 0);
+            close(arw[j].fdResult);
+            close(arw[j].fdControl);
+        }
+        g_free(rngctx);
+        return -1;
+    }
+
+    ph = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, g_free);
+    dicePerms.nPermutationSeed = -1;
+    memcpy(afSent, fNoMore, ro_alternatives * sizeof(int));
+
+    /* the passes of RolloutLoopMT(), with one game per alternative */
+    while (!fInterrupt && ++ro_NextTrial <= cGames) {
+
+        for (alt = 0; alt < ro_alternatives; ++alt) {
+            int const trial = altTrialCount[alt];
+            rolloutresult *prr;
+
+            if (fNoMore[alt] || (trial >= cGames))
+                continue;
+
+            altTrialCount[alt]++;
+
+            if (!(prr = WaitForRolloutResult(ph, arw, cWorkers, nBase, cChunk, alt, trial))) {
+                rollouttrial rt;
+
+                if (fInterrupt)
+                    break;
+
+                /* play it here */
+                prr = g_new0(rolloutresult, 1);
+                rt.iGame = trial;
+                PlayRolloutGames(alt, &rt, &rngctx, 1, &prr->ar, ro_aarsStatistics ? &prr->ars : NULL, &dicePerms);
+                if (fInterrupt) {
+                    g_free(prr);
+                    break;
+                }
+            }
+
+            AddRolloutResult(alt, prr->ar);
+
+            if (ro_aarsStatistics)
+                for (i = 0; i < 2; i++) {
+                    int *pnTo = (int *) &ro_aarsStatistics[alt][i];
+                    const int *pnFrom = (const int *) &prr->ars[i];
+
+                    for (j = 0; j < (int) (sizeof(rolloutstat) / sizeof(int)); j++)
+                        pnTo[j] += pnFrom[j];
+                }
+
+            g_free(prr);
+        }
+
+        if (fInterrupt || RolloutStopped())
+            break;
+
+        if (memcmp(afSent, fNoMore, ro_alternatives * sizeof(int))
+            && ro_alternatives * sizeof(int) <= PIPE_BUF) {
+            for (i = 0; i < cWorkers; i++)
+                if (arw[i].fdResult >= 0)
+                    SendNoMore(&arw[i]);
+            memcpy(afSent, fNoMore, ro_alternatives * sizeof(int));
+        }
+    }
+
+    for (i = 0; i < cWorkers; i++) {
+        kill(arw[i].pid, SIGKILL);
+        waitpid(arw[i].pid, NULL, 0);
+        if (arw[i].fdResult >= 0)
+            close(arw[i].fdResult);
+        close(arw[i].fdControl);
+    }
+
+    g_hash_table_destroy(ph);
+    g_free(rngctx);
+
+    return 0;
+}
+
+#endif
+
 extern int
 RolloutGeneral(ConstTanBoard * apBoard,
                float (*apOutput[])[NUM_ROLLOUT_OUTPUTS],
@@ -1477,12 +2072,17 @@ RolloutGeneral(ConstTanBoard * apBoard,
     UpdateProgress(NULL);
 
     if (active_alternatives > 1 || (!rcRollout.fStopOnJsd && active_alternatives > 0)) {
-        multi_debug("rollout adding tasks");
-        mt_add_tasks(MT_GetNumThreads(), RolloutLoopMT, NULL, NULL);
+#if defined(HAVE_FORK)
+        if (cRolloutProcesses < 2 || RolloutWithWorkers((int) cRolloutProcesses) < 0)
+#endif
+        {
+            multi_debug("rollout adding tasks");
+            mt_add_tasks(MT_GetNumThreads(), RolloutLoopMT, NULL, NULL);
 
-        multi_debug("rollout waiting for tasks to complete");
-        MT_WaitForTasks(UpdateProgress, 2000, fAutoSaveRollout);
-        multi_debug("rollout finished waiting for tasks to complete");
+            multi_debug("rollout waiting for tasks to complete");
+            MT_WaitForTasks(UpdateProgress, 2000, fAutoSaveRollout);
+            multi_debug("rollout finished waiting for tasks to complete");
+        }
     }
 
     /* Make sure final output is up to date */
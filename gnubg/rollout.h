@@ -139,10 +139,30 @@ typedef struct {
     int nPermutationSeed;
 } perArray;
 
+/* One game of a rollout: its number (for quasi-random dice), its dice
+ * generator and its .sgf log (or NULL) */
+typedef struct {
+    int iGame;
+    rngcontext *rngctx;
+    FILE *logfp;
+} rollouttrial;
+
+/* maximum number of games played in lockstep by each rollout thread */
+#define MAX_ROLLOUT_LOCKSTEP 16
+
+extern unsigned int cRolloutLockstep;
+
+/* number of processes rollouts are run in (where fork() is available) */
+extern unsigned int cRolloutProcesses;
+
+/* number of passes over the alternatives a rollout thread plays between
+ * updates of the totals and checks of the stopping rules */
+extern unsigned int cRolloutCheckInterval;
+
 EXP_LOCK_FUN(int, BasicCubefulRollout, unsigned int aanBoard[][2][25], float aarOutput[][NUM_ROLLOUT_OUTPUTS],
-             int iTurn, int iGame, const cubeinfo aci[], int afCubeDecTop[], unsigned int cci, rolloutcontext * prc,
-             rolloutstat aarsStatistics[][2], int nBasisCube, perArray * dicePerms, rngcontext * rngctxRollout,
-             FILE * logfp);
+             int iTurn, const rollouttrial art[], unsigned int cTrials, const cubeinfo aci[], int afCubeDecTop[],
+             unsigned int cci, rolloutcontext * prc, rolloutstat aarsStatistics[][2], int nBasisCube,
+             perArray * dicePerms);
 
 
 extern void log_cube(FILE * logfp, const char *action, int side);
@@ -0,0 +1,144 @@
+# Copyright (C) 2026 the AUTHORS
+
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#
+# $Id$
+#
+
+"""
+ extbinary_test.py -- checks of the binary requests of the external
+ controller interface (see ExtHandleBinary() in external.c)
+
+ Start a concurrent server:
+
+   gnubg -t << EOF
+   external localhost:10000 concurrent
+   EOF
+
+ then run
+
+   python3 extbinary_test.py localhost 10000
+
+ The script exits with status 1 if a check fails.
+"""
+
+import base64
+import socket
+import struct
+import sys
+
+OK, BAD_REQUEST, FAILED = 0, 1, 2
+
+# the starting position, as the 10 byte key of its position ID
+START = base64.b64decode("4HPwATDgc/ABMA==")
+
+
+def header(id, plies=0, flags=0, noise=0.0, cube=1, owner=-1, move=0,
+           matchto=0, score=(0, 0), crawford=0, jacoby=0, count=None,
+           keys=b""):
+    if count is None:
+        count = len(keys) // 10
+    return struct.pack("<IIIfiiiiiiiiI", id, plies, flags, noise, cube,
+                       owner, move, matchto, score[0], score[1], crawford,
+                       jacoby, count) + keys
+
+
+def frame(payload):
+    return b"GNBQ" + struct.pack("<I", len(payload)) + payload
+
+
+def read_exactly(sock, n):
+    data = b""
+    while len(data) < n:
+        chunk = sock.recv(n - len(data))
+        if not chunk:
+            raise EOFError("connection closed by gnubg")
+        data += chunk
+    return data
+
+
+def reply(sock):
+    magic, cb = struct.unpack("<4sI", read_exactly(sock, 8))
+    if magic != b"GNBR":
+        raise ValueError("bad reply magic %r" % magic)
+    body = read_exactly(sock, cb)
+    id, status, count = struct.unpack("<III", body[:12])
+    outputs = struct.unpack("<%df" % (6 * count), body[12:])
+    return id, status, [outputs[i:i + 6] for i in range(0, len(outputs), 6)]
+
+
+failures = 0
+
+
+def check(what, ok):
+    global failures
+    print("%-60s %s" % (what, "ok" if ok else "FAILED"))
+    if not ok:
+        failures += 1
+
+
+def main(host, port):
+    sock = socket.create_connection((host, port))
+    sock.settimeout(30)
+
+    # malformed frames: each must get a "bad request" reply with its id
+    bad = [
+        ("frame shorter than the header", 1, b"\x01\0\0\0" + b"\0" * 8),
+        ("more than 7 plies", 2, header(2, plies=8, keys=START)),
+        ("position count not matching the frame", 3,
+         header(3, count=2, keys=START)),
+        ("trailing bytes after the positions", 4,
+         header(4, keys=START) + b"\0" * 3),
+        ("unknown cube owner", 5, header(5, owner=2, keys=START)),
+        ("invalid position", 6, header(6, keys=b"\xff" * 10)),
+    ]
+    for what, id, payload in bad:
+        sock.sendall(frame(payload))
+        try:
+            rid, status, outputs = reply(sock)
+            check(what, rid == id and status == BAD_REQUEST and not outputs)
+        except (socket.timeout, EOFError, ValueError) as e:
+            check("%s (%s)" % (what, e), False)
+            return
+
+    # the connection still works
+    sock.sendall(frame(header(10, keys=START)))
+    rid, status, outputs = reply(sock)
+    check("valid request after the malformed ones",
+          rid == 10 and status == OK and len(outputs) == 1)
+    if outputs:
+        check("probabilities in range",
+              all(0.0 <= p <= 1.0 for p in outputs[0][:5]))
+
+    # the cube owner is relative to the player on roll, so swapping the
+    # player on roll in a symmetric money position changes nothing
+    equities = []
+    for move in (0, 1):
+        sock.sendall(frame(header(20 + move, flags=1, cube=2, owner=0,
+                                  move=move, keys=START)))
+        rid, status, outputs = reply(sock)
+        if status == OK and outputs:
+            equities.append(outputs[0][5])
+    check("cube owned by the player on roll, either player",
+          len(equities) == 2 and abs(equities[0] - equities[1]) < 1e-6)
+
+    sock.close()
+
+
+if __name__ == "__main__":
+    if len(sys.argv) != 3:
+        sys.exit("usage: %s host port" % sys.argv[0])
+    main(sys.argv[1], int(sys.argv[2]))
+    sys.exit(1 if failures else 0)
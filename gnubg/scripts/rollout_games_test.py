@@ -0,0 +1,81 @@
+# Copyright (C) 2026 the AUTHORS
+
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the GNU General Public License
+# along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#
+# $Id$
+#
+
+"""
+ rollout_games_test.py -- checks that a rollout plays exactly the number
+ of games asked for, whatever the number of games each thread plays in
+ lockstep (see RolloutLoopMT() in rollout.c)
+
+ Run it with
+
+   gnubg -t -q --python=rollout_games_test.py
+
+ Each check prints ok or FAILED, and the script ends with SystemExit(1)
+ if one of them failed.
+"""
+
+import sys
+
+import gnubg
+
+failures = 0
+
+
+def check(what, ok):
+    global failures
+    print("%-60s %s" % (what, "ok" if ok else "FAILED"))
+    if not ok:
+        failures += 1
+
+
+def games_played(trials, lockstep, threads):
+    for command in ("set threads %d" % threads,
+                    "set rollout lockstep %d" % lockstep,
+                    "set rollout trials %d" % trials):
+        gnubg.command(command)
+
+    gnubg.performance(1)
+    gnubg.command("rollout")
+    return gnubg.performance()["rollouttrials"]
+
+
+def main():
+    # quick games, played to the end, with nothing stopping them early
+    for command in ("set player 0 human",
+                    "set player 1 human",
+                    "set rollout processes 1",
+                    "set rollout chequerplay plies 0",
+                    "set rollout cubedecision plies 0",
+                    "set rollout truncation enable off",
+                    "set rollout later enable off",
+                    "set rollout limit enable off",
+                    "set rollout jsd stop off",
+                    "new game"):
+        gnubg.command(command)
+
+    for trials, lockstep, threads in ((10, 1, 1), (1, 4, 1), (10, 4, 1),
+                                      (10, 4, 2), (13, 8, 2), (7, 3, 3)):
+        n = games_played(trials, lockstep, threads)
+        check("%d trials, lockstep %d, %d thread(s): %d games"
+              % (trials, lockstep, threads, n), n == trials)
+
+
+main()
+if failures:
+    sys.exit(1)
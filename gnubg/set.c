@@ -59,6 +59,7 @@
 #include "backgammon.h"
 #include "dice.h"
 #include "eval.h"
+#include "evalstore.h"
 #include "external.h"
 #include "export.h"
 
@@ -693,6 +694,33 @@ CommandSetCache(char *sz)
         outputerr(_("Evaluation cache allocation failed"));
 }
 
+extern void
+CommandSetPerformance(char *sz)
+{
+    SetToggle("performance", &fPerfTimers, sz,
+              _("Evaluations, move generation and task queue waits will be timed."),
+              _("Evaluations, move generation and task queue waits will not be timed."));
+}
+
+extern void
+CommandSetTranspositions(char *sz)
+{
+    int n;
+
+    if ((n = ParseNumber(&sz)) < 0) {
+        outputl(_("You must specify the number of transposition table entries to use (0 to disable it)."));
+        return;
+    }
+
+    n = EvalTranspositionsResize((unsigned int) n);
+    if (n)
+        outputf(ngettext("Searches of 2 plies or more will use a transposition table of %d entry per thread.\n",
+                         "Searches of 2 plies or more will use a transposition table of %d entries per thread.\n",
+                         n), n);
+    else
+        outputl(_("Searches will not use a transposition table."));
+}
+
 #if defined(USE_MULTITHREAD)
 extern void
 CommandSetThreads(char *sz)
@@ -1861,6 +1889,43 @@ CommandSetRolloutLate(char *sz)
 
 }
 
+extern void
+CommandSetRolloutLockstep(char *sz)
+{
+    int n = ParseNumber(&sz);
+
+    if (n < 1 || n > MAX_ROLLOUT_LOCKSTEP) {
+        outputf(_("You must specify a number of games between 1 and %d (see `help set rollout lockstep').\n"),
+                MAX_ROLLOUT_LOCKSTEP);
+        return;
+    }
+
+    cRolloutLockstep = (unsigned int) n;
+
+    outputf(ngettext("Each rollout thread will play %d game at a time.\n",
+                     "Each rollout thread will play %d games at a time.\n", n), n);
+}
+
+extern void
+CommandSetRolloutProcesses(char *sz)
+{
+    int n = ParseNumber(&sz);
+
+    if (n < 1 || n > MAX_NUMTHREADS) {
+        outputf(_("You must specify a number of processes between 1 and %d (see `help set rollout processes').\n"),
+                MAX_NUMTHREADS);
+        return;
+    }
+
+#if defined(HAVE_FORK)
+    cRolloutProcesses = (unsigned int) n;
+
+    outputf(ngettext("Rollouts will be run in %d process.\n", "Rollouts will be run in %d processes.\n", n), n);
+#else
+    outputl(_("Rollouts in several processes are not available on this platform."));
+#endif
+}
+
 extern void
 CommandSetRolloutLogEnable(char *sz)
 {
@@ -2066,6 +2131,23 @@ SetRolloutEvaluationContextBoth(char *sz, evalcontext * pec[])
 
 }
 
+extern void
+CommandSetRolloutCheckInterval(char *sz)
+{
+    int n = ParseNumber(&sz);
+
+    if (n < 1) {
+        outputl(_("You must specify how many passes over the alternatives a rollout thread plays between "
+                  "updates (see `help set rollout checkinterval')."));
+        return;
+    }
+
+    cRolloutCheckInterval = (unsigned int) n;
+
+    outputf(ngettext("Rollout threads will update the results after every pass.\n",
+                     "Rollout threads will update the results every %d passes.\n", n), n);
+}
+
 extern void
 CommandSetRolloutChequerplay(char *sz)
 {
@@ -3269,6 +3351,63 @@ CommandSetEvalSameAsAnalysis(char *sz)
               _("Evaluation settings separate from analysis settings."));
 }
 
+extern void
+CommandSetEvalQuantized(char *sz)
+{
+    int f = fQuantizedEval;
+
+    SetToggle("evaluation quantized", &f, sz,
+              _("Use the quantized (8 bit) neural nets for evaluations."),
+              _("Use the floating point neural nets for evaluations."));
+
+    EvalSetQuantized(f);
+}
+
+#if defined(USE_MULTITHREAD)
+extern void
+CommandSetEvalSplit(char *sz)
+{
+    int n;
+
+    if ((n = ParseNumber(&sz)) < 0 || n == 1) {
+        outputl(_("You must specify a number of plies of at least 2 (or 0). See \"help set evaluation split\"."));
+        return;
+    }
+
+    nSplitPlies = (unsigned int) n;
+
+    if (n)
+        outputf(_("Positions with %d plies or more left will be evaluated on several threads.\n"), n);
+    else
+        outputl(_("Each position will be evaluated on a single thread."));
+}
+#endif
+
+extern void
+CommandSetEvalStore(char *sz)
+{
+    unsigned int cRecords, cAdded, cLookup, cHit;
+
+    sz = NextToken(&sz);
+
+    if (!sz || !*sz) {
+        outputl(_("You must specify a filename or `off'. See \"help set evaluation store\"."));
+        return;
+    }
+
+    if (!StrCaseCmp(sz, "off")) {
+        EvalStoreClose();
+        outputl(_("Evaluations will not be stored."));
+        return;
+    }
+
+    if (EvalStoreOpen(sz))
+        return;
+
+    EvalStoreStats(&cRecords, &cAdded, &cLookup, &cHit);
+    outputf(_("Using the evaluation store %s (%u evaluations).\n"), sz, cRecords);
+}
+
 extern void
 CommandSetAnalysisPlayer(char *sz)
 {
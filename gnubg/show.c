@@ -33,6 +33,7 @@
 #include "backgammon.h"
 #include "drawboard.h"
 #include "eval.h"
+#include "evalstore.h"
 #include "export.h"
 #include "format.h"
 #include "dice.h"
@@ -532,13 +533,51 @@ CommandShowAliases(char *UNUSED(sz))
     outputf(_("Aliases for player 1 when importing MAT files is set to \"%s\".\n "), player1aliases);
 }
 
-#if CACHE_STATS
 extern void
 CommandShowCache(char *UNUSED(sz))
 {
+    static const char *aszLevel[N_CACHE_LEVELS] = { N_("thread"), N_("shared") };
+    uint64_t acLookup[N_CACHE_LEVELS], acHit[N_CACHE_LEVELS];
+    int i;
+#if CACHE_STATS
     unsigned int c[2], cHit[2], cLookup[2];
+#endif
+
+    outputf(_("%u entries in %u shard(s), %u entries per thread cache.\n"), GetEvalCacheEntries(), cCacheShards,
+            CACHE_L1_SIZE);
+
+    EvalCacheStats(acLookup, acHit);
+
+    for (i = 0; i < N_CACHE_LEVELS; i++) {
+        outputf(_("%-8s %14.0f lookups %14.0f hits"), gettext(aszLevel[i]), (double) acLookup[i], (double) acHit[i]);
+
+        if (acLookup[i])
+            outputf(" (%4.1f%%).", (double) acHit[i] * 100.0 / (double) acLookup[i]);
+        else
+            outputc('.');
+
+        outputc('\n');
+    }
+
+    EvalTranspositionsStats(acLookup, acHit);
+    outputf(_("%u transposition table entries per thread, %.0f lookups %.0f hits"), cTranspositions,
+            (double) acLookup[0], (double) acHit[0]);
+    if (acLookup[0])
+        outputf(" (%4.1f%%).", (double) acHit[0] * 100.0 / (double) acLookup[0]);
+    else
+        outputc('.');
+    outputc('\n');
+
+    if (EvalStoreFile()) {
+        unsigned int cRecords, cAdded, cStoreLookup, cStoreHit;
+
+        EvalStoreStats(&cRecords, &cAdded, &cStoreLookup, &cStoreHit);
+        outputf(_("Evaluation store %s: %u evaluations loaded, %u added, %u lookups %u hits.\n"),
+                EvalStoreFile(), cRecords, cAdded, cStoreLookup, cStoreHit);
+    }
 
-    EvalCacheStats(c, cLookup, cHit);
+#if CACHE_STATS
+    EvalCacheUsage(c, cLookup, cHit);
 
     outputf(_("%10u regular eval entries used %10u lookups %10u hits"), c[0], cLookup[0], cHit[0]);
 
@@ -557,8 +596,8 @@ CommandShowCache(char *UNUSED(sz))
         outputc('.');
 
     outputc('\n');
-}
 #endif
+}
 
 extern void
 CommandShowCalibration(char *UNUSED(sz))
@@ -902,6 +941,81 @@ CommandShowRNG(char *UNUSED(sz))
 
 }
 
+/* Evaluate random positions (from random games, with a fixed seed so
+ * the results are reproducible) with both the quantized and floating
+ * point nets and report the differences. */
+
+extern void
+CommandShowQuantized(char *sz)
+{
+    static const char *aszClass[] = { N_("Race"), N_("Crashed"), N_("Contact") };
+    int n = ParseNumber(&sz);
+    GRand *rand;
+    TanBoard anBoard;
+    movelist ml;
+    double aarSum[3][NUM_OUTPUTS + 1];
+    float aarMax[3][NUM_OUTPUTS + 1];
+    int acPositions[3];
+    int i, j;
+
+    if (n <= 0)
+        n = 10000;
+
+    memset(aarSum, 0, sizeof(aarSum));
+    memset(aarMax, 0, sizeof(aarMax));
+    memset(acPositions, 0, sizeof(acPositions));
+
+    rand = g_rand_new_with_seed(1);
+    InitBoard(anBoard, VARIATION_STANDARD);
+
+    for (i = 0; i < n;) {
+        float arFloat[NUM_OUTPUTS], arQuantized[NUM_OUTPUTS];
+        int pc = EvalQuantizedCompare((ConstTanBoard) anBoard, VARIATION_STANDARD, arFloat, arQuantized);
+
+        if (pc >= CLASS_RACE && pc <= CLASS_CONTACT) {
+            int k = pc - CLASS_RACE;
+            float r;
+
+            for (j = 0; j < NUM_OUTPUTS; j++) {
+                r = fabsf(arFloat[j] - arQuantized[j]);
+                aarSum[k][j] += r;
+                aarMax[k][j] = MAX(aarMax[k][j], r);
+            }
+            r = fabsf(Utility(arFloat, &ciCubeless) - Utility(arQuantized, &ciCubeless));
+            aarSum[k][NUM_OUTPUTS] += r;
+            aarMax[k][NUM_OUTPUTS] = MAX(aarMax[k][NUM_OUTPUTS], r);
+            acPositions[k]++;
+            i++;
+        }
+
+        if (ClassifyPosition((ConstTanBoard) anBoard, VARIATION_STANDARD) == CLASS_OVER) {
+            InitBoard(anBoard, VARIATION_STANDARD);
+            continue;
+        }
+
+        GenerateMoves(&ml, (ConstTanBoard) anBoard, g_rand_int_range(rand, 1, 7), g_rand_int_range(rand, 1, 7), FALSE);
+        if (ml.cMoves)
+            PositionFromKey(anBoard, &ml.amMoves[g_rand_int_range(rand, 0, (gint32) ml.cMoves)].key);
+        SwapSides(anBoard);
+    }
+
+    g_rand_free(rand);
+
+    outputf(_("Quantized evaluation errors over %d positions (mean / maximum):\n\n"), n);
+    outputf("%-10s %8s %15s %15s %15s %15s %15s %15s\n", "", _("Positions"), _("Win"), _("Win (g)"),
+            _("Win (bg)"), _("Lose (g)"), _("Lose (bg)"), _("Equity"));
+
+    for (i = 0; i < 3; i++) {
+        if (!acPositions[i])
+            continue;
+
+        outputf("%-10s %8d", gettext(aszClass[i]), acPositions[i]);
+        for (j = 0; j <= NUM_OUTPUTS; j++)
+            outputf("  %6.4f/%6.4f", aarSum[i][j] / acPositions[i], aarMax[i][j]);
+        outputc('\n');
+    }
+}
+
 extern void
 CommandShowRollout(char *UNUSED(sz))
 {
@@ -1150,6 +1264,69 @@ CommandShowKleinman(char *sz)
     outputf("%s", out);
 }
 
+static void
+ShowPerfTimer(const char *sz, uint64_t cTicks, double rTicksPerSecond, uint64_t c)
+{
+    double const r = (double) cTicks / rTicksPerSecond;
+
+    outputf("  %-20s %10.3f s", sz, r);
+    if (c)
+        outputf(_(" (%.0f ns each)"), r * 1e9 / (double) c);
+    outputc('\n');
+}
+
+extern void
+CommandShowPerformance(char *UNUSED(sz))
+{
+    perfcounters pc;
+    uint64_t cEvals = 0, cBearoff = 0;
+    double rTicksPerSecond;
+    int i;
+
+    PerfTotals(&pc);
+
+    for (i = CLASS_OVER + 1; i < CLASS_RACE; i++)
+        cBearoff += pc.acEval[i];
+    for (i = 0; i < N_CLASSES; i++)
+        cEvals += pc.acEval[i];
+
+    outputl(_("Evaluations:"));
+    outputf("  %-20s %14.0f\n", _("contact"), (double) pc.acEval[CLASS_CONTACT]);
+    outputf("  %-20s %14.0f\n", _("crashed"), (double) pc.acEval[CLASS_CRASHED]);
+    outputf("  %-20s %14.0f\n", _("race"), (double) pc.acEval[CLASS_RACE]);
+    outputf("  %-20s %14.0f\n", _("bearoff"), (double) cBearoff);
+    outputf("  %-20s %14.0f\n", _("over"), (double) pc.acEval[CLASS_OVER]);
+    outputf("  %-20s %14.0f\n", _("move generations"), (double) pc.cGenerateMoves);
+    outputf("  %-20s %14.0f\n", _("rollout trials"), (double) pc.cRolloutTrials);
+    outputf("  %-20s %14.0f\n", _("tasks"), (double) pc.cTasks);
+
+    outputl(_("Cache lookups:"));
+    for (i = 0; i < PERF_PLIES; i++) {
+        if (!pc.acLookup[i])
+            continue;
+
+        outputf(i < PERF_PLIES - 1 ? _("  %d-ply  ") : _("  %d-ply+ "), i);
+        outputf(_("%14.0f lookups %14.0f hits (%4.1f%%)\n"), (double) pc.acLookup[i], (double) pc.acHit[i],
+                (double) pc.acHit[i] * 100.0 / (double) pc.acLookup[i]);
+    }
+
+    if ((rTicksPerSecond = PerfTicksPerSecond()) > 0.0
+        && (fPerfTimers || pc.acTicks[PERF_TIMER_EVAL] || pc.acTicks[PERF_TIMER_GENERATE])) {
+        outputl(_("Timers:"));
+        ShowPerfTimer(_("evaluations"), pc.acTicks[PERF_TIMER_EVAL], rTicksPerSecond, cEvals);
+        ShowPerfTimer(_("move generation"), pc.acTicks[PERF_TIMER_GENERATE], rTicksPerSecond,
+                      pc.cGenerateMoves);
+        ShowPerfTimer(_("task queue waits"), pc.acTicks[PERF_TIMER_QUEUE_WAIT], rTicksPerSecond, 0);
+    } else
+        outputl(_("The timers are off (see `set performance')."));
+}
+
+extern void
+CommandClearPerformance(char *UNUSED(sz))
+{
+    PerfReset();
+}
+
 #if USE_MULTITHREAD
 extern void
 CommandShowThreads(char *UNUSED(sz))